@@ -0,0 +1,99 @@
+#ifndef FUZZKRIEG_AGENT_H
+#define FUZZKRIEG_AGENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <libimobiledevice/libimobiledevice.h>
+#include "agent_proto.h"
+
+// Slack on top of the exec timeouts when waiting for a reply
+#define AGENT_IO_TIMEOUT_MS 5000
+
+// An input goes as a patch only if that is at most this fraction of its size
+#define AGENT_PATCH_MAX_RATIO 2
+
+// Host side of a connection to the agent
+typedef struct {
+    int fd;                          // Loopback socket, -1 on a device connection
+    idevice_connection_t conn;       // usbmux connection, NULL on a socket
+    uint32_t seq;                    // Of the last request sent
+    uint32_t acked;                  // Of the last reply received
+    uint32_t map_size;               // Agreed in the handshake
+    uint32_t max_batch;
+    uint32_t cache_slots;            // 0 if the agent cannot take patches
+    uint32_t last_error;             // agent_error_t of the last ERROR reply
+    uint8_t connected;
+    uint8_t *buf;                    // Frame buffer, reused across requests
+    size_t buf_size;
+
+    // Patching: what the agent caches, and the last base seen with its hash
+    agent_cache_index_t cache;
+    const uint8_t *hint;
+    size_t hint_size;
+    uint64_t hint_hash;
+    uint8_t *patch;                  // Encoded patches of the batch being sent
+    size_t patch_size;
+    uint32_t *blocks;                // Base offsets + 1 by block hash, for one base
+    uint32_t block_bits;
+    uint64_t blocks_hash;
+    size_t blocks_size;
+
+    uint64_t input_bytes;            // Input bytes run so far
+    uint64_t wire_bytes;             // Input bytes actually sent, after patching
+    uint64_t inputs;                 // Inputs sent, in this many batches
+    uint64_t batches;
+} agent_client_t;
+
+// One input of a batch. base is what it was derived from, if known, and is
+// patched against; it must not change while in use, as its hash is
+// remembered by address.
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    const uint8_t *base;
+    size_t base_size;
+} agent_exec_t;
+
+// Result of one input; coverage points into the client's frame buffer and
+// stays valid until the next request
+typedef struct {
+    agent_status_t status;
+    int32_t signal;
+    uint32_t exec_time_us;
+    uint8_t coverage_format;
+    const uint8_t *coverage;
+    uint32_t coverage_size;
+} agent_exec_result_t;
+
+// Connect and handshake, over TCP to a stand-in agent or over usbmux to a device
+int agent_connect_tcp(agent_client_t *agent, const char *host, uint16_t port, uint32_t map_size);
+int agent_connect_device(agent_client_t *agent, idevice_t device, uint16_t port, uint32_t map_size);
+
+// Run a batch of inputs in one round trip; results has room for count entries.
+// Inputs close to their base, or else the input before them, travel as patches.
+int agent_exec_batch(agent_client_t *agent, const agent_exec_t *inputs, uint32_t count,
+                     uint32_t timeout_ms, agent_exec_result_t *results);
+
+// The two halves of agent_exec_batch, for keeping requests in flight.
+// Replies come back in the order requests went out. One thread may send
+// while another receives; a failed receive leaves the cache index stale,
+// so the sender must call agent_forget_cache before sending again.
+int agent_exec_send(agent_client_t *agent, const agent_exec_t *inputs, uint32_t count, uint32_t timeout_ms);
+int agent_exec_recv(agent_client_t *agent, uint32_t count, uint32_t timeout_ms, agent_exec_result_t *results);
+
+// Requests sent whose replies have not been received
+uint32_t agent_pending(const agent_client_t *agent);
+
+// Assume the agent caches nothing, so inputs go in full until it does again
+void agent_forget_cache(agent_client_t *agent);
+
+// Run a shell command on the agent's side
+int agent_command(agent_client_t *agent, const char *command, int32_t *status);
+
+// Expand a result's coverage into a dense map
+int agent_coverage_decode(const agent_exec_result_t *result, uint8_t *map, size_t map_size);
+
+// Say goodbye and close the connection
+void agent_close(agent_client_t *agent);
+
+#endif // FUZZKRIEG_AGENT_H
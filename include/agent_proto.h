@@ -0,0 +1,309 @@
+#ifndef FUZZKRIEG_AGENT_PROTO_H
+#define FUZZKRIEG_AGENT_PROTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Wire protocol between the host and the persistent on-device agent.
+//
+// Every message is a frame: an agent_frame_t header followed by length
+// payload bytes. All integers are little-endian, as on every supported host
+// and device. The host sends one request and waits for its reply; a request
+// may carry a whole batch of inputs.
+//
+//   HELLO         host  -> agent  agent_hello_t
+//   HELLO_OK      agent -> host   agent_hello_t with the agent's limits
+//   EXEC_BATCH    host  -> agent  agent_batch_t, then per input an
+//                                 agent_input_t and its bytes
+//   BATCH_RESULT  agent -> host   uint32 count, then per input run an
+//                                 agent_result_t and its coverage bytes
+//   COMMAND       host  -> agent  shell command, not NUL-terminated
+//   COMMAND_DONE  agent -> host   int32 exit status
+//   ERROR         agent -> host   uint32 agent_error_t, then a message
+//   BYE           host  -> agent  empty; the agent closes the connection
+//
+// The agent keeps recent inputs in a small cache keyed by hash64 (seed 0),
+// managed by agent_cache_index_t below so the host can track its contents.
+// An input may then travel as a patch against a cached one, such as its
+// parent; a batch whose patches name an input the agent does not have is
+// refused with AGENT_ERR_CACHE_MISS before anything runs.
+
+#define AGENT_MAGIC 0x474b4641u      // "AFKG"
+#define AGENT_VERSION 2
+#define AGENT_DEFAULT_PORT 27042
+
+// Limits; the agent may lower max_batch in HELLO_OK
+#define AGENT_MAX_BATCH 256
+#define AGENT_MAX_FRAME (64u << 20)  // Payload bytes per frame
+#define AGENT_MAX_MAP_SIZE (1u << 16)  // Coverage indices travel as uint16
+#define AGENT_CACHE_SLOTS 4          // Inputs the agent keeps to patch against
+
+// Message types
+typedef enum {
+    AGENT_MSG_HELLO = 1,
+    AGENT_MSG_HELLO_OK,
+    AGENT_MSG_EXEC_BATCH,
+    AGENT_MSG_BATCH_RESULT,
+    AGENT_MSG_COMMAND,
+    AGENT_MSG_COMMAND_DONE,
+    AGENT_MSG_ERROR,
+    AGENT_MSG_BYE
+} agent_msg_t;
+
+// Error codes carried by ERROR
+typedef enum {
+    AGENT_ERR_MALFORMED = 1,     // Frame or payload did not parse
+    AGENT_ERR_VERSION,
+    AGENT_ERR_UNSUPPORTED,       // Unknown message type or input kind
+    AGENT_ERR_INTERNAL,
+    AGENT_ERR_CACHE_MISS         // A patch base is not cached; nothing was run
+} agent_error_t;
+
+// Frame header
+typedef struct {
+    uint32_t magic;
+    uint16_t type;               // agent_msg_t
+    uint16_t flags;              // Reserved, 0
+    uint32_t seq;                // Echoed in the reply
+    uint32_t length;             // Payload bytes that follow
+} agent_frame_t;
+
+// HELLO and HELLO_OK
+typedef struct {
+    uint32_t version;
+    uint32_t map_size;           // Coverage map size; the smaller side wins
+    uint32_t max_batch;
+    uint32_t cache_slots;        // Inputs cached for patching, 0 if unsupported
+} agent_hello_t;
+
+// EXEC_BATCH header
+typedef struct {
+    uint32_t count;
+    uint32_t timeout_ms;         // Per input
+} agent_batch_t;
+
+// How an input's bytes are to be read
+typedef enum {
+    AGENT_INPUT_FULL = 0,        // The bytes are the input
+    AGENT_INPUT_PATCH            // agent_patch_t, then runs against a cached input
+} agent_input_kind_t;
+
+// Input flags
+#define AGENT_INPUT_CACHE_ONLY 0x01  // Cache the input without running it; it gets no result
+
+// Per-input header in EXEC_BATCH
+typedef struct {
+    uint32_t size;               // Bytes that follow
+    uint8_t kind;                // agent_input_kind_t
+    uint8_t flags;
+    uint8_t reserved[2];
+} agent_input_t;
+
+// Header of an AGENT_INPUT_PATCH input. The result is its runs laid end
+// to end: each copies length bytes of the base from base_offset, or, with
+// AGENT_RUN_LITERAL there, takes the length bytes that follow its header.
+// An insertion or deletion anywhere costs a literal run and a copy run
+// past it. The runs' lengths add up to size.
+typedef struct {
+    uint64_t base_hash;          // Cached input the runs copy from
+    uint64_t hash;               // Hash of the result, under which it is cached
+    uint32_t size;               // Size of the result
+    uint32_t runs;
+} agent_patch_t;
+
+// base_offset of a run whose bytes travel in the patch
+#define AGENT_RUN_LITERAL UINT32_MAX
+
+// Run header in a patch, followed by length bytes if literal
+typedef struct {
+    uint32_t base_offset;
+    uint32_t length;
+} agent_run_t;
+
+// Outcome of one input
+typedef enum {
+    AGENT_STATUS_OK = 0,
+    AGENT_STATUS_CRASH,          // Killed by a signal
+    AGENT_STATUS_TIMEOUT,
+    AGENT_STATUS_ERROR           // Could not be run
+} agent_status_t;
+
+// Coverage encodings; the agent sends whichever is smallest for the map
+typedef enum {
+    AGENT_COV_SPARSE = 1,        // (uint16 index, uint8 hits) per hit edge, ascending
+    AGENT_COV_RUNS,              // (uint16 skip, uint16 length, length bytes) per run
+    AGENT_COV_DENSE              // The whole map
+} agent_cov_format_t;
+
+#define AGENT_COV_SPARSE_ENTRY 3
+#define AGENT_COV_RUN_HEADER 4
+#define AGENT_COV_WORD 8
+
+// AGENT_COV_RUNS sends the stretches of the map between zero 8-byte words,
+// trimmed to their first and last hit. skip counts the zero bytes since the
+// end of the previous run. Neither field can overflow: a run of a whole
+// 64 KB map is larger than the map and is sent dense instead.
+
+// Per-input result in BATCH_RESULT
+typedef struct {
+    uint8_t status;              // agent_status_t
+    uint8_t coverage_format;     // agent_cov_format_t
+    uint16_t reserved;
+    int32_t signal;              // Terminating signal for AGENT_STATUS_CRASH
+    uint32_t exec_time_us;
+    uint32_t coverage_size;      // Coverage bytes that follow
+} agent_result_t;
+
+// Which inputs the agent caches. Both sides apply the same policy so the
+// host knows what it can patch against: a patch touches its base, then every
+// input takes the least recently used slot unless it is already cached.
+typedef struct {
+    uint64_t hash[AGENT_CACHE_SLOTS];
+    uint64_t last_used[AGENT_CACHE_SLOTS];   // 0 while the slot is empty
+    uint64_t clock;
+} agent_cache_index_t;
+
+static inline int agent_cache_find(const agent_cache_index_t *cache, uint64_t hash) {
+    for (int i = 0; i < AGENT_CACHE_SLOTS; i++) {
+        if (cache->last_used[i] && cache->hash[i] == hash) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static inline void agent_cache_touch(agent_cache_index_t *cache, int slot) {
+    cache->last_used[slot] = ++cache->clock;
+}
+
+// Slot for hash, evicting the least recently used one if it is new
+static inline int agent_cache_insert(agent_cache_index_t *cache, uint64_t hash, int *added) {
+    int slot = agent_cache_find(cache, hash);
+    *added = slot < 0;
+    if (slot < 0) {
+        slot = 0;
+        for (int i = 1; i < AGENT_CACHE_SLOTS; i++) {
+            if (cache->last_used[i] < cache->last_used[slot]) {
+                slot = i;
+            }
+        }
+        cache->hash[slot] = hash;
+    }
+    agent_cache_touch(cache, slot);
+    return slot;
+}
+
+// Unaligned little-endian access to frame payloads
+static inline uint32_t agent_get_u32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void agent_put_u32(uint8_t *p, uint32_t v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+// One 0x80 bit per non-zero byte of a word
+static inline uint64_t agent_cov_nonzero(uint64_t word) {
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+    return (((word & low7) + low7) | word) & ~low7;
+}
+
+// Count the non-zero bytes of a word
+static inline size_t agent_cov_count(uint64_t word) {
+    return (size_t)(((agent_cov_nonzero(word) >> 7) * 0x0101010101010101ULL) >> 56);
+}
+
+// Encode a dense map in the smallest format; out needs map_size bytes.
+// map_size must be a multiple of 8 and at most AGENT_MAX_MAP_SIZE.
+static inline size_t agent_cov_encode(const uint8_t *map, size_t map_size, uint8_t *out, uint8_t *format) {
+    uint16_t hit[AGENT_MAX_MAP_SIZE / AGENT_COV_WORD];
+    size_t n_hit = 0;
+
+    // Size both compact formats in one pass, noting the non-zero words and
+    // skipping zero blocks whole
+    size_t edges = 0, runs = 0, run_bytes = 0;
+    uint64_t prev = 0;
+    size_t words = map_size / AGENT_COV_WORD;
+    for (size_t w = 0; w < words; w += 4) {
+        uint64_t block[4] = { 0 };
+        memcpy(block, map + w * AGENT_COV_WORD, (words - w < 4 ? words - w : 4) * AGENT_COV_WORD);
+        if (!(block[0] | block[1] | block[2] | block[3])) {
+            if (prev) {
+                run_bytes -= __builtin_clzll(prev) >> 3;
+                prev = 0;
+            }
+            continue;
+        }
+
+        for (size_t k = 0; k < 4; k++) {
+            uint64_t word = block[k];
+            if (word) {
+                hit[n_hit++] = (uint16_t)(w + k);
+                edges += agent_cov_count(word);
+                run_bytes += AGENT_COV_WORD;
+                if (!prev) {
+                    runs++;
+                    run_bytes -= __builtin_ctzll(word) >> 3;
+                }
+            } else if (prev) {
+                run_bytes -= __builtin_clzll(prev) >> 3;
+            }
+            prev = word;
+        }
+    }
+    if (prev) {
+        run_bytes -= __builtin_clzll(prev) >> 3;
+    }
+    size_t sparse_size = edges * AGENT_COV_SPARSE_ENTRY;
+    size_t runs_size = runs * AGENT_COV_RUN_HEADER + run_bytes;
+
+    size_t n = 0;
+    if (sparse_size < map_size && sparse_size <= runs_size) {
+        *format = AGENT_COV_SPARSE;
+        for (size_t i = 0; i < n_hit; i++) {
+            size_t base = (size_t)hit[i] * AGENT_COV_WORD;
+            uint64_t word;
+            memcpy(&word, map + base, sizeof(word));
+            for (uint64_t bits = agent_cov_nonzero(word); bits; bits &= bits - 1) {
+                size_t j = base + (__builtin_ctzll(bits) >> 3);
+                out[n] = (uint8_t)j;
+                out[n + 1] = (uint8_t)(j >> 8);
+                out[n + 2] = map[j];
+                n += AGENT_COV_SPARSE_ENTRY;
+            }
+        }
+    } else if (runs_size < map_size) {
+        *format = AGENT_COV_RUNS;
+        size_t prev_end = 0;
+        for (size_t i = 0; i < n_hit;) {
+            // A run is a stretch of consecutive non-zero words
+            size_t first = i;
+            while (i + 1 < n_hit && hit[i + 1] == hit[i] + 1) {
+                i++;
+            }
+            uint64_t head, tail;
+            memcpy(&head, map + (size_t)hit[first] * AGENT_COV_WORD, sizeof(head));
+            memcpy(&tail, map + (size_t)hit[i] * AGENT_COV_WORD, sizeof(tail));
+            size_t start = (size_t)hit[first] * AGENT_COV_WORD + (__builtin_ctzll(head) >> 3);
+            size_t end = ((size_t)hit[i] + 1) * AGENT_COV_WORD - (__builtin_clzll(tail) >> 3);
+            i++;
+
+            uint16_t skip = (uint16_t)(start - prev_end), length = (uint16_t)(end - start);
+            memcpy(out + n, &skip, sizeof(skip));
+            memcpy(out + n + 2, &length, sizeof(length));
+            memcpy(out + n + AGENT_COV_RUN_HEADER, map + start, length);
+            n += AGENT_COV_RUN_HEADER + length;
+            prev_end = end;
+        }
+    } else {
+        *format = AGENT_COV_DENSE;
+        memcpy(out, map, map_size);
+        n = map_size;
+    }
+    return n;
+}
+
+#endif // FUZZKRIEG_AGENT_PROTO_H
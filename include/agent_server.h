@@ -0,0 +1,44 @@
+#ifndef FUZZKRIEG_AGENT_SERVER_H
+#define FUZZKRIEG_AGENT_SERVER_H
+
+#include <stdint.h>
+#include "agent_proto.h"
+
+// Linux stand-in for the on-device agent. It speaks the agent protocol on a
+// socket and runs each input through a harness linked with fuzzkrieg_rt.o
+// (input on stdin, coverage in a shared map). Without a harness it runs a
+// built-in synthetic target, which isolates protocol cost.
+
+// Inputs starting with this crash the synthetic target
+#define AGENT_SYNTHETIC_CRASH "CRASH"
+
+// Bytes of a cached input
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} agent_cache_entry_t;
+
+typedef struct {
+    const char *target;          // Harness path, NULL for the synthetic target
+    uint32_t map_size;
+    int shm_id;
+    uint8_t *trace_bits;
+    int input_fd;                // Harness stdin, rewritten per input
+    char input_path[256];
+    uint8_t *buf;                // Request buffer
+    size_t buf_size;
+    uint8_t *out;                // Reply buffer
+    size_t out_size;
+    agent_cache_index_t cache;   // Inputs kept for patches to build on
+    agent_cache_entry_t cached[AGENT_CACHE_SLOTS];
+} agent_server_t;
+
+int agent_server_init(agent_server_t *server, const char *target, const char *work_dir);
+
+// Serve one connection until BYE or EOF
+int agent_serve(agent_server_t *server, int fd);
+
+void agent_server_cleanup(agent_server_t *server);
+
+#endif // FUZZKRIEG_AGENT_SERVER_H
@@ -0,0 +1,66 @@
+#ifndef FUZZKRIEG_CORPUS_H
+#define FUZZKRIEG_CORPUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// On-disk corpus store: an append-only data file plus a fixed-record index
+#define CORPUS_DATA_FILE "corpus.dat"
+#define CORPUS_INDEX_FILE "corpus.idx"
+#define CORPUS_MAGIC 0x464b4350u    // "FKCP"
+#define CORPUS_VERSION 1
+
+// Address space reserved for each file, so views never move
+#define CORPUS_MAX_DATA (1ULL << 36)    // 64GB of test case data
+#define CORPUS_MAX_ENTRIES (1u << 22)   // 4M index records
+
+// Files grow in steps of this many bytes
+#define CORPUS_GROW_SIZE (16 * 1024 * 1024)
+
+// Index record of one stored test case
+typedef struct {
+    uint64_t offset;          // Offset of the data in the data file
+    uint64_t size;
+    uint64_t hash;            // Content hash
+    uint64_t exec_time;
+    uint32_t coverage_count;
+    uint32_t reserved;
+} corpus_record_t;
+
+// Index file header, followed by the records
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t count;           // Committed records
+    uint64_t data_size;       // Committed bytes of the data file
+    uint64_t reserved;
+} corpus_header_t;
+
+// Corpus store
+typedef struct {
+    int data_fd;
+    int index_fd;
+    uint8_t *data;            // Mapping of the data file
+    corpus_header_t *header;  // Mapping of the index file
+    corpus_record_t *records;
+    uint64_t data_file_size;  // Current length of the data file
+    uint64_t index_file_size; // Current length of the index file
+} corpus_t;
+
+// Open or create the store in a directory
+int corpus_open(corpus_t *corpus, const char *dir);
+void corpus_close(corpus_t *corpus);
+
+// Flush committed data and records to disk
+int corpus_sync(corpus_t *corpus);
+
+// Append a test case; returns its index or -1
+int64_t corpus_append(corpus_t *corpus, const uint8_t *data, size_t size, uint64_t hash,
+                      uint64_t exec_time, uint32_t coverage_count);
+
+// Zero-copy access; pointers stay valid until the store is closed
+uint32_t corpus_count(const corpus_t *corpus);
+const corpus_record_t *corpus_record(const corpus_t *corpus, uint32_t index);
+const uint8_t *corpus_data(const corpus_t *corpus, uint32_t index, size_t *size);
+
+#endif // FUZZKRIEG_CORPUS_H
@@ -0,0 +1,130 @@
+#ifndef FUZZKRIEG_DEVICE_IO_H
+#define FUZZKRIEG_DEVICE_IO_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "fuzzkrieg.h"
+#include "pipeline.h"
+
+// Calls in flight, submitted and not taken yet; a power of two
+#define DEVICE_IO_RING_SIZE 32
+
+// Calls the transfer lane may run ahead of the execute lane: two test
+// cases' worth, so the next input is on its way while one runs
+#define DEVICE_IO_HANDOFF_SIZE 8
+
+// Agent batches on the wire at once: one running and the next on its way.
+// Executes queued meanwhile are held back and go as one batch.
+#define DEVICE_IO_AGENT_BATCHES 2
+
+// Device calls the I/O lanes make on behalf of the fuzzer
+typedef enum {
+    DEVICE_IO_UPLOAD,        // Write data to path
+    DEVICE_IO_EXECUTE,       // Run data through the agent, or the command at path without one
+    DEVICE_IO_COVERAGE,      // Expand the coverage of the last execute into map
+    DEVICE_IO_CRASH          // Copy new crash reports into the store at path
+} device_io_op_t;
+
+// A queued call. Buffers and strings it points to must stay valid until
+// its completion is taken.
+typedef struct {
+    device_io_op_t op;
+    uint64_t tag;            // Returned with the completion
+    const uint8_t *data;     // UPLOAD, EXECUTE
+    size_t size;
+    const uint8_t *base;     // EXECUTE: what data was derived from, NULL if unknown
+    size_t base_size;
+    const char *path;        // UPLOAD, EXECUTE without the agent, CRASH
+    uint8_t *map;            // COVERAGE
+    size_t map_size;
+    uint32_t timeout_ms;     // EXECUTE
+} device_io_request_t;
+
+// The outcome of a call, in submission order
+typedef struct {
+    device_io_op_t op;
+    uint64_t tag;
+    int status;              // 0, or -1 if the call failed
+    agent_status_t exec_status;  // EXECUTE through the agent
+    uint32_t exec_time_us;
+    uint32_t reports;        // CRASH: reports copied
+    char report[512];        // CRASH: newest report copied, "" if none
+    uint64_t transfer_ns;    // UPLOAD, or sending an EXECUTE to the agent
+    uint64_t start_ns;       // When the execute lane took it up, 0 for UPLOAD
+    uint64_t end_ns;
+} device_io_completion_t;
+
+// A call on its way through the lanes
+typedef struct {
+    device_io_request_t request;
+    device_io_completion_t completion;
+    uint8_t sent;            // EXECUTE on the wire to the agent, reply due
+    uint8_t batch;           // EXECUTE: inputs of the agent batch it heads, 0 if it rides in an earlier one
+} device_io_entry_t;
+
+// Asynchronous I/O on one device, in two lanes. The transfer lane uploads
+// payloads and sends inputs to the agent, coalescing queued executes into
+// one batch; the execute lane takes the agent's replies, coverage and
+// crash polls. Input N+1 thus travels while N runs. Calls pass submitter, transfer lane, execute lane and back
+// through single producer, single consumer queues, so no side locks to
+// move them; the lock only puts an idle side to sleep.
+typedef struct {
+    device_ctx_t *device;
+    pthread_t transfer_thread;
+    pthread_t execute_thread;
+    pthread_mutex_t lock;
+    pthread_cond_t submitted;    // The transfer lane has work
+    pthread_cond_t transferred;  // The execute lane has work
+    pthread_cond_t drained;      // The handoff has room again
+    pthread_cond_t completed;    // A completion is ready
+    pthread_mutex_t agent_lock;  // Sending to the agent, or replaying after a cache miss
+    device_io_entry_t entries[DEVICE_IO_RING_SIZE];
+    pipeline_queue_t sq;         // Submitter to transfer lane
+    pipeline_queue_t handoff;    // Transfer lane to execute lane
+    pipeline_queue_t cq;         // Execute lane to submitter
+    pipeline_stage_t transfer;
+    pipeline_stage_t execute;
+    atomic_uint batches;         // Agent batches sent and not received yet
+
+    // Execute lane only: results of the last batch received, and the
+    // last execute's, whose coverage the next fetch expands
+    agent_exec_result_t results[DEVICE_IO_HANDOFF_SIZE];
+    uint32_t result_count;
+    uint32_t result_next;
+    int batch_status;
+    const agent_exec_result_t *result;
+    atomic_uchar stop;
+    uint8_t running;
+
+    // Submitter only
+    uint64_t requests;           // Calls submitted; the next goes in entries[requests % size]
+    uint64_t taken;              // Completions taken
+    uint64_t ring_full;          // Submissions refused for lack of room
+} device_io_t;
+
+// Start the I/O lanes of a connected device. While they run, agent calls
+// on the device must go through them; the agent client is not shared.
+int device_io_start(device_io_t *io, device_ctx_t *device);
+
+// Stop the lanes after the calls in progress; queued requests are dropped
+void device_io_stop(device_io_t *io);
+
+// Queue a call without waiting; -1 if the ring is full or the lanes stopped
+int device_io_submit(device_io_t *io, const device_io_request_t *request);
+
+// Take the oldest completion if there is one; returns 1 if taken, 0 if not
+int device_io_poll(device_io_t *io, device_io_completion_t *completion);
+
+// Take the oldest completion, waiting up to timeout_ms; returns 1 if taken,
+// 0 on timeout
+int device_io_wait(device_io_t *io, device_io_completion_t *completion, uint32_t timeout_ms);
+
+// Calls submitted and not taken yet
+uint32_t device_io_in_flight(device_io_t *io);
+
+// Snapshot the transfer and execute stages and the queues around them,
+// counted since the lanes last started
+void device_io_stats(device_io_t *io, pipeline_stats_t *stats);
+
+#endif // FUZZKRIEG_DEVICE_IO_H
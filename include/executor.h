@@ -0,0 +1,90 @@
+#ifndef FUZZKRIEG_EXECUTOR_H
+#define FUZZKRIEG_EXECUTOR_H
+
+#include "fuzzkrieg.h"
+#include "pipeline.h"
+
+// Default executor backend
+#define EXECUTOR_DEFAULT "device"
+
+// Test cases a backend with submit/reap keeps in flight
+#define EXECUTOR_MAX_IN_FLIGHT 4
+
+// Outcome of a test case run through submit/reap
+typedef struct {
+    testcase_t *tc;
+    int status;              // 0, or -1 if it did not run
+    int crashed;             // With status -1: the target was lost with it
+    uint64_t transfer_ns;
+    uint64_t run_ns;
+    uint64_t crash_check_ns;
+} executor_result_t;
+
+// Executor backend operations
+struct executor_ops {
+    const char *name;
+
+    // Set up the backend (connect, spawn, map coverage)
+    int (*init)(executor_t *exec, const fuzz_config_t *config, device_ctx_t *device);
+
+    // Ship a test case to the target ahead of running it
+    int (*load)(executor_t *exec, testcase_t *tc);
+
+    // Run the loaded test case to completion
+    int (*run)(executor_t *exec, testcase_t *tc);
+
+    // Abort the run in progress; called from the watchdog thread, NULL if unsupported
+    void (*kill)(executor_t *exec);
+
+    // Copy the coverage of the last run into coverage->map
+    int (*collect_coverage)(executor_t *exec, coverage_t *coverage);
+
+    // Return 1 if the last run crashed the target, 0 otherwise
+    int (*check_crash)(executor_t *exec);
+
+    // Write the crash log of the last run to a local file
+    int (*crash_log)(executor_t *exec, const char *local_path);
+
+    // Bring the target back after a crash took it down, blocking until it
+    // runs again; NULL if the target restarts on its own
+    int (*recover)(executor_t *exec);
+
+    // Queue a test case without waiting for it, up to EXECUTOR_MAX_IN_FLIGHT;
+    // NULL if the backend runs one at a time. Not mixed with load/run.
+    int (*submit)(executor_t *exec, testcase_t *tc);
+
+    // Wait for the oldest submitted test case, leaving its coverage in
+    // coverage->map; returns 1 with its result, 0 if none is in flight
+    int (*reap)(executor_t *exec, coverage_t *coverage, executor_result_t *result);
+
+    // Fill in the transfer and execute stages of stats and the queues
+    // around them; NULL if the backend does not run them as lanes
+    int (*pipeline_stats)(executor_t *exec, pipeline_stats_t *stats);
+
+    // Release all backend resources
+    void (*cleanup)(executor_t *exec);
+};
+
+// Available backends
+extern const executor_ops_t executor_device_ops;
+extern const executor_ops_t executor_forkserver_ops;
+extern const executor_ops_t executor_agent_ops;
+
+// Look up an executor backend by name
+const executor_ops_t *executor_find(const char *name);
+
+// Executor interface
+int executor_init(executor_t *exec, const fuzz_config_t *config, device_ctx_t *device);
+int executor_load(executor_t *exec, testcase_t *tc);
+int executor_run(executor_t *exec, testcase_t *tc);
+void executor_kill(executor_t *exec);
+int executor_collect_coverage(executor_t *exec, coverage_t *coverage);
+int executor_check_crash(executor_t *exec);
+int executor_crash_log(executor_t *exec, const char *local_path);
+int executor_recover(executor_t *exec);
+int executor_submit(executor_t *exec, testcase_t *tc);
+int executor_reap(executor_t *exec, coverage_t *coverage, executor_result_t *result);
+int executor_pipeline_stats(executor_t *exec, pipeline_stats_t *stats);
+void executor_cleanup(executor_t *exec);
+
+#endif // FUZZKRIEG_EXECUTOR_H
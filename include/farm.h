@@ -0,0 +1,92 @@
+#ifndef FUZZKRIEG_FARM_H
+#define FUZZKRIEG_FARM_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "fuzzkrieg.h"
+
+// Devices driven by one process
+#define FARM_MAX_DEVICES 32
+
+// An offline device is retried with a doubling delay in this range
+#define FARM_RETRY_MIN_MS 1000
+#define FARM_RETRY_MAX_MS 16000
+
+// With -F, attached devices are listed this often to admit new ones
+#define FARM_SCAN_INTERVAL 2   // Seconds
+
+// Exec time average: each exec moves it 1/FARM_SPEED_WEIGHT of the way
+#define FARM_SPEED_WEIGHT 8
+
+// Where a device is in its cycle. The main thread hands out work and takes
+// results; the device's own thread connects, runs and recovers.
+typedef enum {
+    FARM_DEVICE_OFFLINE,     // Not connected; the device thread retries
+    FARM_DEVICE_IDLE,        // Connected, waiting for a test case
+    FARM_DEVICE_BUSY,        // Running a test case
+    FARM_DEVICE_DONE,        // Result ready for the main thread
+    FARM_DEVICE_DROP         // Went down; the device thread recovers it
+} farm_device_state_t;
+
+// One device and the exec in flight on it
+typedef struct {
+    farm_t *farm;
+    char *udid;
+    fuzz_config_t config;    // Copy of the fuzzer's, targeting this device only
+    device_ctx_t device;
+    executor_t executor;
+    watchdog_t watchdog;
+    coverage_t coverage;     // Coverage of the last exec; only map is used
+    pthread_t thread;
+    pthread_cond_t wake;
+    farm_device_state_t state;
+    uint64_t retry_ns;       // Next connect attempt while offline
+    uint32_t retry_ms;       // Current backoff
+
+    // Work handed out by the main thread
+    testcase_t *tc;
+    uint32_t timeout_ms;
+    uint32_t depth;
+    strategy_t strategy;
+
+    // Result, written by the device thread
+    int status;              // 0, or -1 if the exec failed
+    int crashed;
+    uint64_t transfer_ns;
+    uint64_t run_ns;
+    uint64_t crash_check_ns;
+
+    // Main thread only
+    uint64_t exec_ns;        // Average exec time, 0 until the first exec
+    uint64_t execs;
+    uint64_t crashes;
+    uint32_t drops;
+} farm_device_t;
+
+// Farm: one executor per device, or per job with a host executor, all
+// feeding one fuzzer
+struct farm {
+    farm_device_t *devices[FARM_MAX_DEVICES];
+    uint32_t count;
+    pthread_mutex_t lock;    // Guards device states and the work handed over
+    pthread_cond_t done;     // A device finished or came online
+    uint32_t in_flight;      // Devices BUSY or DONE
+    uint64_t last_scan;
+    uint8_t scan;            // Admit devices that appear later
+    uint8_t stop;
+};
+
+// Start one device thread per UDID in the configuration, per attached
+// device with config->farm, or per job with config->jobs
+int farm_start(fuzzer_t *fuzzer);
+
+// Fuzz until the iteration limit or the fuzzer stops running
+int farm_run(fuzzer_t *fuzzer);
+
+// Stop every device thread and disconnect
+void farm_stop(fuzzer_t *fuzzer);
+
+// Print throughput and drops per device
+void farm_report(const fuzzer_t *fuzzer);
+
+#endif // FUZZKRIEG_FARM_H
@@ -0,0 +1,18 @@
+#ifndef FUZZKRIEG_FORKSERVER_H
+#define FUZZKRIEG_FORKSERVER_H
+
+// Fork server protocol shared between the host executor and the harness
+// runtime. The harness reads control words from FORKSRV_FD and writes
+// replies to FORKSRV_FD + 1, AFL style.
+#define FORKSRV_FD 198
+
+// Environment variable carrying the SysV shared memory id of the coverage map
+#define FORKSRV_SHM_ENV "FUZZKRIEG_SHM_ID"
+
+// Size of the shared coverage map (must match COVERAGE_MAP_SIZE)
+#define FORKSRV_MAP_SIZE (1 << 16)
+
+// Handshake sent by the harness once the fork server is up
+#define FORKSRV_HELLO 0x464b5253u  // "FKRS"
+
+#endif // FUZZKRIEG_FORKSERVER_H
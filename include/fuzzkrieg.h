@@ -2,8 +2,21 @@
 #define FUZZKRIEG_H
 
 #include <stdint.h>
+#include <stdatomic.h>
 #include <libimobiledevice/libimobiledevice.h>
 #include <libimobiledevice/lockdown.h>
+#include <libimobiledevice/afc.h>
+#include <pthread.h>
+#include "queue.h"
+#include "rng.h"
+#include "hash.h"
+#include "corpus.h"
+#include "stats.h"
+#include "pipeline.h"
+#include "shmstats.h"
+#include "watchdog.h"
+#include "triage.h"
+#include "agent.h"
 
 // Maximum size for test cases
 #define MAX_TESTCASE_SIZE (1024 * 1024)  // 1MB
@@ -18,39 +31,202 @@ typedef enum {
     FUZZ_STATE_ERROR
 } fuzz_state_t;
 
+// Number of reusable test case buffers kept per worker
+#define TESTCASE_POOL_SIZE 8
+
+typedef struct testcase_pool testcase_pool_t;
+
 // Test case structure
 typedef struct {
     uint8_t *data;
     size_t size;
-    uint32_t hash;
-    uint64_t exec_time;
+    size_t capacity;
+    testcase_pool_t *pool;  // Owning pool, NULL for heap test cases
+    uint64_t hash;           // Content hash, 0 until computed
+    const uint8_t *parent;   // Input this was mutated from, NULL if generated
+    size_t parent_size;
+    uint64_t path_hash;      // Hash of the classified coverage map
+    uint64_t exec_time;      // Microseconds spent executing
     uint32_t coverage_count;
+    uint8_t novelty;
+    uint8_t new_path;        // First run with this path hash
+    uint8_t timed_out;       // Killed by the watchdog
+    int64_t corpus_index;    // Record in the corpus store being rerun, -1 otherwise
 } testcase_t;
 
+// Pool of test case buffers with MAX_TESTCASE_SIZE capacity
+struct testcase_pool {
+    testcase_t **free_list;
+    uint32_t free_count;
+    uint32_t max_buffers;
+    uint32_t allocated;
+};
+
+// Coverage novelty of an execution
+typedef enum {
+    COVERAGE_NONE = 0,       // Nothing new
+    COVERAGE_NEW_COUNT = 1,  // Known edge reached a new hit-count bucket
+    COVERAGE_NEW_EDGE = 2    // Edge never seen before
+} coverage_novelty_t;
+
 // Coverage tracking structure
 typedef struct {
     uint8_t *map;
+    uint8_t *virgin;         // Bucket bits not seen yet, per edge
     size_t map_size;
     uint32_t unique_paths;
     uint32_t total_hits;
 } coverage_t;
 
+// AFC clients kept open per device
+#define DEVICE_AFC_POOL_SIZE 2
+#define DEVICE_AFC_IDLE_CHECK 30    // Seconds idle before a client is checked
+#define DEVICE_UPLOAD_CHUNK (256 * 1024)  // Bytes per AFC write
+
+// Pooled AFC client
+typedef struct {
+    afc_client_t client;     // NULL while the slot is empty
+    uint64_t last_used;
+    uint8_t in_use;
+} device_afc_t;
+
+// Device events, queued by the monitor thread for the fuzzer loop
+typedef enum {
+    DEVICE_EVENT_CONNECTED,
+    DEVICE_EVENT_DISCONNECTED,
+    DEVICE_EVENT_CRASH_REPORT    // A report appeared at path
+} device_event_type_t;
+
+typedef struct {
+    device_event_type_t type;
+    uint64_t time;           // stats_now_ns() when seen
+    char path[512];
+} device_event_t;
+
+#define DEVICE_EVENT_QUEUE 64            // Events held; newer ones are dropped when full
+#define DEVICE_MONITOR_INTERVAL_MS 500   // Between crash report polls
+
+// A device that went down is waited for this long to reboot and answer again
+#define DEVICE_RECOVERY_TIMEOUT 300      // Seconds
+#define DEVICE_RECOVERY_POLL_MS 1000     // Between checks while it is away
+
+// Background monitor of one device: connection events arrive from usbmuxd,
+// crash reports from polling the crash report service off the exec path
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    idevice_subscription_context_t subscription;
+    device_event_t events[DEVICE_EVENT_QUEUE];
+    uint32_t head;           // Oldest queued event
+    uint32_t count;
+    atomic_uint pending;     // count, readable without the lock
+    uint64_t dropped;
+    char crash_store[256];   // Where reports are copied, "" to not watch them
+    uint8_t stop;
+    uint8_t running;
+} device_monitor_t;
+
+// Crash reports are copied off the device into a local store through the
+// crash report copy service. A cursor kept in the store marks the newest
+// report copied, so each poll copies only what is newer, across restarts.
+#define DEVICE_CRASH_STORE "crash_reports"   // Under the output directory
+#define DEVICE_CRASH_CURSOR ".cursor"
+#define DEVICE_CRASH_MAX_NEW 64              // Reports copied per poll
+
+typedef struct {
+    afc_client_t afc;        // On the copy service, NULL until first needed
+    char dir[256];           // Store the cursor was loaded from
+    char name[256];          // Cursor: newest report copied, "" before any
+    uint64_t mtime;          // Its st_mtime
+    uint8_t started;         // The store has a cursor, even if no report yet
+} device_crash_store_t;
+
+// Called with the local path of each report copied
+typedef void (*device_report_fn)(const char *path, void *arg);
+
 // Device context structure
 typedef struct {
     idevice_t device;
     lockdownd_client_t client;
+    pthread_mutex_t client_lock;  // One lockdown request at a time, from any thread
+    device_afc_t afc[DEVICE_AFC_POOL_SIZE];
+    pthread_mutex_t afc_lock;
+    agent_client_t agent;    // Persistent agent, if one answers on the device
+    device_monitor_t monitor;
+    device_crash_store_t crashes;
     char *udid;
     char *product_type;
     char *product_version;
 } device_ctx_t;
 
+// Executor backend (operations are defined in executor.h)
+typedef struct executor_ops executor_ops_t;
+
+typedef struct {
+    const executor_ops_t *ops;
+    void *priv;
+    uint32_t timeout_ms;    // Current exec timeout, for backends that enforce it remotely
+    atomic_uchar cancel;    // Set from another thread to abandon a recovery
+} executor_t;
+
+// Device farm (defined in farm.h)
+typedef struct farm farm_t;
+
+// Mutation strategies, tracked per strategy
+typedef enum {
+    STRATEGY_HAVOC,          // Stacked mutations of a queue entry
+    STRATEGY_KERNEL_STRUCT,
+    STRATEGY_MEMORY_PATTERN,
+    STRATEGY_SYSCALL,
+    STRATEGY_IOCTL,
+    STRATEGY_MACH_MSG,
+    NUM_STRATEGIES
+} strategy_t;
+
+typedef struct {
+    uint64_t execs;
+    uint64_t finds;          // Test cases added to the corpus
+    uint64_t crashes;
+} strategy_stats_t;
+
+// Checkpoint file in the output directory, rewritten every interval
+#define CHECKPOINT_FILE "checkpoint"
+#define CHECKPOINT_INTERVAL 60  // Seconds
+
+// Crashes whose triage was cancelled at exit, one number per line; --resume
+// queues them again
+#define TRIAGE_PENDING_FILE "triage_pending"
+
+// Hangs are saved under this directory of the output directory, one per path
+#define HANGS_DIR "hangs"
+
+// Inputs in flight behind a crash are saved under this directory of the
+// output directory, as crash_<crash>_<n>; any of them may have caused it
+#define CANDIDATES_DIR "candidates"
+
+// Without -T, the exec timeout is calibrated from the first execs
+#define CALIBRATION_EXECS 64
+#define CALIBRATION_TIMEOUT_MS 10000   // Deadline while calibrating
+#define TIMEOUT_MULTIPLIER 5           // Times the p95 exec time
+#define TIMEOUT_MIN_MS 20
+
 // Fuzzer configuration
 typedef struct {
     char *target;
     char *output_dir;
+    char *executor;
+    char **devices;          // UDIDs given with -d; more than one drives a farm
+    uint32_t device_count;
+    uint8_t farm;            // -F: drive every attached device
+    uint32_t jobs;           // -j: forkserver or agent executors a farm runs side by side
+    uint32_t job;            // Which of them a farm member's configuration is for
     uint32_t max_iterations;
-    uint32_t timeout;
+    uint32_t timeout;        // Exec timeout in ms, 0 to calibrate
     uint32_t max_crashes;
+    power_schedule_t schedule;
+    uint64_t seed;
+    uint8_t resume;          // Continue from the checkpoint in output_dir
     uint8_t verbose;
 } fuzz_config_t;
 
@@ -59,11 +235,41 @@ typedef struct {
     fuzz_state_t state;
     fuzz_config_t config;
     device_ctx_t device;
+    executor_t executor;
+    farm_t *farm;              // Device farm, NULL when driving one device
     coverage_t coverage;
-    testcase_t *testcases;
-    uint32_t testcase_count;
+    seed_queue_t queue;
+    uint32_t child_depth;
+    strategy_t child_strategy;
+    strategy_stats_t strategies[NUM_STRATEGIES];
+    testcase_pool_t pool;
+    rng_t rng;
+    corpus_t corpus;           // Saved test cases
+    uint32_t requeue_next;     // Records saved after the checkpoint, rerun on resume
+    uint32_t requeue_end;
+    hashset_t corpus_hashes;   // Content hashes of saved test cases
+    hashset_t path_hashes;     // Path hashes of every execution
+    hashset_t hang_hashes;     // Path hashes of saved hangs
+    watchdog_t watchdog;
+    triage_t triage;           // Crashes analyzed and minimized off the fuzz loop
+    uint32_t exec_timeout;     // Current exec timeout in ms, 0 until calibrated
     uint32_t crash_count;
+    uint32_t unique_hangs;
+    uint64_t hang_count;
+    uint32_t iteration;
+    uint64_t exec_count;
     uint64_t start_time;
+    uint64_t start_execs;      // exec_count when this run started
+    uint64_t last_checkpoint;
+    uint64_t last_stats;
+    uint64_t last_stats_execs;
+    histogram_t stages[NUM_STAGES];
+    pipeline_stage_t pipeline[PIPELINE_STAGES];  // Host stages; the executor times its lanes
+    shmstats_t *shm;           // Live stats segment, NULL if unavailable
+    char shm_path[256];
+    uint64_t last_publish;
+    uint64_t last_publish_ns;
+    uint64_t last_publish_execs;
 } fuzzer_t;
 
 // Mutation strategy constants
@@ -80,11 +286,11 @@ typedef struct {
 extern kernel_struct_t kernel_structs[NUM_KERNEL_STRUCTS];
 
 // Mutation strategy functions
-int mutate_kernel_struct(testcase_t *tc, const kernel_struct_t *struct_template);
-int mutate_memory_pattern(testcase_t *tc);
-int mutate_syscall(testcase_t *tc);
-int mutate_ioctl(testcase_t *tc);
-int mutate_mach_msg(testcase_t *tc);
+int mutate_kernel_struct(testcase_t *tc, rng_t *rng, const kernel_struct_t *struct_template);
+int mutate_memory_pattern(testcase_t *tc, rng_t *rng);
+int mutate_syscall(testcase_t *tc, rng_t *rng);
+int mutate_ioctl(testcase_t *tc, rng_t *rng);
+int mutate_mach_msg(testcase_t *tc, rng_t *rng);
 
 // Crash analysis and minimization
 int analyze_crash(const char *crash_log, const char *testcase_path);
@@ -95,27 +301,64 @@ int fuzzer_init(fuzzer_t *fuzzer, fuzz_config_t *config);
 int fuzzer_run(fuzzer_t *fuzzer);
 void fuzzer_cleanup(fuzzer_t *fuzzer);
 
+// Checkpointing
+int fuzzer_checkpoint(fuzzer_t *fuzzer);
+int fuzzer_resume(fuzzer_t *fuzzer);
+
+// Checkpoint, stats and live stats when each is due
+void fuzzer_periodic(fuzzer_t *fuzzer);
+
+// Telemetry
+int fuzzer_write_stats(fuzzer_t *fuzzer);
+int fuzzer_stats_segment_init(fuzzer_t *fuzzer);
+void fuzzer_publish_stats(fuzzer_t *fuzzer);
+
 // Device management
 int device_connect(device_ctx_t *ctx, const char *udid);
+int device_list_udids(char ***udids, int *count);
+int device_is_attached(const char *udid);
+void device_free_udids(char **udids);
 int device_disconnect(device_ctx_t *ctx);
+int device_start_service(device_ctx_t *ctx, const char *name, lockdownd_service_descriptor_t *service);
 int device_transfer_file(device_ctx_t *ctx, const char *local_path, const char *remote_path);
+int device_upload_buffer(device_ctx_t *ctx, const uint8_t *data, size_t size, const char *remote_path);
+int device_install_file(device_ctx_t *ctx, const char *local_path, const char *remote_path);
+int device_make_directory(device_ctx_t *ctx, const char *path);
 int device_execute_command(device_ctx_t *ctx, const char *command);
 int device_check_status(device_ctx_t *ctx);
 int device_file_exists(device_ctx_t *ctx, const char *path);
 int device_copy_file(device_ctx_t *ctx, const char *remote_path, const char *local_path);
 int device_collect_coverage(device_ctx_t *ctx, coverage_t *coverage);
+int device_list_directory(device_ctx_t *ctx, const char *path, char ***entries);
+int device_get_crash_logs(device_ctx_t *ctx, const char *store_dir, device_report_fn report, void *arg);
+void device_close_crash_logs(device_ctx_t *ctx);
+
+// Device monitoring
+int device_monitor_status(device_ctx_t *ctx, const char *crash_store);
+int device_poll_event(device_ctx_t *ctx, device_event_t *event);
+void device_monitor_stop(device_ctx_t *ctx);
 
 // Coverage tracking
 int coverage_init(coverage_t *coverage);
-int coverage_update(coverage_t *coverage, const uint8_t *map, size_t size);
+int coverage_update(coverage_t *coverage, uint8_t *map, size_t size);
+uint32_t coverage_classify(uint8_t *map, size_t size);
+int coverage_has_new_bits(coverage_t *coverage, const uint8_t *map, size_t size);
+uint64_t coverage_checksum(const uint8_t *map, size_t size);
+uint32_t coverage_edges(const coverage_t *coverage);
+const char *coverage_kernel(void);
 void coverage_cleanup(coverage_t *coverage);
 
 // Test case management
 testcase_t *generate_testcase(fuzzer_t *fuzzer);
 int execute_testcase(fuzzer_t *fuzzer, testcase_t *tc);
+void record_exec(fuzzer_t *fuzzer, testcase_t *tc, uint64_t transfer_ns, uint64_t run_ns);
 int update_coverage(fuzzer_t *fuzzer, testcase_t *tc);
+int evaluate_coverage(fuzzer_t *fuzzer, testcase_t *tc);
 int check_crash(fuzzer_t *fuzzer);
-void handle_crash(fuzzer_t *fuzzer, testcase_t *tc);
+uint32_t save_crash(fuzzer_t *fuzzer, executor_t *exec, testcase_t *tc);
+void triage_crash(fuzzer_t *fuzzer, uint32_t crash);
+void handle_hang(fuzzer_t *fuzzer, testcase_t *tc);
+void save_hang(fuzzer_t *fuzzer, testcase_t *tc);
 int is_interesting(fuzzer_t *fuzzer, testcase_t *tc);
 void save_interesting_case(fuzzer_t *fuzzer, testcase_t *tc);
 
@@ -123,5 +366,15 @@ void save_interesting_case(fuzzer_t *fuzzer, testcase_t *tc);
 testcase_t *testcase_create(const uint8_t *data, size_t size);
 void testcase_free(testcase_t *tc);
 int testcase_save(testcase_t *tc, const char *path);
+int testcase_resize(testcase_t *tc, size_t size);
+uint64_t testcase_hash(testcase_t *tc);
+
+// Test case buffer pool
+int testcase_pool_init(testcase_pool_t *pool, uint32_t max_buffers);
+testcase_t *testcase_pool_acquire(testcase_pool_t *pool);
+void testcase_pool_release(testcase_pool_t *pool, testcase_t *tc);
+void testcase_pool_cleanup(testcase_pool_t *pool);
+int testcase_mutate(testcase_t *tc, rng_t *rng);
+int testcase_mutate_advanced(testcase_t *tc, rng_t *rng);
 
 #endif // FUZZKRIEG_H 
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef FUZZKRIEG_HASH_H
+#define FUZZKRIEG_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Fast 64-bit content hash (wyhash)
+uint64_t hash64(const void *data, size_t len, uint64_t seed);
+
+// Open-addressing set of 64-bit hashes
+typedef struct {
+    uint64_t *slots;
+    size_t capacity;   // Always a power of two
+    size_t count;
+} hashset_t;
+
+int hashset_init(hashset_t *set, size_t capacity);
+void hashset_cleanup(hashset_t *set);
+
+// Returns 1 if the key was added, 0 if it was already present, -1 on error
+int hashset_insert(hashset_t *set, uint64_t key);
+int hashset_contains(const hashset_t *set, uint64_t key);
+
+#endif // FUZZKRIEG_HASH_H
@@ -1,9 +1,20 @@
 #ifndef FUZZKRIEG_MINIMIZER_H
 #define FUZZKRIEG_MINIMIZER_H
 
+#include <stdatomic.h>
+
+// Decide whether a candidate still reproduces the crash
+typedef int (*minimizer_reproducer_t)(const char *testcase_path, const char *crash_log_path, void *ctx);
+
 // Initialize test case minimizer
 int minimizer_init(void);
 
+// Replace the reproducer; NULL restores the default, which reruns the fuzzer
+void minimizer_set_reproducer(minimizer_reproducer_t reproducer, void *ctx);
+
+// Stop minimizing early whenever *cancel is set; NULL never stops
+void minimizer_set_cancel(const atomic_int *cancel);
+
 // Minimize test case while preserving crash reproduction
 int minimize_testcase(const char *testcase_path, const char *crash_log_path);
 
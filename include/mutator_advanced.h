@@ -2,6 +2,7 @@
 #define MUTATOR_ADVANCED_H
 
 #include <stdint.h>
+#include "fuzzkrieg.h"
 
 // Advanced mutation patterns
 typedef struct {
@@ -94,7 +95,7 @@ typedef struct {
 } kernel_struct_template_t;
 
 // iOS 18 specific kernel structures
-static const kernel_struct_template_t kernel_structs[] = {
+static const kernel_struct_template_t kernel_struct_templates[] = {
     {
         "task",
         (const uint8_t[]){
@@ -131,13 +132,14 @@ static const kernel_struct_template_t kernel_structs[] = {
 };
 
 // Function declarations
-void mutate_kernel_struct(testcase_t *tc, const kernel_struct_template_t *template);
-void mutate_memory_pattern(testcase_t *tc);
-void mutate_syscall(testcase_t *tc);
-void mutate_ioctl(testcase_t *tc);
-void mutate_mach_msg(testcase_t *tc);
-void mutate_vm_operation(testcase_t *tc);
-void mutate_task_operation(testcase_t *tc);
-void mutate_thread_operation(testcase_t *tc);
+int mutate_kernel_struct(testcase_t *tc, rng_t *rng, const kernel_struct_t *struct_template);
+int mutate_memory_pattern(testcase_t *tc, rng_t *rng);
+int mutate_syscall(testcase_t *tc, rng_t *rng);
+int mutate_ioctl(testcase_t *tc, rng_t *rng);
+int mutate_mach_msg(testcase_t *tc, rng_t *rng);
+void mutate_vm_operation(testcase_t *tc, rng_t *rng);
+void mutate_task_operation(testcase_t *tc, rng_t *rng);
+void mutate_thread_operation(testcase_t *tc, rng_t *rng);
+int testcase_mutate_advanced(testcase_t *tc, rng_t *rng);
 
 #endif // MUTATOR_ADVANCED_H 
\ No newline at end of file
@@ -0,0 +1,155 @@
+#ifndef FUZZKRIEG_PIPELINE_H
+#define FUZZKRIEG_PIPELINE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "stats.h"
+
+// Largest queue between two stages; capacities are powers of two
+#define PIPELINE_QUEUE_MAX 32
+
+// Stages of the pipelined fuzz loop, in the order a test case passes them
+typedef enum {
+    PIPELINE_MUTATE,        // Host: derive the next input
+    PIPELINE_TRANSFER,      // Device: ship it while the one ahead runs
+    PIPELINE_EXECUTE,       // Device: run it, fetch coverage, poll for crashes
+    PIPELINE_ANALYZE,       // Host: classify coverage, save what is new
+    PIPELINE_STAGES
+} pipeline_stage_id_t;
+
+// One queue between each stage and the next
+#define PIPELINE_QUEUES (PIPELINE_STAGES - 1)
+
+// Bounded queue of pointers with one producer and one consumer. Neither
+// side locks; each writes only its own index and its own counters.
+typedef struct {
+    void *slots[PIPELINE_QUEUE_MAX];
+    uint32_t capacity;
+    atomic_uint head;               // Next to take; consumer
+    atomic_uint tail;               // Next free; producer
+
+    // Producer side
+    _Atomic uint64_t pushes;
+    _Atomic uint64_t full;          // Pushes refused: backpressure on the producer
+    _Atomic uint64_t depth_sum;     // Entries queued ahead, summed over pushes
+    _Atomic uint64_t peak;
+
+    // Consumer side
+    _Atomic uint64_t empty;         // Takes that found nothing: the consumer starved
+} pipeline_queue_t;
+
+// Where a stage's time goes; written by the thread running it
+typedef struct {
+    _Atomic uint64_t items;
+    _Atomic uint64_t busy_ns;       // Working on an item
+    _Atomic uint64_t starved_ns;    // Waiting for an item from upstream
+    _Atomic uint64_t blocked_ns;    // Waiting for room downstream
+} pipeline_stage_t;
+
+// Snapshot of a stage, for reporting
+typedef struct {
+    uint64_t items;
+    uint64_t busy_ns;
+    uint64_t starved_ns;
+    uint64_t blocked_ns;
+} pipeline_stage_stats_t;
+
+// Snapshot of a queue, for reporting
+typedef struct {
+    uint32_t capacity;
+    uint32_t depth;
+    uint64_t peak;
+    uint64_t pushes;
+    uint64_t full;
+    uint64_t empty;
+    double mean_depth;              // Seen by each push
+} pipeline_queue_stats_t;
+
+// Every stage and the queue after each one but the last
+typedef struct {
+    pipeline_stage_stats_t stage[PIPELINE_STAGES];
+    pipeline_queue_stats_t queue[PIPELINE_QUEUES];
+} pipeline_stats_t;
+
+// Entries queued and not taken yet
+static inline uint32_t pipeline_queue_depth(const pipeline_queue_t *q) {
+    return atomic_load_explicit(&q->tail, memory_order_acquire) -
+           atomic_load_explicit(&q->head, memory_order_acquire);
+}
+
+// Whether a push would succeed, counting a full queue as backpressure;
+// the answer holds until the next push. Producer only.
+static inline int pipeline_queue_has_room(pipeline_queue_t *q) {
+    if (pipeline_queue_depth(q) >= q->capacity) {
+        stats_add(&q->full, 1);
+        return 0;
+    }
+    return 1;
+}
+
+// Append an item; -1 if the queue is full. Producer only.
+static inline int pipeline_queue_push(pipeline_queue_t *q, void *item) {
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    uint32_t depth = tail - atomic_load_explicit(&q->head, memory_order_acquire);
+    if (depth >= q->capacity) {
+        stats_add(&q->full, 1);
+        return -1;
+    }
+
+    q->slots[tail & (q->capacity - 1)] = item;
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+
+    stats_add(&q->pushes, 1);
+    stats_add(&q->depth_sum, depth);
+    if (depth + 1 > atomic_load_explicit(&q->peak, memory_order_relaxed)) {
+        atomic_store_explicit(&q->peak, depth + 1, memory_order_relaxed);
+    }
+    return 0;
+}
+
+// The index-th item from the oldest, left in place; NULL if there are
+// not that many. Consumer only.
+static inline void *pipeline_queue_peek(pipeline_queue_t *q, uint32_t index) {
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (atomic_load_explicit(&q->tail, memory_order_acquire) - head <= index) {
+        return NULL;
+    }
+    return q->slots[(head + index) & (q->capacity - 1)];
+}
+
+// The oldest item, left in place until popped; NULL if the queue is
+// empty, which counts as the consumer starving. Consumer only.
+static inline void *pipeline_queue_front(pipeline_queue_t *q) {
+    void *item = pipeline_queue_peek(q, 0);
+    if (!item) {
+        stats_add(&q->empty, 1);
+    }
+    return item;
+}
+
+// Take the oldest item; NULL if the queue is empty. Consumer only.
+static inline void *pipeline_queue_pop(pipeline_queue_t *q) {
+    void *item = pipeline_queue_front(q);
+    if (!item) {
+        return NULL;
+    }
+
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return item;
+}
+
+// Set up an empty queue of capacity entries, a power of two up to PIPELINE_QUEUE_MAX
+int pipeline_queue_init(pipeline_queue_t *q, uint32_t capacity);
+
+// Snapshot a queue or a stage; safe from any thread
+void pipeline_queue_stats(const pipeline_queue_t *q, pipeline_queue_stats_t *stats);
+void pipeline_stage_stats(const pipeline_stage_t *stage, pipeline_stage_stats_t *stats);
+
+// Name of a stage, as used in fuzzer_stats
+const char *pipeline_stage_name(pipeline_stage_id_t stage);
+
+// Name of the queue feeding a stage, as used in fuzzer_stats
+const char *pipeline_queue_name(pipeline_stage_id_t consumer);
+
+#endif // FUZZKRIEG_PIPELINE_H
@@ -0,0 +1,64 @@
+#ifndef FUZZKRIEG_QUEUE_H
+#define FUZZKRIEG_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hash.h"
+
+// Energy bounds (number of children generated per parent selection)
+#define QUEUE_BASE_ENERGY 16
+#define QUEUE_MAX_ENERGY (QUEUE_BASE_ENERGY * 32)
+
+// Power schedules, as in AFLFast
+typedef enum {
+    SCHEDULE_EXPLORE,   // Constant energy, scaled by speed and coverage only
+    SCHEDULE_FAST,      // Exponential in times fuzzed, inverse to edge frequency
+    SCHEDULE_COE,       // Like FAST, but skips entries on high-frequency edges
+    SCHEDULE_LIN,       // Linear in times fuzzed, inverse to edge frequency
+    SCHEDULE_QUAD       // Quadratic in times fuzzed, inverse to edge frequency
+} power_schedule_t;
+
+// Seed queue entry
+typedef struct {
+    const uint8_t *data;    // Not owned; points into the corpus store
+    size_t size;
+    uint64_t exec_time;
+    uint64_t path_hash;     // Checksum of the classified coverage map
+    uint32_t coverage_count;
+    uint32_t rare_edge;     // Least frequently hit edge of this entry
+    uint32_t fuzz_level;    // Times selected as a parent
+    uint32_t depth;         // Mutation generations from a random seed
+} queue_entry_t;
+
+// Seed queue
+typedef struct {
+    queue_entry_t *entries;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t current;       // Parent currently being fuzzed
+    uint32_t energy_left;   // Children left for the current parent
+    uint32_t cycles;        // Completed passes over the queue
+    uint64_t total_exec_time;
+    uint64_t total_coverage;
+    uint32_t *edge_hits;    // Executions that hit each edge
+    hashset_t paths;        // Path hashes of all entries
+    size_t map_size;
+    power_schedule_t schedule;
+} seed_queue_t;
+
+// Queue management; added data must outlive the queue
+int queue_init(seed_queue_t *queue, size_t map_size, power_schedule_t schedule);
+void queue_cleanup(seed_queue_t *queue);
+int queue_add(seed_queue_t *queue, const uint8_t *data, size_t size, uint64_t exec_time,
+              const uint8_t *trace, uint64_t path_hash, uint32_t depth);
+int queue_restore(seed_queue_t *queue, const queue_entry_t *saved);
+void queue_record_hits(seed_queue_t *queue, const uint8_t *trace);
+
+// Parent selection
+queue_entry_t *queue_next(seed_queue_t *queue);
+uint32_t queue_calculate_energy(const seed_queue_t *queue, const queue_entry_t *entry);
+
+// Parse a schedule name ("explore", "fast", "coe", "lin", "quad")
+int queue_parse_schedule(const char *name, power_schedule_t *schedule);
+
+#endif // FUZZKRIEG_QUEUE_H
@@ -0,0 +1,48 @@
+#ifndef FUZZKRIEG_RNG_H
+#define FUZZKRIEG_RNG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Per-worker xoshiro256** generator
+typedef struct {
+    uint64_t s[4];
+} rng_t;
+
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// Next 64-bit output
+static inline uint64_t rng_next(rng_t *rng) {
+    uint64_t *s = rng->s;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+
+    return result;
+}
+
+// Uniform value in [0, bound), Lemire's multiply-shift reduction
+static inline uint32_t rng_below(rng_t *rng, uint32_t bound) {
+    return (uint32_t)(((rng_next(rng) >> 32) * (uint64_t)bound) >> 32);
+}
+
+// Uniform size in [0, bound)
+static inline size_t rng_below_size(rng_t *rng, size_t bound) {
+    return bound <= UINT32_MAX ? rng_below(rng, (uint32_t)bound) : rng_next(rng) % bound;
+}
+
+// Seed the generator, expanding the seed with splitmix64
+void rng_seed(rng_t *rng, uint64_t seed);
+
+// Fill a buffer with random bytes, 64 bits at a time
+void rng_fill(rng_t *rng, uint8_t *buf, size_t n);
+
+#endif // FUZZKRIEG_RNG_H
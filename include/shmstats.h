@@ -0,0 +1,69 @@
+#ifndef FUZZKRIEG_SHMSTATS_H
+#define FUZZKRIEG_SHMSTATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Live stats segments: one mapped file per instance, <dir>/<pid>.stats
+#define SHMSTATS_DIR "/tmp/fuzzkrieg"
+#define SHMSTATS_DIR_ENV "FUZZKRIEG_STATS_DIR"
+#define SHMSTATS_SUFFIX ".stats"
+
+#define SHMSTATS_MAGIC 0x464b5354u  // "FKST"
+#define SHMSTATS_VERSION 2
+#define SHMSTATS_MAX_STAGES 16
+
+// Latency summary of one loop stage
+typedef struct {
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t total_ns;
+    uint64_t count;
+} shmstats_stage_t;
+
+// Stats segment; readers map it read-only and never block the writer
+typedef struct {
+    // Fixed when the segment is created
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                  // sizeof(shmstats_t) of the writer
+    int32_t pid;
+    char executor[16];
+    char target[128];
+    uint32_t num_stages;
+    uint32_t reserved;
+    char stage_names[SHMSTATS_MAX_STAGES][16];
+
+    // Odd while the writer is updating the fields below
+    _Atomic uint64_t seq;
+
+    uint64_t start_time;
+    uint64_t last_update;
+    uint64_t iterations;
+    uint64_t execs;
+    double execs_per_sec;
+    uint32_t crashes;
+    uint32_t hangs;
+    uint32_t corpus_count;
+    uint32_t queue_count;
+    uint32_t unique_edges;
+    uint32_t exec_timeout;          // ms, 0 while calibrating
+    shmstats_stage_t stages[SHMSTATS_MAX_STAGES];
+} shmstats_t;
+
+// Directory holding the segments
+const char *shmstats_dir(void);
+
+// Writer side
+shmstats_t *shmstats_create(char *path, size_t path_size);
+void shmstats_destroy(shmstats_t *stats, const char *path);
+void shmstats_write_begin(shmstats_t *stats);
+void shmstats_write_end(shmstats_t *stats);
+
+// Reader side; shmstats_read returns -1 if no consistent copy could be taken
+const shmstats_t *shmstats_attach(const char *path);
+void shmstats_detach(const shmstats_t *stats);
+int shmstats_read(const shmstats_t *stats, shmstats_t *snapshot);
+
+#endif // FUZZKRIEG_SHMSTATS_H
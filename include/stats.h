@@ -0,0 +1,72 @@
+#ifndef FUZZKRIEG_STATS_H
+#define FUZZKRIEG_STATS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+// Stages of one iteration of the fuzz loop
+typedef enum {
+    STAGE_GENERATE,     // Pick a parent or fill a fresh buffer
+    STAGE_MUTATE,
+    STAGE_TRANSFER,     // Ship the input to the target
+    STAGE_EXECUTE,
+    STAGE_COVERAGE,     // Collect and classify coverage
+    STAGE_CRASH_CHECK,
+    STAGE_SAVE,         // Triage and save interesting inputs
+    NUM_STAGES
+} stage_t;
+
+// Log-linear buckets: four per power of two of nanoseconds
+#define HISTOGRAM_SUB_BITS 2
+#define HISTOGRAM_BUCKETS (64 << HISTOGRAM_SUB_BITS)
+
+// Latency histogram; one writer, any number of readers
+typedef struct {
+    _Atomic uint64_t buckets[HISTOGRAM_BUCKETS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t total_ns;
+} histogram_t;
+
+// fuzzer_stats file in the output directory
+#define STATS_FILE "fuzzer_stats"
+#define STATS_INTERVAL 5    // Seconds
+
+// Monotonic clock in nanoseconds
+static inline uint64_t stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Bucket of a latency
+static inline uint32_t histogram_bucket(uint64_t ns) {
+    if (ns < (1u << HISTOGRAM_SUB_BITS)) {
+        return (uint32_t)ns;
+    }
+
+    uint32_t msb = 63 - __builtin_clzll(ns);
+    uint32_t sub = (ns >> (msb - HISTOGRAM_SUB_BITS)) & ((1u << HISTOGRAM_SUB_BITS) - 1);
+    return ((msb - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) + sub;
+}
+
+// Bump a counter that only this thread writes; no locked instructions needed
+static inline void stats_add(_Atomic uint64_t *counter, uint64_t value) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value,
+                          memory_order_relaxed);
+}
+
+// Record one latency
+static inline void histogram_record(histogram_t *h, uint64_t ns) {
+    stats_add(&h->buckets[histogram_bucket(ns)], 1);
+    stats_add(&h->total_ns, ns);
+    stats_add(&h->count, 1);
+}
+
+// Latency at a percentile (0-100), estimated from the bucket midpoint
+uint64_t histogram_percentile(const histogram_t *h, double percentile);
+
+// Name of a stage, as used in fuzzer_stats
+const char *stats_stage_name(stage_t stage);
+
+#endif // FUZZKRIEG_STATS_H
@@ -0,0 +1,50 @@
+#ifndef FUZZKRIEG_TRIAGE_H
+#define FUZZKRIEG_TRIAGE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// Crashes the queue holds at first; it doubles as they pile up
+#define TRIAGE_QUEUE 16
+
+// Called on the triage thread for each queued crash, in order; also
+// hands back the crashes a cancelled triage leaves untouched
+typedef void (*triage_fn_t)(void *ctx, uint32_t crash);
+
+// Analyzes and minimizes saved crashes on its own thread, so fuzzing
+// goes on meanwhile
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    triage_fn_t fn;
+    void *ctx;
+    uint32_t *pending;       // Crash numbers, oldest at head
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+    atomic_int cancel;       // Set from a signal handler; the crash in progress finishes
+    uint8_t stop;
+    uint8_t running;
+} triage_t;
+
+// Start the triage thread
+int triage_start(triage_t *triage, triage_fn_t fn, void *ctx);
+
+// Queue a saved crash; triaged right here if the thread is not running
+// or the queue cannot grow
+void triage_submit(triage_t *triage, uint32_t crash);
+
+// Crashes queued and not started yet
+uint32_t triage_queued(triage_t *triage);
+
+// Leave the queued crashes alone once the one in progress is done;
+// async-signal-safe
+void triage_cancel(triage_t *triage);
+
+// Triage what is still queued unless cancelled, then stop and join the
+// thread. Crashes left untriaged go to leftover.
+void triage_stop(triage_t *triage, triage_fn_t leftover);
+
+#endif // FUZZKRIEG_TRIAGE_H
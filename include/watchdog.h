@@ -0,0 +1,35 @@
+#ifndef FUZZKRIEG_WATCHDOG_H
+#define FUZZKRIEG_WATCHDOG_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+// Called on the watchdog thread when a deadline passes
+typedef void (*watchdog_fire_t)(void *ctx);
+
+// Deadline timer for one exec at a time, served by its own thread
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    watchdog_fire_t fire;
+    void *ctx;
+    uint64_t deadline_ns;    // Monotonic, 0 while disarmed
+    uint8_t fired;
+    uint8_t stop;
+    uint8_t running;
+} watchdog_t;
+
+// Start the watchdog thread
+int watchdog_start(watchdog_t *wd, watchdog_fire_t fire, void *ctx);
+
+// Fire unless disarmed within timeout_ms
+void watchdog_arm(watchdog_t *wd, uint32_t timeout_ms);
+
+// Cancel the deadline; returns 1 if it had already fired
+int watchdog_disarm(watchdog_t *wd);
+
+// Stop and join the watchdog thread
+void watchdog_stop(watchdog_t *wd);
+
+#endif // FUZZKRIEG_WATCHDOG_H
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "../../include/agent_server.h"
+
+// Print usage information
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("Linux stand-in for the on-device agent.\n");
+    printf("Options:\n");
+    printf("  -t, --target <path>    Harness linked with fuzzkrieg_rt.o (default: synthetic target)\n");
+    printf("  -p, --port <n>         TCP port (default: %d)\n", AGENT_DEFAULT_PORT);
+    printf("  -b, --bind <addr>      Address to listen on (default: 127.0.0.1)\n");
+    printf("  -w, --workdir <dir>    Directory for the harness input file (default: /tmp)\n");
+    printf("  -1, --once             Exit after the first connection\n");
+    printf("  -h, --help             Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *target = NULL;
+    const char *bind_addr = "127.0.0.1";
+    const char *work_dir = "/tmp";
+    int port = AGENT_DEFAULT_PORT;
+    int once = 0;
+
+    static struct option long_options[] = {
+        {"target", required_argument, 0, 't'},
+        {"port", required_argument, 0, 'p'},
+        {"bind", required_argument, 0, 'b'},
+        {"workdir", required_argument, 0, 'w'},
+        {"once", no_argument, 0, '1'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:p:b:w:1h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 't':
+                target = optarg;
+                break;
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'b':
+                bind_addr = optarg;
+                break;
+            case 'w':
+                work_dir = optarg;
+                break;
+            case '1':
+                once = 1;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    // A host that goes away mid-reply must not kill the agent
+    signal(SIGPIPE, SIG_IGN);
+
+    agent_server_t server;
+    if (agent_server_init(&server, target, work_dir) != 0) {
+        fprintf(stderr, "Failed to initialize agent\n");
+        return 1;
+    }
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    int one = 1;
+    if (listen_fd < 0 || inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1 ||
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, 1) != 0) {
+        fprintf(stderr, "Failed to listen on %s:%d\n", bind_addr, port);
+        agent_server_cleanup(&server);
+        return 1;
+    }
+
+    printf("Agent listening on %s:%d (%s)\n", bind_addr, port, target ? target : "synthetic target");
+    fflush(stdout);
+
+    // One host at a time, as on the device
+    do {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        if (agent_serve(&server, fd) != 0) {
+            fprintf(stderr, "Connection ended with an error\n");
+        }
+        close(fd);
+    } while (!once);
+
+    close(listen_fd);
+    agent_server_cleanup(&server);
+    return 0;
+}
@@ -0,0 +1,576 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/uio.h>
+#include "../../include/agent_server.h"
+#include "../../include/forkserver.h"
+#include "../../include/hash.h"
+
+// Monotonic clock in nanoseconds
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Read exactly len bytes; 1 on a clean EOF before the first byte
+static int read_full(int fd, void *buf, size_t len) {
+    uint8_t *p = buf;
+    size_t want = len;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n == 0 && len == want) {
+            return 1;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Write exactly len bytes
+static int write_full(int fd, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Grow a buffer to at least len bytes
+static int reserve(uint8_t **buf, size_t *size, size_t len) {
+    if (len <= *size) {
+        return 0;
+    }
+
+    size_t new_size = *size ? *size : 64 * 1024;
+    while (new_size < len) {
+        new_size *= 2;
+    }
+
+    uint8_t *p = realloc(*buf, new_size);
+    if (!p) {
+        return -1;
+    }
+    *buf = p;
+    *size = new_size;
+    return 0;
+}
+
+// Send a reply frame
+static int send_reply(int fd, agent_msg_t type, uint32_t seq, const void *payload, uint32_t length) {
+    agent_frame_t frame = {
+        .magic = AGENT_MAGIC,
+        .type = type,
+        .seq = seq,
+        .length = length
+    };
+
+    // One write, so the reply is not split around a delayed ACK
+    struct iovec iov[2] = {
+        { &frame, sizeof(frame) },
+        { (void *)payload, length }
+    };
+    ssize_t n;
+    do {
+        n = writev(fd, iov, length ? 2 : 1);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        return -1;
+    }
+    if ((size_t)n >= sizeof(frame)) {
+        size_t done = n - sizeof(frame);
+        return done < length ? write_full(fd, (const uint8_t *)payload + done, length - done) : 0;
+    }
+    if (write_full(fd, (const uint8_t *)&frame + n, sizeof(frame) - n) != 0) {
+        return -1;
+    }
+    return length ? write_full(fd, payload, length) : 0;
+}
+
+// Send an ERROR reply
+static int send_error(int fd, uint32_t seq, agent_error_t code, const char *message) {
+    uint8_t payload[256];
+    size_t len = strlen(message);
+    if (len > sizeof(payload) - sizeof(uint32_t)) {
+        len = sizeof(payload) - sizeof(uint32_t);
+    }
+
+    agent_put_u32(payload, code);
+    memcpy(payload + sizeof(uint32_t), message, len);
+    return send_reply(fd, AGENT_MSG_ERROR, seq, payload, sizeof(uint32_t) + len);
+}
+
+// Set up the coverage map and, for a harness, its input file
+int agent_server_init(agent_server_t *server, const char *target, const char *work_dir) {
+    if (!server) {
+        return -1;
+    }
+
+    memset(server, 0, sizeof(agent_server_t));
+    server->target = target;
+    server->map_size = AGENT_MAX_MAP_SIZE;
+    server->shm_id = -1;
+    server->input_fd = -1;
+
+    if (!target) {
+        server->trace_bits = calloc(1, server->map_size);
+        return server->trace_bits ? 0 : -1;
+    }
+
+    // Same shared map contract as the fork server executor
+    server->shm_id = shmget(IPC_PRIVATE, FORKSRV_MAP_SIZE, IPC_CREAT | IPC_EXCL | 0600);
+    if (server->shm_id < 0) {
+        fprintf(stderr, "Failed to create coverage shared memory: %s\n", strerror(errno));
+        return -1;
+    }
+    server->trace_bits = shmat(server->shm_id, NULL, 0);
+    if (server->trace_bits == (void *)-1) {
+        server->trace_bits = NULL;
+        fprintf(stderr, "Failed to attach coverage shared memory: %s\n", strerror(errno));
+        agent_server_cleanup(server);
+        return -1;
+    }
+
+    char shm_str[32];
+    snprintf(shm_str, sizeof(shm_str), "%d", server->shm_id);
+    setenv(FORKSRV_SHM_ENV, shm_str, 1);
+
+    snprintf(server->input_path, sizeof(server->input_path), "%s/.agent_input_%d",
+             work_dir ? work_dir : "/tmp", (int)getpid());
+    server->input_fd = open(server->input_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (server->input_fd < 0) {
+        fprintf(stderr, "Failed to create %s: %s\n", server->input_path, strerror(errno));
+        agent_server_cleanup(server);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Built-in target: a few edges picked by the leading bytes
+static agent_status_t run_synthetic(agent_server_t *server, const uint8_t *data, size_t size, int32_t *signal) {
+    size_t n = size < 64 ? size : 64;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t edge = (uint32_t)((i * 0x9e3779b1u) ^ (data[i] * 0x85ebca6bu)) & (server->map_size - 1);
+        server->trace_bits[edge]++;
+    }
+
+    if (size >= strlen(AGENT_SYNTHETIC_CRASH) &&
+        memcmp(data, AGENT_SYNTHETIC_CRASH, strlen(AGENT_SYNTHETIC_CRASH)) == 0) {
+        *signal = SIGSEGV;
+        return AGENT_STATUS_CRASH;
+    }
+    return AGENT_STATUS_OK;
+}
+
+// Run the harness on one input with a deadline
+static agent_status_t run_harness(agent_server_t *server, const uint8_t *data, size_t size,
+                                  uint32_t timeout_ms, int32_t *signal) {
+    if (pwrite(server->input_fd, data, size, 0) != (ssize_t)size ||
+        ftruncate(server->input_fd, size) != 0 ||
+        lseek(server->input_fd, 0, SEEK_SET) < 0) {
+        return AGENT_STATUS_ERROR;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        return AGENT_STATUS_ERROR;
+    }
+
+    if (pid == 0) {
+        dup2(server->input_fd, STDIN_FILENO);
+        int null_fd = open("/dev/null", O_RDWR);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            close(null_fd);
+        }
+
+        char *argv[] = { (char *)server->target, NULL };
+        execv(server->target, argv);
+        _exit(127);
+    }
+
+    // Poll for exit, backing off from 20us to 1ms
+    uint64_t deadline = now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    long sleep_ns = 20000;
+    int status;
+    for (;;) {
+        pid_t ret = waitpid(pid, &status, WNOHANG);
+        if (ret == pid) {
+            break;
+        }
+        if (ret < 0 && errno != EINTR) {
+            return AGENT_STATUS_ERROR;
+        }
+
+        if (now_ns() >= deadline) {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            return AGENT_STATUS_TIMEOUT;
+        }
+
+        struct timespec ts = { 0, sleep_ns };
+        nanosleep(&ts, NULL);
+        if (sleep_ns < 1000000) {
+            sleep_ns *= 2;
+        }
+    }
+
+    if (WIFSIGNALED(status)) {
+        *signal = WTERMSIG(status);
+        return AGENT_STATUS_CRASH;
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+        return AGENT_STATUS_ERROR;
+    }
+    return AGENT_STATUS_OK;
+}
+
+// Check a patch's runs against its header and the bytes it arrived in
+static int patch_valid(const uint8_t *p, uint32_t len, agent_patch_t *patch) {
+    if (len < sizeof(agent_patch_t)) {
+        return 0;
+    }
+    memcpy(patch, p, sizeof(agent_patch_t));
+    if (patch->size > AGENT_MAX_FRAME) {
+        return 0;
+    }
+
+    const uint8_t *end = p + len;
+    p += sizeof(agent_patch_t);
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < patch->runs; i++) {
+        agent_run_t run;
+        if ((size_t)(end - p) < sizeof(run)) {
+            return 0;
+        }
+        memcpy(&run, p, sizeof(run));
+        p += sizeof(run);
+        total += run.length;
+        if (total > patch->size) {
+            return 0;
+        }
+        if (run.base_offset == AGENT_RUN_LITERAL) {
+            if ((size_t)(end - p) < run.length) {
+                return 0;
+            }
+            p += run.length;
+        }
+    }
+    return p == end && total == patch->size;
+}
+
+// Rebuild a patched input into slot from the cached base
+static int patch_apply(agent_server_t *server, int slot, int base, const uint8_t *p, const agent_patch_t *patch) {
+    agent_cache_entry_t *entry = &server->cached[slot];
+    const agent_cache_entry_t *from = &server->cached[base];
+    if (reserve(&entry->data, &entry->capacity, patch->size) != 0) {
+        return -1;
+    }
+
+    uint8_t *out = entry->data;
+    p += sizeof(agent_patch_t);
+    for (uint32_t i = 0; i < patch->runs; i++) {
+        agent_run_t run;
+        memcpy(&run, p, sizeof(run));
+        p += sizeof(run);
+        if (run.base_offset == AGENT_RUN_LITERAL) {
+            memcpy(out, p, run.length);
+            p += run.length;
+        } else if ((uint64_t)run.base_offset + run.length <= from->size) {
+            memcpy(out, from->data + run.base_offset, run.length);
+        } else {
+            return -1;
+        }
+        out += run.length;
+    }
+
+    entry->size = patch->size;
+    return hash64(entry->data, entry->size, 0) == patch->hash ? 0 : -1;
+}
+
+// Cache one input of a batch and find the bytes to run; NULL if it cannot be rebuilt
+static const uint8_t *cache_input(agent_server_t *server, const agent_input_t *input, const uint8_t *body,
+                                  uint64_t hash, size_t *size) {
+    int base = -1;
+    agent_patch_t patch;
+    if (input->kind == AGENT_INPUT_PATCH) {
+        memcpy(&patch, body, sizeof(patch));
+        base = agent_cache_find(&server->cache, patch.base_hash);
+        if (base >= 0) {
+            agent_cache_touch(&server->cache, base);
+        }
+    }
+
+    int added;
+    int slot = agent_cache_insert(&server->cache, hash, &added);
+    agent_cache_entry_t *entry = &server->cached[slot];
+    if (added) {
+        int ok = input->kind == AGENT_INPUT_PATCH
+            ? base >= 0 && patch_apply(server, slot, base, body, &patch) == 0
+            : reserve(&entry->data, &entry->capacity, input->size) == 0;
+        if (!ok) {
+            server->cache.last_used[slot] = 0;
+            return NULL;
+        }
+        if (input->kind == AGENT_INPUT_FULL) {
+            memcpy(entry->data, body, input->size);
+            entry->size = input->size;
+        }
+    }
+
+    *size = entry->size;
+    return entry->data;
+}
+
+// Run every input of a batch and send back one result per input run
+static int handle_batch(agent_server_t *server, int fd, uint32_t seq, uint32_t map_size,
+                        const uint8_t *payload, uint32_t length) {
+    agent_batch_t batch;
+    if (length < sizeof(batch)) {
+        return send_error(fd, seq, AGENT_ERR_MALFORMED, "short batch header");
+    }
+    memcpy(&batch, payload, sizeof(batch));
+    if (batch.count == 0 || batch.count > AGENT_MAX_BATCH) {
+        return send_error(fd, seq, AGENT_ERR_MALFORMED, "bad batch size");
+    }
+
+    // Check the whole request before running any of it, playing the cache
+    // forward so a patch whose base will be gone is caught here
+    agent_cache_index_t sim = server->cache;
+    uint64_t hashes[AGENT_MAX_BATCH];
+    uint32_t runs = 0;
+    int miss = 0;
+
+    const uint8_t *end = payload + length;
+    const uint8_t *p = payload + sizeof(batch);
+    for (uint32_t i = 0; i < batch.count; i++) {
+        agent_input_t input;
+        if ((size_t)(end - p) < sizeof(input)) {
+            return send_error(fd, seq, AGENT_ERR_MALFORMED, "truncated input header");
+        }
+        memcpy(&input, p, sizeof(input));
+        p += sizeof(input);
+        if ((size_t)(end - p) < input.size) {
+            return send_error(fd, seq, AGENT_ERR_MALFORMED, "truncated input");
+        }
+
+        if (input.kind == AGENT_INPUT_FULL) {
+            hashes[i] = hash64(p, input.size, 0);
+        } else if (input.kind == AGENT_INPUT_PATCH) {
+            agent_patch_t patch;
+            if (!patch_valid(p, input.size, &patch)) {
+                return send_error(fd, seq, AGENT_ERR_MALFORMED, "bad patch");
+            }
+            int base = agent_cache_find(&sim, patch.base_hash);
+            if (base < 0) {
+                miss = 1;
+            } else {
+                agent_cache_touch(&sim, base);
+            }
+            hashes[i] = patch.hash;
+        } else {
+            return send_error(fd, seq, AGENT_ERR_UNSUPPORTED, "unknown input kind");
+        }
+        p += input.size;
+
+        int added;
+        agent_cache_insert(&sim, hashes[i], &added);
+        if (!(input.flags & AGENT_INPUT_CACHE_ONLY)) {
+            runs++;
+        }
+    }
+    if (miss) {
+        return send_error(fd, seq, AGENT_ERR_CACHE_MISS, "patch base not cached");
+    }
+
+    size_t out_len = sizeof(uint32_t);
+    if (reserve(&server->out, &server->out_size, out_len) != 0) {
+        return send_error(fd, seq, AGENT_ERR_INTERNAL, "out of memory");
+    }
+    agent_put_u32(server->out, runs);
+
+    p = payload + sizeof(batch);
+    for (uint32_t i = 0; i < batch.count; i++) {
+        agent_input_t input;
+        memcpy(&input, p, sizeof(input));
+        p += sizeof(input);
+        const uint8_t *body = p;
+        p += input.size;
+
+        size_t size = 0;
+        const uint8_t *data = cache_input(server, &input, body, hashes[i], &size);
+        if (input.flags & AGENT_INPUT_CACHE_ONLY) {
+            continue;
+        }
+
+        agent_result_t result;
+        memset(&result, 0, sizeof(result));
+        memset(server->trace_bits, 0, map_size);
+        if (!data) {
+            result.status = AGENT_STATUS_ERROR;
+        } else {
+            uint64_t start = now_ns();
+            result.status = server->target
+                ? run_harness(server, data, size, batch.timeout_ms, &result.signal)
+                : run_synthetic(server, data, size, &result.signal);
+            result.exec_time_us = (now_ns() - start) / 1000;
+        }
+
+        // No encoding is larger than the dense map
+        if (reserve(&server->out, &server->out_size, out_len + sizeof(result) + map_size) != 0) {
+            return send_error(fd, seq, AGENT_ERR_INTERNAL, "out of memory");
+        }
+
+        result.coverage_size = agent_cov_encode(server->trace_bits, map_size,
+                                                server->out + out_len + sizeof(result),
+                                                &result.coverage_format);
+        memcpy(server->out + out_len, &result, sizeof(result));
+        out_len += sizeof(result) + result.coverage_size;
+    }
+
+    return send_reply(fd, AGENT_MSG_BATCH_RESULT, seq, server->out, out_len);
+}
+
+// Run a shell command and report its exit status
+static int handle_command(int fd, uint32_t seq, uint8_t *payload, uint32_t length) {
+    char command[4096];
+    if (length >= sizeof(command)) {
+        return send_error(fd, seq, AGENT_ERR_MALFORMED, "command too long");
+    }
+    memcpy(command, payload, length);
+    command[length] = '\0';
+
+    int status = system(command);
+    int32_t result = (status != -1 && WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
+    return send_reply(fd, AGENT_MSG_COMMAND_DONE, seq, &result, sizeof(result));
+}
+
+// Serve one connection until BYE or EOF
+int agent_serve(agent_server_t *server, int fd) {
+    if (!server || fd < 0) {
+        return -1;
+    }
+
+    // Harnesses must not inherit the connection
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    uint32_t map_size = server->map_size;
+    for (;;) {
+        agent_frame_t frame;
+        int ret = read_full(fd, &frame, sizeof(frame));
+        if (ret != 0) {
+            return ret > 0 ? 0 : -1;
+        }
+
+        if (frame.magic != AGENT_MAGIC || frame.length > AGENT_MAX_FRAME) {
+            send_error(fd, frame.seq, AGENT_ERR_MALFORMED, "bad frame header");
+            return -1;
+        }
+        if (reserve(&server->buf, &server->buf_size, frame.length) != 0 ||
+            read_full(fd, server->buf, frame.length) != 0) {
+            return -1;
+        }
+
+        switch (frame.type) {
+            case AGENT_MSG_HELLO: {
+                agent_hello_t hello;
+                if (frame.length < sizeof(hello)) {
+                    ret = send_error(fd, frame.seq, AGENT_ERR_MALFORMED, "short hello");
+                    break;
+                }
+                memcpy(&hello, server->buf, sizeof(hello));
+                if (hello.version != AGENT_VERSION) {
+                    ret = send_error(fd, frame.seq, AGENT_ERR_VERSION, "unsupported version");
+                    break;
+                }
+
+                // Maps are powers of two; the smaller side wins
+                map_size = server->map_size;
+                while (map_size > hello.map_size && map_size > 8) {
+                    map_size >>= 1;
+                }
+
+                agent_hello_t reply = {
+                    .version = AGENT_VERSION,
+                    .map_size = map_size,
+                    .max_batch = AGENT_MAX_BATCH,
+                    .cache_slots = AGENT_CACHE_SLOTS
+                };
+                ret = send_reply(fd, AGENT_MSG_HELLO_OK, frame.seq, &reply, sizeof(reply));
+                break;
+            }
+            case AGENT_MSG_EXEC_BATCH:
+                ret = handle_batch(server, fd, frame.seq, map_size, server->buf, frame.length);
+                break;
+            case AGENT_MSG_COMMAND:
+                ret = handle_command(fd, frame.seq, server->buf, frame.length);
+                break;
+            case AGENT_MSG_BYE:
+                return 0;
+            default:
+                ret = send_error(fd, frame.seq, AGENT_ERR_UNSUPPORTED, "unknown message type");
+                break;
+        }
+
+        if (ret != 0) {
+            return -1;
+        }
+    }
+}
+
+// Release the coverage map and buffers
+void agent_server_cleanup(agent_server_t *server) {
+    if (!server) {
+        return;
+    }
+
+    if (server->target) {
+        if (server->trace_bits) {
+            shmdt(server->trace_bits);
+        }
+        if (server->shm_id >= 0) {
+            shmctl(server->shm_id, IPC_RMID, NULL);
+        }
+    } else {
+        free(server->trace_bits);
+    }
+    if (server->input_fd >= 0) {
+        close(server->input_fd);
+        unlink(server->input_path);
+    }
+    free(server->buf);
+    free(server->out);
+    for (int i = 0; i < AGENT_CACHE_SLOTS; i++) {
+        free(server->cached[i].data);
+    }
+
+    memset(server, 0, sizeof(agent_server_t));
+    server->shm_id = -1;
+    server->input_fd = -1;
+}
@@ -4,33 +4,7 @@
 #include <time.h>
 #include <sys/stat.h>
 #include "../../include/fuzzkrieg.h"
-
-// Crash types
-typedef enum {
-    CRASH_TYPE_NULL_PTR,
-    CRASH_TYPE_USE_AFTER_FREE,
-    CRASH_TYPE_DOUBLE_FREE,
-    CRASH_TYPE_BUFFER_OVERFLOW,
-    CRASH_TYPE_INTEGER_OVERFLOW,
-    CRASH_TYPE_TYPE_CONFUSION,
-    CRASH_TYPE_RACE_CONDITION,
-    CRASH_TYPE_KERNEL_PANIC,    // iOS 18 specific
-    CRASH_TYPE_MEMORY_CORRUPTION, // iOS 18 specific
-    CRASH_TYPE_UNKNOWN
-} crash_type_t;
-
-// Crash information structure
-typedef struct {
-    crash_type_t type;
-    char *description;
-    char *stack_trace;
-    char *registers;
-    char *memory_map;
-    uint64_t timestamp;
-    char *testcase_path;
-    char *crash_log_path;
-    char *ios_version;  // Added for iOS version tracking
-} crash_info_t;
+#include "../../include/crash_analyzer.h"
 
 // Initialize crash analyzer
 int crash_analyzer_init(void) {
@@ -210,19 +184,3 @@ int analyze_crash(const char *crash_log, const char *testcase_path) {
 
     return 0;
 }
-
-// Minimize testcase
-int minimize_testcase(const char *testcase_path, const char *crash_log) {
-    if (!testcase_path || !crash_log) {
-        return -1;
-    }
-
-    // TODO: Implement testcase minimization
-    // This will involve:
-    // 1. Reading the testcase
-    // 2. Applying minimization strategies
-    // 3. Verifying crash reproduction
-    // 4. Saving the minimized testcase
-
-    return 0;
-} 
\ No newline at end of file
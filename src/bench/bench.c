@@ -0,0 +1,706 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "../../include/fuzzkrieg.h"
+#include "../../include/executor.h"
+#include "../../include/mutator_advanced.h"
+#include "../../include/crash_analyzer.h"
+#include "../../include/minimizer.h"
+#include "../../include/agent.h"
+#include "../../include/agent_server.h"
+
+// Each benchmark runs for at least this long
+#define BENCH_MIN_NS 200000000ULL
+
+// Input sizes
+#define BENCH_TESTCASE_SIZE 4096
+#define BENCH_MINIMIZE_SIZE 1024
+#define BENCH_EDGE_DENSITY 64   // One edge hit per this many map bytes
+#define BENCH_CHILD_SIZE (64 * 1024)
+#define BENCH_CHILD_FLIPS 4     // Bytes a child differs from its parent in
+#define BENCH_CHILD_BATCH 16
+#define BENCH_CHILD_EDITS 4     // Inserts and deletes in a shifted child
+#define BENCH_CHILD_EDIT_MAX 64 // Bytes each inserts or deletes, at most
+#define BENCH_MAP_FUNCS_COLD 16   // Functions a trace passes through
+#define BENCH_MAP_FUNCS_WARM 256
+#define BENCH_MAP_FUNCS_HOT 2048
+
+// A benchmark runs its operation n times and returns the bytes touched per op
+typedef size_t (*bench_fn)(uint64_t n);
+
+typedef struct {
+    const char *name;
+    bench_fn run;
+} bench_t;
+
+// Shared fixtures
+static rng_t rng;
+static testcase_pool_t pool;
+static testcase_t *tc;
+static uint8_t *raw_map;
+static coverage_t coverage;
+static fuzzer_t fuzzer;
+static char workdir[256];
+static char panic_log[512];
+static char minimize_input[512];
+static agent_client_t agent;
+static pid_t agent_pid = -1;
+static uint8_t *transport_maps[3];       // Cold, warm and hot traces
+static size_t wire_bytes;                // Bytes per op sent over the agent link, if any
+
+// Keep results live so the compiler cannot drop the work
+static volatile uint64_t sink;
+
+// Reset the shared test case to its benchmark size
+static inline void reset_testcase(void) {
+    tc->size = BENCH_TESTCASE_SIZE;
+}
+
+// Mutators
+
+static size_t bench_testcase_mutate(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        reset_testcase();
+        testcase_mutate(tc, &rng);
+    }
+    return BENCH_TESTCASE_SIZE;
+}
+
+static size_t bench_mutate_kernel_struct(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        reset_testcase();
+        mutate_kernel_struct(tc, &rng, &kernel_structs[rng_below(&rng, NUM_KERNEL_STRUCTS)]);
+    }
+    return BENCH_TESTCASE_SIZE;
+}
+
+static size_t bench_mutate_memory_pattern(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        reset_testcase();
+        mutate_memory_pattern(tc, &rng);
+    }
+    return BENCH_TESTCASE_SIZE;
+}
+
+static size_t bench_mutate_syscall(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        reset_testcase();
+        mutate_syscall(tc, &rng);
+    }
+    return BENCH_TESTCASE_SIZE;
+}
+
+static size_t bench_mutate_ioctl(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        reset_testcase();
+        mutate_ioctl(tc, &rng);
+    }
+    return BENCH_TESTCASE_SIZE;
+}
+
+static size_t bench_mutate_mach_msg(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        reset_testcase();
+        mutate_mach_msg(tc, &rng);
+    }
+    return BENCH_TESTCASE_SIZE;
+}
+
+static size_t bench_mutate_vm_operation(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        reset_testcase();
+        mutate_vm_operation(tc, &rng);
+    }
+    return BENCH_TESTCASE_SIZE;
+}
+
+static size_t bench_mutate_task_operation(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        reset_testcase();
+        mutate_task_operation(tc, &rng);
+    }
+    return BENCH_TESTCASE_SIZE;
+}
+
+static size_t bench_mutate_thread_operation(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        reset_testcase();
+        mutate_thread_operation(tc, &rng);
+    }
+    return BENCH_TESTCASE_SIZE;
+}
+
+static size_t bench_testcase_mutate_advanced(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        reset_testcase();
+        testcase_mutate_advanced(tc, &rng);
+    }
+    return BENCH_TESTCASE_SIZE;
+}
+
+// Coverage
+
+static size_t bench_coverage_classify(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        memcpy(coverage.map, raw_map, coverage.map_size);
+        sink += coverage_classify(coverage.map, coverage.map_size);
+    }
+    return coverage.map_size;
+}
+
+static size_t bench_coverage_has_new_bits(uint64_t n) {
+    // Steady state: the virgin map has already seen this trace
+    memcpy(coverage.map, raw_map, coverage.map_size);
+    coverage_classify(coverage.map, coverage.map_size);
+    coverage_has_new_bits(&coverage, coverage.map, coverage.map_size);
+
+    for (uint64_t i = 0; i < n; i++) {
+        sink += coverage_has_new_bits(&coverage, coverage.map, coverage.map_size);
+    }
+    return coverage.map_size;
+}
+
+static size_t bench_coverage_checksum(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        sink += coverage_checksum(coverage.map, coverage.map_size);
+    }
+    return coverage.map_size;
+}
+
+static size_t bench_coverage_update(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        memcpy(coverage.map, raw_map, coverage.map_size);
+        sink += coverage_update(&coverage, coverage.map, coverage.map_size);
+    }
+    return coverage.map_size;
+}
+
+// Mock executor whose coverage is always the benchmark trace
+static int mock_collect_coverage(executor_t *exec, coverage_t *cov) {
+    (void)exec;
+    memcpy(cov->map, raw_map, cov->map_size);
+    return 0;
+}
+
+static const executor_ops_t mock_executor_ops = {
+    .name = "bench",
+    .collect_coverage = mock_collect_coverage
+};
+
+static size_t bench_update_coverage(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        update_coverage(&fuzzer, tc);
+        sink += tc->coverage_count;
+    }
+    return fuzzer.coverage.map_size;
+}
+
+// Hashing
+
+static size_t bench_hash(uint64_t n, size_t size) {
+    testcase_t view = *tc;
+    view.size = size;
+    for (uint64_t i = 0; i < n; i++) {
+        sink += testcase_hash(&view);
+    }
+    return size;
+}
+
+static size_t bench_testcase_hash_64(uint64_t n) {
+    return bench_hash(n, 64);
+}
+
+static size_t bench_testcase_hash_4k(uint64_t n) {
+    return bench_hash(n, 4096);
+}
+
+static size_t bench_testcase_hash_1m(uint64_t n) {
+    return bench_hash(n, MAX_TESTCASE_SIZE);
+}
+
+// Crash analysis
+
+static size_t bench_analyze_crash_log(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        sink += analyze_crash_log(panic_log);
+    }
+
+    struct stat st;
+    return stat(panic_log, &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+// Mock reproducer: the crash needs the marker bytes, wherever they end up
+static int mock_reproducer(const char *testcase_path, const char *crash_log_path, void *ctx) {
+    (void)crash_log_path;
+    (void)ctx;
+
+    FILE *f = fopen(testcase_path, "rb");
+    if (!f) {
+        return 0;
+    }
+
+    uint8_t buf[BENCH_MINIMIZE_SIZE];
+    size_t len = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+
+    for (size_t i = 0; i + 3 <= len; i++) {
+        if (buf[i] == 'B' && buf[i + 1] == 'U' && buf[i + 2] == 'G') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static size_t bench_minimize_testcase(uint64_t n) {
+    minimizer_set_reproducer(mock_reproducer, NULL);
+    for (uint64_t i = 0; i < n; i++) {
+        sink += minimize_testcase(minimize_input, panic_log);
+    }
+    minimizer_set_reproducer(NULL, NULL);
+    return BENCH_MINIMIZE_SIZE;
+}
+
+// Agent round trips, per input, against a synthetic agent over loopback
+
+// Fork a stand-in agent on an ephemeral port and connect to it
+static int agent_start(void) {
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(addr);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, 1) != 0 || getsockname(listen_fd, (struct sockaddr *)&addr, &len) != 0) {
+        return -1;
+    }
+
+    agent_pid = fork();
+    if (agent_pid < 0) {
+        close(listen_fd);
+        return -1;
+    }
+    if (agent_pid == 0) {
+        agent_server_t server;
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0 || agent_server_init(&server, NULL, workdir) != 0) {
+            _exit(1);
+        }
+        agent_serve(&server, fd);
+        agent_server_cleanup(&server);
+        _exit(0);
+    }
+
+    close(listen_fd);
+    return agent_connect_tcp(&agent, "127.0.0.1", ntohs(addr.sin_port), COVERAGE_MAP_SIZE);
+}
+
+static size_t bench_agent_batch(uint64_t n, uint32_t batch) {
+    static agent_exec_t inputs[AGENT_MAX_BATCH];
+    static agent_exec_result_t results[AGENT_MAX_BATCH];
+
+    if (!agent.connected && agent_start() != 0) {
+        fprintf(stderr, "Failed to start agent\n");
+        exit(1);
+    }
+
+    for (uint32_t i = 0; i < batch; i++) {
+        inputs[i].data = tc->data + i * 64;
+        inputs[i].size = BENCH_TESTCASE_SIZE;
+    }
+
+    for (uint64_t i = 0; i < n; i += batch) {
+        uint32_t count = n - i < batch ? (uint32_t)(n - i) : batch;
+        if (agent_exec_batch(&agent, inputs, count, 1000, results) != 0) {
+            fprintf(stderr, "Agent batch failed\n");
+            exit(1);
+        }
+        sink += results[0].coverage_size;
+    }
+    return BENCH_TESTCASE_SIZE;
+}
+
+static size_t bench_agent_batch_1(uint64_t n) {
+    return bench_agent_batch(n, 1);
+}
+
+static size_t bench_agent_batch_16(uint64_t n) {
+    return bench_agent_batch(n, 16);
+}
+
+static size_t bench_agent_batch_64(uint64_t n) {
+    return bench_agent_batch(n, 64);
+}
+
+// Mutated children of one parent, sent in full or as patches; shifted
+// children have bytes inserted and deleted mid-buffer instead of flipped
+static size_t bench_agent_children(uint64_t n, int patch, int shift) {
+    static uint8_t children[BENCH_CHILD_BATCH][BENCH_CHILD_SIZE + BENCH_CHILD_EDITS * BENCH_CHILD_EDIT_MAX];
+    static agent_exec_t inputs[BENCH_CHILD_BATCH];
+    static agent_exec_result_t results[BENCH_CHILD_BATCH];
+
+    if (!agent.connected && agent_start() != 0) {
+        fprintf(stderr, "Failed to start agent\n");
+        exit(1);
+    }
+    uint32_t cache_slots = agent.cache_slots;
+    if (!patch) {
+        agent.cache_slots = 0;
+    }
+
+    uint64_t wire_start = agent.wire_bytes;
+    for (uint64_t i = 0; i < n; i += BENCH_CHILD_BATCH) {
+        uint32_t count = n - i < BENCH_CHILD_BATCH ? (uint32_t)(n - i) : BENCH_CHILD_BATCH;
+        for (uint32_t j = 0; j < count; j++) {
+            size_t size = BENCH_CHILD_SIZE;
+            memcpy(children[j], tc->data, size);
+            for (int k = 0; k < BENCH_CHILD_EDITS; k++) {
+                if (!shift) {
+                    children[j][rng_below(&rng, BENCH_CHILD_SIZE)] ^= 0xff;
+                    continue;
+                }
+                size_t at = rng_below(&rng, size);
+                size_t len = 1 + rng_below(&rng, BENCH_CHILD_EDIT_MAX);
+                if (rng_below(&rng, 2) || at + len > size) {
+                    memmove(children[j] + at + len, children[j] + at, size - at);
+                    for (size_t b = 0; b < len; b++) {
+                        children[j][at + b] = rng_next(&rng);
+                    }
+                    size += len;
+                } else {
+                    memmove(children[j] + at, children[j] + at + len, size - at - len);
+                    size -= len;
+                }
+            }
+            inputs[j].data = children[j];
+            inputs[j].size = size;
+            inputs[j].base = tc->data;
+            inputs[j].base_size = BENCH_CHILD_SIZE;
+        }
+        if (agent_exec_batch(&agent, inputs, count, 1000, results) != 0) {
+            fprintf(stderr, "Agent batch failed\n");
+            exit(1);
+        }
+
+        // A patch the agent rebuilt wrong fails its hash and is not run
+        for (uint32_t j = 0; j < count; j++) {
+            if (results[j].status == AGENT_STATUS_ERROR) {
+                fprintf(stderr, "Agent could not rebuild child %u\n", j);
+                exit(1);
+            }
+        }
+    }
+
+    agent.cache_slots = cache_slots;
+    wire_bytes = (agent.wire_bytes - wire_start) / n;
+    return BENCH_CHILD_SIZE;
+}
+
+static size_t bench_agent_children_full(uint64_t n) {
+    return bench_agent_children(n, 0, 0);
+}
+
+static size_t bench_agent_children_patch(uint64_t n) {
+    return bench_agent_children(n, 1, 0);
+}
+
+static size_t bench_agent_children_shifted(uint64_t n) {
+    return bench_agent_children(n, 1, 1);
+}
+
+// Coverage transport: the agent's encoding of traces of growing heat
+
+static size_t bench_coverage_encode(uint64_t n, const uint8_t *map) {
+    static uint8_t out[COVERAGE_MAP_SIZE];
+    uint8_t format;
+    size_t size = 0;
+
+    for (uint64_t i = 0; i < n; i++) {
+        size = agent_cov_encode(map, COVERAGE_MAP_SIZE, out, &format);
+        sink += size;
+    }
+    wire_bytes = size;
+    return COVERAGE_MAP_SIZE;
+}
+
+static size_t bench_coverage_decode(uint64_t n, const uint8_t *map) {
+    static uint8_t out[COVERAGE_MAP_SIZE];
+    agent_exec_result_t result = { .coverage = out };
+    result.coverage_size = agent_cov_encode(map, COVERAGE_MAP_SIZE, out, &result.coverage_format);
+
+    for (uint64_t i = 0; i < n; i++) {
+        sink += agent_coverage_decode(&result, coverage.map, coverage.map_size);
+    }
+    wire_bytes = result.coverage_size;
+    return COVERAGE_MAP_SIZE;
+}
+
+static size_t bench_coverage_encode_cold(uint64_t n) {
+    return bench_coverage_encode(n, transport_maps[0]);
+}
+
+static size_t bench_coverage_encode_warm(uint64_t n) {
+    return bench_coverage_encode(n, transport_maps[1]);
+}
+
+static size_t bench_coverage_encode_hot(uint64_t n) {
+    return bench_coverage_encode(n, transport_maps[2]);
+}
+
+static size_t bench_coverage_decode_cold(uint64_t n) {
+    return bench_coverage_decode(n, transport_maps[0]);
+}
+
+static size_t bench_coverage_decode_warm(uint64_t n) {
+    return bench_coverage_decode(n, transport_maps[1]);
+}
+
+static size_t bench_coverage_decode_hot(uint64_t n) {
+    return bench_coverage_decode(n, transport_maps[2]);
+}
+
+static const bench_t benches[] = {
+    { "testcase_mutate", bench_testcase_mutate },
+    { "mutate_kernel_struct", bench_mutate_kernel_struct },
+    { "mutate_memory_pattern", bench_mutate_memory_pattern },
+    { "mutate_syscall", bench_mutate_syscall },
+    { "mutate_ioctl", bench_mutate_ioctl },
+    { "mutate_mach_msg", bench_mutate_mach_msg },
+    { "mutate_vm_operation", bench_mutate_vm_operation },
+    { "mutate_task_operation", bench_mutate_task_operation },
+    { "mutate_thread_operation", bench_mutate_thread_operation },
+    { "testcase_mutate_advanced", bench_testcase_mutate_advanced },
+    { "coverage_classify", bench_coverage_classify },
+    { "coverage_has_new_bits", bench_coverage_has_new_bits },
+    { "coverage_checksum", bench_coverage_checksum },
+    { "coverage_update", bench_coverage_update },
+    { "update_coverage", bench_update_coverage },
+    { "testcase_hash_64", bench_testcase_hash_64 },
+    { "testcase_hash_4k", bench_testcase_hash_4k },
+    { "testcase_hash_1m", bench_testcase_hash_1m },
+    { "analyze_crash_log", bench_analyze_crash_log },
+    { "minimize_testcase", bench_minimize_testcase },
+    { "agent_batch_1", bench_agent_batch_1 },
+    { "agent_batch_16", bench_agent_batch_16 },
+    { "agent_batch_64", bench_agent_batch_64 },
+    { "agent_children_full", bench_agent_children_full },
+    { "agent_children_patch", bench_agent_children_patch },
+    { "agent_children_shifted", bench_agent_children_shifted },
+    { "coverage_encode_cold", bench_coverage_encode_cold },
+    { "coverage_encode_warm", bench_coverage_encode_warm },
+    { "coverage_encode_hot", bench_coverage_encode_hot },
+    { "coverage_decode_cold", bench_coverage_decode_cold },
+    { "coverage_decode_warm", bench_coverage_decode_warm },
+    { "coverage_decode_hot", bench_coverage_decode_hot }
+};
+
+#define NUM_BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+// Write a synthetic panic log shaped like a real one
+static int write_panic_log(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return -1;
+    }
+
+    fprintf(f, "panic(cpu 1 caller 0xfffffff0081b2c44): Kernel data abort.\n");
+    fprintf(f, "Debugger message: panic\nOS version: 22A3354\nKernel version: Darwin Kernel Version 24.0.0\n");
+    fprintf(f, "Exception Type: EXC_BAD_ACCESS (SIGSEGV) KERN_INVALID_ADDRESS at 0x0000000000000018\n\n");
+    fprintf(f, "Kernel State:\n");
+    for (int i = 0; i < 29; i++) {
+        fprintf(f, "  x%-2d: 0x%016llx\n", i, 0xfffffff000000000ULL + i * 0x1000);
+    }
+    fprintf(f, "\nKernel Panic Stack:\n");
+    for (int i = 0; i < 64; i++) {
+        fprintf(f, "%-3d kernel.release.t8101  0x%016llx 0x%016llx + %d\n",
+                i, 0xfffffff007000000ULL + i * 0x40, 0xfffffff007000000ULL, i * 0x40);
+    }
+    fprintf(f, "\nLoaded kexts:\n");
+    for (int i = 0; i < 128; i++) {
+        fprintf(f, "com.apple.driver.Bench%d\t1.0.%d\n", i, i);
+    }
+
+    fclose(f);
+    return 0;
+}
+
+// Fill a trace the way trace-pc-guard numbers edges: each function's edges
+// are consecutive, and a run reaches some of them, mostly once
+static void build_transport_map(uint8_t *map, uint32_t functions) {
+    for (uint32_t f = 0; f < functions; f++) {
+        size_t start = rng_below_size(&rng, COVERAGE_MAP_SIZE);
+        size_t length = 4 + rng_below(&rng, 60);
+        for (size_t i = start; i < start + length && i < COVERAGE_MAP_SIZE; i++) {
+            if (rng_below(&rng, 2)) {
+                map[i] = rng_below(&rng, 4) ? 1 : 1 + rng_below(&rng, 255);
+            }
+        }
+    }
+}
+
+// Build the fixtures in a scratch directory
+static int setup(void) {
+    rng_seed(&rng, 1);
+
+    snprintf(workdir, sizeof(workdir), "/tmp/fuzzkrieg_bench_XXXXXX");
+    if (!mkdtemp(workdir) || chdir(workdir) != 0) {
+        fprintf(stderr, "Failed to create bench directory\n");
+        return -1;
+    }
+    mkdir("crashes", 0755);
+    mkdir("crashes/testcases", 0755);
+
+    // A pooled buffer has room for any size the mutators grow to
+    if (testcase_pool_init(&pool, 1) != 0 || !(tc = testcase_pool_acquire(&pool))) {
+        return -1;
+    }
+    rng_fill(&rng, tc->data, MAX_TESTCASE_SIZE);
+    tc->size = BENCH_TESTCASE_SIZE;
+
+    // Sparse raw trace with a spread of hit counts
+    if (coverage_init(&coverage) != 0 || !(raw_map = calloc(1, coverage.map_size))) {
+        return -1;
+    }
+    for (size_t i = 0; i < coverage.map_size / BENCH_EDGE_DENSITY; i++) {
+        raw_map[rng_below_size(&rng, coverage.map_size)] = 1 + rng_below(&rng, 255);
+    }
+
+    static const uint32_t functions[3] = { BENCH_MAP_FUNCS_COLD, BENCH_MAP_FUNCS_WARM, BENCH_MAP_FUNCS_HOT };
+    for (int i = 0; i < 3; i++) {
+        if (!(transport_maps[i] = calloc(1, COVERAGE_MAP_SIZE))) {
+            return -1;
+        }
+        build_transport_map(transport_maps[i], functions[i]);
+    }
+
+    // Just enough of a fuzzer for update_coverage()
+    if (coverage_init(&fuzzer.coverage) != 0 ||
+        queue_init(&fuzzer.queue, fuzzer.coverage.map_size, SCHEDULE_FAST) != 0 ||
+        hashset_init(&fuzzer.path_hashes, 1024) != 0) {
+        return -1;
+    }
+    fuzzer.executor.ops = &mock_executor_ops;
+
+    snprintf(panic_log, sizeof(panic_log), "%s/panic.log", workdir);
+    if (write_panic_log(panic_log) != 0) {
+        return -1;
+    }
+
+    // Random input with the crash marker in the middle
+    snprintf(minimize_input, sizeof(minimize_input), "%s/crash_input", workdir);
+    testcase_t input = { .data = tc->data, .size = BENCH_MINIMIZE_SIZE };
+    memcpy(input.data + BENCH_MINIMIZE_SIZE / 2, "BUG", 3);
+    if (testcase_save(&input, minimize_input) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Stop the agent and remove the scratch directory
+static void teardown(void) {
+    if (agent_pid > 0) {
+        agent_close(&agent);
+        waitpid(agent_pid, NULL, 0);
+    }
+    if (workdir[0]) {
+        char cmd[512];
+        snprintf(cmd, sizeof(cmd), "rm -rf '%s'", workdir);
+        system(cmd);
+    }
+}
+
+// Run one benchmark long enough to time it, doubling the op count each try
+static void run_bench(const bench_t *bench, const char *label) {
+    uint64_t n = 1;
+    uint64_t elapsed;
+    size_t bytes;
+
+    wire_bytes = 0;
+    for (;;) {
+        uint64_t start = stats_now_ns();
+        bytes = bench->run(n);
+        elapsed = stats_now_ns() - start;
+        if (elapsed >= BENCH_MIN_NS || n >= (1ULL << 40)) {
+            break;
+        }
+        n *= 2;
+    }
+
+    double ns_per_op = (double)elapsed / n;
+    printf("{\"bench\":\"%s\",\"label\":\"%s\",\"kernel\":\"%s\",\"ops\":%llu,"
+           "\"ns_per_op\":%.2f,\"bytes_per_op\":%zu,\"mb_per_s\":%.2f",
+           bench->name, label, coverage_kernel(), (unsigned long long)n, ns_per_op, bytes,
+           ns_per_op > 0 ? bytes / ns_per_op * 1e3 : 0.0);
+    if (wire_bytes) {
+        printf(",\"wire_bytes_per_op\":%zu", wire_bytes);
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+// Print usage information
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options] [filter]\n", prog);
+    printf("Runs every benchmark whose name contains the filter, one JSON object per line.\n");
+    printf("bytes_per_op is the input each op processes; wire_bytes_per_op, where\n");
+    printf("given, is what it takes on the agent link.\n");
+    printf("Options:\n");
+    printf("  -l, --label <text>     Label for the results, e.g. a commit id\n");
+    printf("  -L, --list             List benchmarks\n");
+    printf("  -h, --help             Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *label = "";
+
+    signal(SIGPIPE, SIG_IGN);
+
+    static struct option long_options[] = {
+        {"label", required_argument, 0, 'l'},
+        {"list", no_argument, 0, 'L'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "l:Lh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'l':
+                label = optarg;
+                break;
+            case 'L':
+                for (size_t i = 0; i < NUM_BENCHES; i++) {
+                    printf("%s\n", benches[i].name);
+                }
+                return 0;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    const char *filter = optind < argc ? argv[optind] : NULL;
+
+    if (setup() != 0) {
+        fprintf(stderr, "Failed to set up benchmarks\n");
+        teardown();
+        return 1;
+    }
+
+    for (size_t i = 0; i < NUM_BENCHES; i++) {
+        if (!filter || strstr(benches[i].name, filter)) {
+            run_bench(&benches[i], label);
+        }
+    }
+
+    teardown();
+    return 0;
+}
@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../../include/fuzzkrieg.h"
+
+#define CHECKPOINT_MAGIC 0x464b434bu    // "FKCK"
+#define CHECKPOINT_VERSION 2
+
+// Checkpoint header; the sections follow in the order listed
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t checksum;        // Chained hash64 of every section
+    uint64_t map_size;
+    uint64_t seed;
+    uint64_t rng[4];
+    uint64_t exec_count;
+    uint64_t hang_count;
+    uint64_t corpus_count;    // Records in the corpus store; later ones are rerun
+    uint32_t exec_timeout;    // Calibrated timeout in ms, 0 if not yet
+    uint32_t iteration;
+    uint32_t crash_count;
+    uint32_t unique_paths;
+    uint32_t total_hits;
+    uint32_t queue_count;
+    uint32_t queue_current;
+    uint32_t queue_energy_left;
+    uint32_t queue_cycles;
+    uint64_t path_count;
+    strategy_stats_t strategies[NUM_STRATEGIES];
+    // uint8_t virgin[map_size];
+    // uint32_t edge_hits[map_size];
+    // checkpoint_entry_t entries[queue_count];
+    // uint64_t paths[path_count];
+} checkpoint_header_t;
+
+// Queue entry metadata; the data itself lives in the corpus store
+typedef struct {
+    uint64_t offset;          // Offset of the data in the corpus store
+    uint64_t size;
+    uint64_t exec_time;
+    uint64_t path_hash;
+    uint32_t coverage_count;
+    uint32_t rare_edge;
+    uint32_t fuzz_level;
+    uint32_t depth;
+} checkpoint_entry_t;
+
+// Write a whole buffer
+static int write_full(int fd, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Make a rename in the output directory durable
+static void sync_dir(const char *dir) {
+    int fd = open(dir, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+// Write the fuzzer state to a new file and atomically replace the checkpoint
+int fuzzer_checkpoint(fuzzer_t *fuzzer) {
+    if (!fuzzer || !fuzzer->coverage.virgin) {
+        return -1;
+    }
+
+    // Queue entries refer to the corpus store, so it must hit the disk first
+    if (corpus_sync(&fuzzer->corpus) != 0) {
+        fprintf(stderr, "Failed to sync corpus store\n");
+        return -1;
+    }
+
+    seed_queue_t *queue = &fuzzer->queue;
+    size_t map_size = fuzzer->coverage.map_size;
+
+    checkpoint_entry_t *entries = calloc(queue->count ? queue->count : 1, sizeof(checkpoint_entry_t));
+    uint64_t *paths = malloc((fuzzer->path_hashes.count ? fuzzer->path_hashes.count : 1) * sizeof(uint64_t));
+    if (!entries || !paths) {
+        free(entries);
+        free(paths);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < queue->count; i++) {
+        const queue_entry_t *entry = &queue->entries[i];
+        entries[i].offset = (uint64_t)(entry->data - fuzzer->corpus.data);
+        entries[i].size = entry->size;
+        entries[i].exec_time = entry->exec_time;
+        entries[i].path_hash = entry->path_hash;
+        entries[i].coverage_count = entry->coverage_count;
+        entries[i].rare_edge = entry->rare_edge;
+        entries[i].fuzz_level = entry->fuzz_level;
+        entries[i].depth = entry->depth;
+    }
+
+    size_t path_count = 0;
+    for (size_t i = 0; i < fuzzer->path_hashes.capacity; i++) {
+        if (fuzzer->path_hashes.slots[i]) {
+            paths[path_count++] = fuzzer->path_hashes.slots[i];
+        }
+    }
+
+    checkpoint_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CHECKPOINT_MAGIC;
+    header.version = CHECKPOINT_VERSION;
+    header.map_size = map_size;
+    header.seed = fuzzer->config.seed;
+    memcpy(header.rng, fuzzer->rng.s, sizeof(header.rng));
+    header.exec_count = fuzzer->exec_count;
+    header.hang_count = fuzzer->hang_count;
+    header.corpus_count = corpus_count(&fuzzer->corpus);
+    header.exec_timeout = fuzzer->exec_timeout;
+    header.iteration = fuzzer->iteration;
+    header.crash_count = fuzzer->crash_count;
+    header.unique_paths = fuzzer->coverage.unique_paths;
+    header.total_hits = fuzzer->coverage.total_hits;
+    header.queue_count = queue->count;
+    header.queue_current = queue->current;
+    header.queue_energy_left = queue->energy_left;
+    header.queue_cycles = queue->cycles;
+    header.path_count = path_count;
+    memcpy(header.strategies, fuzzer->strategies, sizeof(header.strategies));
+
+    uint64_t checksum = 0;
+    checksum = hash64(fuzzer->coverage.virgin, map_size, checksum);
+    checksum = hash64(queue->edge_hits, map_size * sizeof(uint32_t), checksum);
+    checksum = hash64(entries, queue->count * sizeof(checkpoint_entry_t), checksum);
+    checksum = hash64(paths, path_count * sizeof(uint64_t), checksum);
+    header.checksum = checksum;
+
+    char path[512], tmp_path[sizeof(path) + sizeof(".tmp")];
+    snprintf(path, sizeof(path), "%s/%s", fuzzer->config.output_dir, CHECKPOINT_FILE);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    int ret = -1;
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        if (write_full(fd, &header, sizeof(header)) == 0 &&
+            write_full(fd, fuzzer->coverage.virgin, map_size) == 0 &&
+            write_full(fd, queue->edge_hits, map_size * sizeof(uint32_t)) == 0 &&
+            write_full(fd, entries, queue->count * sizeof(checkpoint_entry_t)) == 0 &&
+            write_full(fd, paths, path_count * sizeof(uint64_t)) == 0 &&
+            fsync(fd) == 0) {
+            ret = 0;
+        }
+        close(fd);
+    }
+
+    free(entries);
+    free(paths);
+
+    // The old checkpoint stays in place until the new one is complete
+    if (ret != 0 || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Failed to write checkpoint %s\n", path);
+        unlink(tmp_path);
+        return -1;
+    }
+    sync_dir(fuzzer->config.output_dir);
+
+    fuzzer->last_checkpoint = time(NULL);
+    return 0;
+}
+
+// Restore the state from a mapped checkpoint
+static int restore_checkpoint(fuzzer_t *fuzzer, const uint8_t *base, size_t size) {
+    const checkpoint_header_t *header = (const checkpoint_header_t *)base;
+    if (size < sizeof(checkpoint_header_t) ||
+        header->magic != CHECKPOINT_MAGIC || header->version != CHECKPOINT_VERSION) {
+        fprintf(stderr, "Checkpoint is not a fuzzkrieg checkpoint\n");
+        return -1;
+    }
+
+    size_t map_size = fuzzer->coverage.map_size;
+    if (header->map_size != map_size) {
+        fprintf(stderr, "Checkpoint map size %llu does not match %zu\n",
+                (unsigned long long)header->map_size, map_size);
+        return -1;
+    }
+
+    // Sections, in file order
+    const uint8_t *virgin = base + sizeof(checkpoint_header_t);
+    const uint32_t *edge_hits = (const uint32_t *)(virgin + map_size);
+    const checkpoint_entry_t *entries = (const checkpoint_entry_t *)(edge_hits + map_size);
+    const uint64_t *paths = (const uint64_t *)(entries + header->queue_count);
+
+    size_t expected = sizeof(checkpoint_header_t) + map_size + map_size * sizeof(uint32_t) +
+                      header->queue_count * sizeof(checkpoint_entry_t) +
+                      header->path_count * sizeof(uint64_t);
+    if (size != expected) {
+        fprintf(stderr, "Checkpoint is truncated\n");
+        return -1;
+    }
+
+    uint64_t checksum = 0;
+    checksum = hash64(virgin, map_size, checksum);
+    checksum = hash64(edge_hits, map_size * sizeof(uint32_t), checksum);
+    checksum = hash64(entries, header->queue_count * sizeof(checkpoint_entry_t), checksum);
+    checksum = hash64(paths, header->path_count * sizeof(uint64_t), checksum);
+    if (checksum != header->checksum) {
+        fprintf(stderr, "Checkpoint checksum mismatch\n");
+        return -1;
+    }
+
+    // Every queue entry must point at committed corpus data
+    uint64_t corpus_size = fuzzer->corpus.header ? fuzzer->corpus.header->data_size : 0;
+    if (header->corpus_count > corpus_count(&fuzzer->corpus)) {
+        fprintf(stderr, "Checkpoint refers to missing corpus data\n");
+        return -1;
+    }
+    for (uint32_t i = 0; i < header->queue_count; i++) {
+        if (entries[i].size == 0 || entries[i].offset + entries[i].size > corpus_size ||
+            entries[i].rare_edge >= map_size) {
+            fprintf(stderr, "Checkpoint refers to missing corpus data\n");
+            return -1;
+        }
+    }
+
+    // Coverage and edge frequencies
+    memcpy(fuzzer->coverage.virgin, virgin, map_size);
+    memcpy(fuzzer->queue.edge_hits, edge_hits, map_size * sizeof(uint32_t));
+    fuzzer->coverage.unique_paths = header->unique_paths;
+    fuzzer->coverage.total_hits = header->total_hits;
+
+    // Queue entries, viewing the corpus store
+    for (uint32_t i = 0; i < header->queue_count; i++) {
+        queue_entry_t entry = {
+            .data = fuzzer->corpus.data + entries[i].offset,
+            .size = entries[i].size,
+            .exec_time = entries[i].exec_time,
+            .path_hash = entries[i].path_hash,
+            .coverage_count = entries[i].coverage_count,
+            .rare_edge = entries[i].rare_edge,
+            .fuzz_level = entries[i].fuzz_level,
+            .depth = entries[i].depth
+        };
+        if (queue_restore(&fuzzer->queue, &entry) != 0) {
+            return -1;
+        }
+    }
+    fuzzer->queue.current = header->queue_current;
+    fuzzer->queue.energy_left = header->queue_energy_left;
+    fuzzer->queue.cycles = header->queue_cycles;
+    if (fuzzer->queue.current != UINT32_MAX && fuzzer->queue.current >= fuzzer->queue.count) {
+        fuzzer->queue.current = UINT32_MAX;
+        fuzzer->queue.energy_left = 0;
+    }
+
+    // Known paths
+    for (uint64_t i = 0; i < header->path_count; i++) {
+        if (hashset_insert(&fuzzer->path_hashes, paths[i]) < 0) {
+            return -1;
+        }
+    }
+
+    // Generator and counters
+    fuzzer->config.seed = header->seed;
+    memcpy(fuzzer->rng.s, header->rng, sizeof(fuzzer->rng.s));
+    fuzzer->exec_count = header->exec_count;
+    fuzzer->hang_count = header->hang_count;
+    fuzzer->iteration = header->iteration;
+    fuzzer->crash_count = header->crash_count;
+    memcpy(fuzzer->strategies, header->strategies, sizeof(fuzzer->strategies));
+
+    // Keep the calibrated timeout unless -T sets one
+    if (!fuzzer->config.timeout) {
+        fuzzer->exec_timeout = header->exec_timeout;
+    }
+
+    // Test cases saved after this checkpoint are in the store but not in
+    // the queue or the coverage above; they run again first
+    fuzzer->requeue_next = header->corpus_count;
+    fuzzer->requeue_end = corpus_count(&fuzzer->corpus);
+
+    return 0;
+}
+
+// Load the checkpoint from the output directory
+int fuzzer_resume(fuzzer_t *fuzzer) {
+    if (!fuzzer) {
+        return -1;
+    }
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", fuzzer->config.output_dir, CHECKPOINT_FILE);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open checkpoint %s\n", path);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "Failed to read checkpoint %s\n", path);
+        close(fd);
+        return -1;
+    }
+
+    // Map it rather than reading it; the virgin map and edge hits are copied straight out
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Failed to map checkpoint %s\n", path);
+        return -1;
+    }
+
+    int ret = restore_checkpoint(fuzzer, base, st.st_size);
+    munmap(base, st.st_size);
+    return ret;
+}
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../../include/corpus.h"
+
+// Index records are added in steps of this many
+#define INDEX_GROW_RECORDS 4096
+
+// The index mapping covers the header and every possible record
+#define INDEX_MAP_SIZE (sizeof(corpus_header_t) + (size_t)CORPUS_MAX_ENTRIES * sizeof(corpus_record_t))
+
+// Open a file of the store and return its descriptor and length
+static int open_store_file(const char *dir, const char *name, uint64_t *size) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    *size = (uint64_t)st.st_size;
+    return fd;
+}
+
+// Grow a file to at least the given length, in steps
+static int grow_file(int fd, uint64_t *file_size, uint64_t needed, uint64_t step) {
+    if (needed <= *file_size) {
+        return 0;
+    }
+
+    uint64_t size = (needed + step - 1) / step * step;
+    if (ftruncate(fd, (off_t)size) != 0) {
+        return -1;
+    }
+
+    *file_size = size;
+    return 0;
+}
+
+// Open or create the store in a directory
+int corpus_open(corpus_t *corpus, const char *dir) {
+    if (!corpus || !dir) {
+        return -1;
+    }
+
+    memset(corpus, 0, sizeof(corpus_t));
+    corpus->data_fd = -1;
+    corpus->index_fd = -1;
+
+    corpus->data_fd = open_store_file(dir, CORPUS_DATA_FILE, &corpus->data_file_size);
+    corpus->index_fd = open_store_file(dir, CORPUS_INDEX_FILE, &corpus->index_file_size);
+    if (corpus->data_fd < 0 || corpus->index_fd < 0) {
+        fprintf(stderr, "Failed to open corpus store in %s\n", dir);
+        corpus_close(corpus);
+        return -1;
+    }
+
+    // A new index gets its header and a first batch of records
+    int fresh = corpus->index_file_size < sizeof(corpus_header_t);
+    if (fresh && grow_file(corpus->index_fd, &corpus->index_file_size, sizeof(corpus_header_t),
+                           INDEX_GROW_RECORDS * sizeof(corpus_record_t)) != 0) {
+        corpus_close(corpus);
+        return -1;
+    }
+
+    // Reserve the full range up front; the files grow underneath the mappings
+    void *index = mmap(NULL, INDEX_MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, corpus->index_fd, 0);
+    void *data = mmap(NULL, CORPUS_MAX_DATA, PROT_READ | PROT_WRITE, MAP_SHARED, corpus->data_fd, 0);
+    if (index == MAP_FAILED || data == MAP_FAILED) {
+        fprintf(stderr, "Failed to map corpus store\n");
+        if (index != MAP_FAILED) {
+            munmap(index, INDEX_MAP_SIZE);
+        }
+        if (data != MAP_FAILED) {
+            munmap(data, CORPUS_MAX_DATA);
+        }
+        corpus_close(corpus);
+        return -1;
+    }
+
+    corpus->header = index;
+    corpus->records = (corpus_record_t *)(corpus->header + 1);
+    corpus->data = data;
+
+    if (fresh) {
+        corpus->header->magic = CORPUS_MAGIC;
+        corpus->header->version = CORPUS_VERSION;
+        corpus->header->count = 0;
+        corpus->header->data_size = 0;
+        return 0;
+    }
+
+    // Only trust what the header has committed
+    corpus_header_t *header = corpus->header;
+    if (header->magic != CORPUS_MAGIC || header->version != CORPUS_VERSION ||
+        header->count > CORPUS_MAX_ENTRIES ||
+        header->data_size > corpus->data_file_size ||
+        sizeof(corpus_header_t) + header->count * sizeof(corpus_record_t) > corpus->index_file_size) {
+        fprintf(stderr, "Corpus store in %s is corrupt\n", dir);
+        corpus_close(corpus);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Unmap and close the store
+void corpus_close(corpus_t *corpus) {
+    if (!corpus) {
+        return;
+    }
+
+    if (corpus->header) {
+        munmap(corpus->header, INDEX_MAP_SIZE);
+    }
+    if (corpus->data) {
+        munmap(corpus->data, CORPUS_MAX_DATA);
+    }
+    if (corpus->index_fd >= 0) {
+        close(corpus->index_fd);
+    }
+    if (corpus->data_fd >= 0) {
+        close(corpus->data_fd);
+    }
+
+    memset(corpus, 0, sizeof(corpus_t));
+    corpus->data_fd = -1;
+    corpus->index_fd = -1;
+}
+
+// Flush committed data and records to disk
+int corpus_sync(corpus_t *corpus) {
+    if (!corpus || !corpus->header) {
+        return -1;
+    }
+
+    // Data before the index, so a synced record never points past synced data
+    size_t data_size = corpus->header->data_size;
+    if (data_size > 0 && msync(corpus->data, data_size, MS_SYNC) != 0) {
+        return -1;
+    }
+
+    size_t index_size = sizeof(corpus_header_t) + corpus->header->count * sizeof(corpus_record_t);
+    if (msync(corpus->header, index_size, MS_SYNC) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Append a test case; returns its index or -1
+int64_t corpus_append(corpus_t *corpus, const uint8_t *data, size_t size, uint64_t hash,
+                      uint64_t exec_time, uint32_t coverage_count) {
+    if (!corpus || !corpus->header || !data || size == 0) {
+        return -1;
+    }
+
+    corpus_header_t *header = corpus->header;
+    if (header->count >= CORPUS_MAX_ENTRIES || header->data_size + size > CORPUS_MAX_DATA) {
+        fprintf(stderr, "Corpus store is full\n");
+        return -1;
+    }
+
+    uint64_t offset = header->data_size;
+    uint64_t index = header->count;
+
+    if (grow_file(corpus->data_fd, &corpus->data_file_size, offset + size, CORPUS_GROW_SIZE) != 0 ||
+        grow_file(corpus->index_fd, &corpus->index_file_size,
+                  sizeof(corpus_header_t) + (index + 1) * sizeof(corpus_record_t),
+                  INDEX_GROW_RECORDS * sizeof(corpus_record_t)) != 0) {
+        fprintf(stderr, "Failed to grow corpus store\n");
+        return -1;
+    }
+
+    // Data first, then the record, then the header commits both
+    memcpy(corpus->data + offset, data, size);
+
+    corpus_record_t *record = &corpus->records[index];
+    record->offset = offset;
+    record->size = size;
+    record->hash = hash;
+    record->exec_time = exec_time;
+    record->coverage_count = coverage_count;
+    record->reserved = 0;
+
+    header->data_size = offset + size;
+    header->count = index + 1;
+
+    return (int64_t)index;
+}
+
+// Number of stored test cases
+uint32_t corpus_count(const corpus_t *corpus) {
+    if (!corpus || !corpus->header) {
+        return 0;
+    }
+
+    return (uint32_t)corpus->header->count;
+}
+
+// Index record of a stored test case
+const corpus_record_t *corpus_record(const corpus_t *corpus, uint32_t index) {
+    if (index >= corpus_count(corpus)) {
+        return NULL;
+    }
+
+    return &corpus->records[index];
+}
+
+// View of a stored test case's data
+const uint8_t *corpus_data(const corpus_t *corpus, uint32_t index, size_t *size) {
+    const corpus_record_t *record = corpus_record(corpus, index);
+    if (!record) {
+        return NULL;
+    }
+
+    if (size) {
+        *size = record->size;
+    }
+    return corpus->data + record->offset;
+}
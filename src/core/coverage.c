@@ -0,0 +1,573 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/fuzzkrieg.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COVERAGE_X86 1
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define COVERAGE_NEON 1
+#endif
+
+// Hit count buckets, as in AFL: 1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+
+static uint8_t count_class_lookup8[256];
+static uint16_t count_class_lookup16[65536];
+
+// Nibble tables for the shuffle-based kernels: a byte with a non-zero
+// high nibble is bucketed by the high nibble, otherwise by the low one
+static const uint8_t bucket_lo_nibble[16] = {
+    0, 1, 2, 4, 8, 8, 8, 8, 16, 16, 16, 16, 16, 16, 16, 16
+};
+static const uint8_t bucket_hi_nibble[16] = {
+    0, 32, 64, 64, 64, 64, 64, 64, 128, 128, 128, 128, 128, 128, 128, 128
+};
+
+// Path checksum: eight 64-bit lanes over 64-byte stripes, with lane keys
+// advanced every stripe so identical stripes at different offsets differ
+#define CHECKSUM_STRIPE 64
+#define CHECKSUM_STEP 0x9e3779b97f4a7c15ULL
+
+static const uint64_t checksum_keys[8] = {
+    0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL, 0xdb979083e96dd4deULL, 0x1f67b3b7a4a44072ULL,
+    0x78e5c0cc4ee679cbULL, 0x2172ffcc7dd05a82ULL, 0x8e2443f7744608b8ULL, 0x4c263a81e69035e0ULL
+};
+
+// Classification, comparison and checksum kernels
+typedef uint32_t (*classify_fn)(uint8_t *map, size_t size);
+typedef int (*compare_fn)(uint8_t *virgin, const uint8_t *map, size_t size);
+typedef uint64_t (*checksum_fn)(const uint8_t *map, size_t size);
+
+static classify_fn classify_kernel;
+static compare_fn compare_kernel;
+static checksum_fn checksum_kernel;
+static const char *kernel_name;
+
+// Build the bucket lookup tables
+static void init_count_class(void) {
+    for (int i = 0; i < 256; i++) {
+        uint8_t b;
+        if (i == 0) b = 0;
+        else if (i == 1) b = 1;
+        else if (i == 2) b = 2;
+        else if (i == 3) b = 4;
+        else if (i < 8) b = 8;
+        else if (i < 16) b = 16;
+        else if (i < 32) b = 32;
+        else if (i < 128) b = 64;
+        else b = 128;
+        count_class_lookup8[i] = b;
+    }
+
+    for (int hi = 0; hi < 256; hi++) {
+        for (int lo = 0; lo < 256; lo++) {
+            count_class_lookup16[(hi << 8) | lo] =
+                (count_class_lookup8[hi] << 8) | count_class_lookup8[lo];
+        }
+    }
+}
+
+// Scalar classification, skipping empty words
+static uint32_t classify_scalar(uint8_t *map, size_t size) {
+    uint32_t hit = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, map + i, sizeof(word));
+        if (!word) {
+            continue;
+        }
+
+        uint16_t *mem16 = (uint16_t *)(map + i);
+        for (int j = 0; j < 4; j++) {
+            uint16_t v;
+            memcpy(&v, &mem16[j], sizeof(v));
+            v = count_class_lookup16[v];
+            memcpy(&mem16[j], &v, sizeof(v));
+        }
+
+        for (int j = 0; j < 8; j++) {
+            hit += map[i + j] != 0;
+        }
+    }
+
+    for (; i < size; i++) {
+        map[i] = count_class_lookup8[map[i]];
+        hit += map[i] != 0;
+    }
+
+    return hit;
+}
+
+// Scalar virgin map comparison
+static int compare_scalar(uint8_t *virgin, const uint8_t *map, size_t size) {
+    int ret = COVERAGE_NONE;
+
+    for (size_t i = 0; i < size; i++) {
+        uint8_t cur = map[i];
+        if (cur & virgin[i]) {
+            if (virgin[i] == 0xff) {
+                ret = COVERAGE_NEW_EDGE;
+            } else if (ret == COVERAGE_NONE) {
+                ret = COVERAGE_NEW_COUNT;
+            }
+            virgin[i] &= ~cur;
+        }
+    }
+
+    return ret;
+}
+
+// Accumulate one checksum stripe
+static inline void checksum_stripe(uint64_t acc[8], uint64_t key[8], const uint8_t *p) {
+    for (int j = 0; j < 8; j++) {
+        uint64_t d;
+        memcpy(&d, p + j * sizeof(uint64_t), sizeof(d));
+        uint64_t k = d ^ key[j];
+        acc[j] += d + (k & 0xffffffff) * (k >> 32);
+        key[j] += CHECKSUM_STEP;
+    }
+}
+
+// Fold in the zero-padded tail and mix the lanes down to 64 bits
+static uint64_t checksum_finish(uint64_t acc[8], uint64_t key[8], const uint8_t *tail,
+                                size_t tail_size, size_t size) {
+    if (tail_size > 0) {
+        uint8_t last[CHECKSUM_STRIPE] = { 0 };
+        memcpy(last, tail, tail_size);
+        checksum_stripe(acc, key, last);
+    }
+
+    return hash64(acc, 8 * sizeof(uint64_t), size);
+}
+
+// Scalar path checksum
+static uint64_t checksum_scalar(const uint8_t *map, size_t size) {
+    uint64_t acc[8] = { 0 };
+    uint64_t key[8];
+    memcpy(key, checksum_keys, sizeof(key));
+
+    size_t i = 0;
+    for (; i + CHECKSUM_STRIPE <= size; i += CHECKSUM_STRIPE) {
+        checksum_stripe(acc, key, map + i);
+    }
+
+    return checksum_finish(acc, key, map + i, size - i, size);
+}
+
+#if defined(COVERAGE_X86)
+
+// SSE2 classification: bucket by threshold compares
+static uint32_t classify_sse2(uint8_t *map, size_t size) {
+    static const struct {
+        uint8_t threshold;
+        uint8_t bucket;
+    } steps[] = {
+        { 3, 4 }, { 4, 8 }, { 8, 16 }, { 16, 32 }, { 32, 64 }, { 128, 128 }
+    };
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t hit = 0;
+    size_t i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(map + i));
+        int nonzero = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) & 0xffff;
+        if (!nonzero) {
+            continue;
+        }
+
+        // Values 0-2 are their own bucket
+        __m128i r = v;
+        for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+            __m128i t = _mm_set1_epi8((char)steps[s].threshold);
+            __m128i ge = _mm_cmpeq_epi8(_mm_max_epu8(v, t), v);
+            r = _mm_or_si128(_mm_and_si128(ge, _mm_set1_epi8((char)steps[s].bucket)),
+                             _mm_andnot_si128(ge, r));
+        }
+
+        _mm_storeu_si128((__m128i *)(map + i), r);
+        hit += __builtin_popcount(nonzero);
+    }
+
+    return hit + classify_scalar(map + i, size - i);
+}
+
+// SSE2 virgin map comparison
+static int compare_sse2(uint8_t *virgin, const uint8_t *map, size_t size) {
+    const __m128i ones = _mm_set1_epi8((char)0xff);
+    const __m128i zero = _mm_setzero_si128();
+    int ret = COVERAGE_NONE;
+    size_t i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i cur = _mm_loadu_si128((const __m128i *)(map + i));
+        __m128i vir = _mm_loadu_si128((const __m128i *)(virgin + i));
+        __m128i both = _mm_and_si128(cur, vir);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(both, zero)) == 0xffff) {
+            continue;
+        }
+
+        // A byte still fully virgin and hit now is a new edge
+        __m128i fresh = _mm_andnot_si128(_mm_cmpeq_epi8(cur, zero), _mm_cmpeq_epi8(vir, ones));
+        if (_mm_movemask_epi8(fresh)) {
+            ret = COVERAGE_NEW_EDGE;
+        } else if (ret == COVERAGE_NONE) {
+            ret = COVERAGE_NEW_COUNT;
+        }
+
+        _mm_storeu_si128((__m128i *)(virgin + i), _mm_andnot_si128(cur, vir));
+    }
+
+    int tail = compare_scalar(virgin + i, map + i, size - i);
+    return tail > ret ? tail : ret;
+}
+
+// AVX2 classification: nibble table lookups
+__attribute__((target("avx2")))
+static uint32_t classify_avx2(uint8_t *map, size_t size) {
+    const __m256i lo_lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)bucket_lo_nibble));
+    const __m256i hi_lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)bucket_hi_nibble));
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i zero = _mm256_setzero_si256();
+    uint32_t hit = 0;
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(map + i));
+        if (_mm256_testz_si256(v, v)) {
+            continue;
+        }
+
+        __m256i lo = _mm256_and_si256(v, nibble);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+        __m256i from_lo = _mm256_shuffle_epi8(lo_lut, lo);
+        __m256i from_hi = _mm256_shuffle_epi8(hi_lut, hi);
+        __m256i hi_zero = _mm256_cmpeq_epi8(hi, zero);
+        __m256i r = _mm256_blendv_epi8(from_hi, from_lo, hi_zero);
+
+        _mm256_storeu_si256((__m256i *)(map + i), r);
+        hit += __builtin_popcount(~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)));
+    }
+
+    return hit + classify_scalar(map + i, size - i);
+}
+
+// AVX2 virgin map comparison
+__attribute__((target("avx2")))
+static int compare_avx2(uint8_t *virgin, const uint8_t *map, size_t size) {
+    const __m256i ones = _mm256_set1_epi8((char)0xff);
+    const __m256i zero = _mm256_setzero_si256();
+    int ret = COVERAGE_NONE;
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        __m256i cur = _mm256_loadu_si256((const __m256i *)(map + i));
+        __m256i vir = _mm256_loadu_si256((const __m256i *)(virgin + i));
+        if (_mm256_testz_si256(cur, vir)) {
+            continue;
+        }
+
+        // A byte still fully virgin and hit now is a new edge
+        __m256i fresh = _mm256_andnot_si256(_mm256_cmpeq_epi8(cur, zero), _mm256_cmpeq_epi8(vir, ones));
+        if (!_mm256_testz_si256(fresh, fresh)) {
+            ret = COVERAGE_NEW_EDGE;
+        } else if (ret == COVERAGE_NONE) {
+            ret = COVERAGE_NEW_COUNT;
+        }
+
+        _mm256_storeu_si256((__m256i *)(virgin + i), _mm256_andnot_si256(cur, vir));
+    }
+
+    int tail = compare_scalar(virgin + i, map + i, size - i);
+    return tail > ret ? tail : ret;
+}
+
+// SSE2 path checksum
+static uint64_t checksum_sse2(const uint8_t *map, size_t size) {
+    const __m128i step = _mm_set1_epi64x((long long)CHECKSUM_STEP);
+    __m128i acc[4], key[4];
+    for (int j = 0; j < 4; j++) {
+        acc[j] = _mm_setzero_si128();
+        key[j] = _mm_loadu_si128((const __m128i *)(checksum_keys + 2 * j));
+    }
+
+    size_t i = 0;
+    for (; i + CHECKSUM_STRIPE <= size; i += CHECKSUM_STRIPE) {
+        for (int j = 0; j < 4; j++) {
+            __m128i d = _mm_loadu_si128((const __m128i *)(map + i + 16 * j));
+            __m128i k = _mm_xor_si128(d, key[j]);
+            __m128i prod = _mm_mul_epu32(k, _mm_srli_epi64(k, 32));
+            acc[j] = _mm_add_epi64(acc[j], _mm_add_epi64(d, prod));
+            key[j] = _mm_add_epi64(key[j], step);
+        }
+    }
+
+    uint64_t acc_out[8], key_out[8];
+    for (int j = 0; j < 4; j++) {
+        _mm_storeu_si128((__m128i *)(acc_out + 2 * j), acc[j]);
+        _mm_storeu_si128((__m128i *)(key_out + 2 * j), key[j]);
+    }
+    return checksum_finish(acc_out, key_out, map + i, size - i, size);
+}
+
+// AVX2 path checksum
+__attribute__((target("avx2")))
+static uint64_t checksum_avx2(const uint8_t *map, size_t size) {
+    const __m256i step = _mm256_set1_epi64x((long long)CHECKSUM_STEP);
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    __m256i key0 = _mm256_loadu_si256((const __m256i *)checksum_keys);
+    __m256i key1 = _mm256_loadu_si256((const __m256i *)(checksum_keys + 4));
+
+    size_t i = 0;
+    for (; i + CHECKSUM_STRIPE <= size; i += CHECKSUM_STRIPE) {
+        __m256i d0 = _mm256_loadu_si256((const __m256i *)(map + i));
+        __m256i d1 = _mm256_loadu_si256((const __m256i *)(map + i + 32));
+        __m256i k0 = _mm256_xor_si256(d0, key0);
+        __m256i k1 = _mm256_xor_si256(d1, key1);
+        __m256i p0 = _mm256_mul_epu32(k0, _mm256_srli_epi64(k0, 32));
+        __m256i p1 = _mm256_mul_epu32(k1, _mm256_srli_epi64(k1, 32));
+        acc0 = _mm256_add_epi64(acc0, _mm256_add_epi64(d0, p0));
+        acc1 = _mm256_add_epi64(acc1, _mm256_add_epi64(d1, p1));
+        key0 = _mm256_add_epi64(key0, step);
+        key1 = _mm256_add_epi64(key1, step);
+    }
+
+    uint64_t acc[8], key[8];
+    _mm256_storeu_si256((__m256i *)acc, acc0);
+    _mm256_storeu_si256((__m256i *)(acc + 4), acc1);
+    _mm256_storeu_si256((__m256i *)key, key0);
+    _mm256_storeu_si256((__m256i *)(key + 4), key1);
+    return checksum_finish(acc, key, map + i, size - i, size);
+}
+
+#elif defined(COVERAGE_NEON)
+
+// NEON classification: nibble table lookups
+static uint32_t classify_neon(uint8_t *map, size_t size) {
+    const uint8x16_t lo_lut = vld1q_u8(bucket_lo_nibble);
+    const uint8x16_t hi_lut = vld1q_u8(bucket_hi_nibble);
+    const uint8x16_t nibble = vdupq_n_u8(0x0f);
+    uint32_t hit = 0;
+    size_t i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t v = vld1q_u8(map + i);
+        if (vmaxvq_u8(v) == 0) {
+            continue;
+        }
+
+        uint8x16_t lo = vandq_u8(v, nibble);
+        uint8x16_t hi = vshrq_n_u8(v, 4);
+        uint8x16_t from_lo = vqtbl1q_u8(lo_lut, lo);
+        uint8x16_t from_hi = vqtbl1q_u8(hi_lut, hi);
+        uint8x16_t hi_zero = vceqq_u8(hi, vdupq_n_u8(0));
+        uint8x16_t r = vbslq_u8(hi_zero, from_lo, from_hi);
+
+        vst1q_u8(map + i, r);
+        hit += vaddvq_u8(vandq_u8(vtstq_u8(v, v), vdupq_n_u8(1)));
+    }
+
+    return hit + classify_scalar(map + i, size - i);
+}
+
+// NEON virgin map comparison
+static int compare_neon(uint8_t *virgin, const uint8_t *map, size_t size) {
+    int ret = COVERAGE_NONE;
+    size_t i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t cur = vld1q_u8(map + i);
+        uint8x16_t vir = vld1q_u8(virgin + i);
+        if (vmaxvq_u8(vandq_u8(cur, vir)) == 0) {
+            continue;
+        }
+
+        // A byte still fully virgin and hit now is a new edge
+        uint8x16_t fresh = vandq_u8(vtstq_u8(cur, cur), vceqq_u8(vir, vdupq_n_u8(0xff)));
+        if (vmaxvq_u8(fresh)) {
+            ret = COVERAGE_NEW_EDGE;
+        } else if (ret == COVERAGE_NONE) {
+            ret = COVERAGE_NEW_COUNT;
+        }
+
+        vst1q_u8(virgin + i, vbicq_u8(vir, cur));
+    }
+
+    int tail = compare_scalar(virgin + i, map + i, size - i);
+    return tail > ret ? tail : ret;
+}
+
+// NEON path checksum
+static uint64_t checksum_neon(const uint8_t *map, size_t size) {
+    const uint64x2_t step = vdupq_n_u64(CHECKSUM_STEP);
+    uint64x2_t acc[4], key[4];
+    for (int j = 0; j < 4; j++) {
+        acc[j] = vdupq_n_u64(0);
+        key[j] = vld1q_u64(checksum_keys + 2 * j);
+    }
+
+    size_t i = 0;
+    for (; i + CHECKSUM_STRIPE <= size; i += CHECKSUM_STRIPE) {
+        for (int j = 0; j < 4; j++) {
+            uint64x2_t d = vreinterpretq_u64_u8(vld1q_u8(map + i + 16 * j));
+            uint64x2_t k = veorq_u64(d, key[j]);
+            uint64x2_t prod = vmull_u32(vmovn_u64(k), vshrn_n_u64(k, 32));
+            acc[j] = vaddq_u64(acc[j], vaddq_u64(d, prod));
+            key[j] = vaddq_u64(key[j], step);
+        }
+    }
+
+    uint64_t acc_out[8], key_out[8];
+    for (int j = 0; j < 4; j++) {
+        vst1q_u64(acc_out + 2 * j, acc[j]);
+        vst1q_u64(key_out + 2 * j, key[j]);
+    }
+    return checksum_finish(acc_out, key_out, map + i, size - i, size);
+}
+
+#endif
+
+// Pick the widest kernels the CPU supports
+static void select_kernels(void) {
+    classify_kernel = classify_scalar;
+    compare_kernel = compare_scalar;
+    checksum_kernel = checksum_scalar;
+    kernel_name = "scalar";
+
+    // FUZZKRIEG_SCALAR forces the reference kernels
+    if (getenv("FUZZKRIEG_SCALAR")) {
+        return;
+    }
+
+#if defined(COVERAGE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        classify_kernel = classify_avx2;
+        compare_kernel = compare_avx2;
+        checksum_kernel = checksum_avx2;
+        kernel_name = "avx2";
+    } else {
+        classify_kernel = classify_sse2;
+        compare_kernel = compare_sse2;
+        checksum_kernel = checksum_sse2;
+        kernel_name = "sse2";
+    }
+#elif defined(COVERAGE_NEON)
+    classify_kernel = classify_neon;
+    compare_kernel = compare_neon;
+    checksum_kernel = checksum_neon;
+    kernel_name = "neon";
+#endif
+}
+
+// Initialize coverage tracking
+int coverage_init(coverage_t *coverage) {
+    if (!coverage) {
+        return -1;
+    }
+
+    memset(coverage, 0, sizeof(coverage_t));
+
+    if (!kernel_name) {
+        init_count_class();
+        select_kernels();
+    }
+
+    coverage->map = aligned_alloc(64, COVERAGE_MAP_SIZE);
+    coverage->virgin = aligned_alloc(64, COVERAGE_MAP_SIZE);
+    if (!coverage->map || !coverage->virgin) {
+        free(coverage->map);
+        free(coverage->virgin);
+        coverage->map = NULL;
+        coverage->virgin = NULL;
+        return -1;
+    }
+
+    memset(coverage->map, 0, COVERAGE_MAP_SIZE);
+    memset(coverage->virgin, 0xff, COVERAGE_MAP_SIZE);
+    coverage->map_size = COVERAGE_MAP_SIZE;
+    return 0;
+}
+
+// Bucket raw hit counts in place, returning the number of edges hit
+uint32_t coverage_classify(uint8_t *map, size_t size) {
+    if (!map) {
+        return 0;
+    }
+
+    return classify_kernel(map, size);
+}
+
+// Compare a classified map against the virgin map and update it
+int coverage_has_new_bits(coverage_t *coverage, const uint8_t *map, size_t size) {
+    if (!coverage || !coverage->virgin || !map || size > coverage->map_size) {
+        return -1;
+    }
+
+    int novelty = compare_kernel(coverage->virgin, map, size);
+    if (novelty > COVERAGE_NONE) {
+        coverage->unique_paths++;
+    }
+    coverage->total_hits++;
+
+    return novelty;
+}
+
+// Hash a classified map; equal maps always give equal checksums
+uint64_t coverage_checksum(const uint8_t *map, size_t size) {
+    if (!map) {
+        return 0;
+    }
+
+    return checksum_kernel(map, size);
+}
+
+// Count edges seen so far, from the virgin map
+uint32_t coverage_edges(const coverage_t *coverage) {
+    if (!coverage || !coverage->virgin) {
+        return 0;
+    }
+
+    uint32_t edges = 0;
+    const uint64_t *words = (const uint64_t *)coverage->virgin;
+    for (size_t w = 0; w < coverage->map_size / sizeof(uint64_t); w++) {
+        // Untouched edges are still all ones
+        if (words[w] == UINT64_MAX) {
+            continue;
+        }
+        for (size_t i = w * sizeof(uint64_t); i < (w + 1) * sizeof(uint64_t); i++) {
+            edges += coverage->virgin[i] != 0xff;
+        }
+    }
+
+    return edges;
+}
+
+// Classify a raw map and fold it into the virgin map
+int coverage_update(coverage_t *coverage, uint8_t *map, size_t size) {
+    if (!coverage || !map || size > coverage->map_size) {
+        return -1;
+    }
+
+    coverage_classify(map, size);
+    return coverage_has_new_bits(coverage, map, size);
+}
+
+// Name of the active kernels
+const char *coverage_kernel(void) {
+    return kernel_name ? kernel_name : "none";
+}
+
+// Clean up coverage tracking
+void coverage_cleanup(coverage_t *coverage) {
+    if (!coverage) {
+        return;
+    }
+
+    free(coverage->map);
+    free(coverage->virgin);
+    memset(coverage, 0, sizeof(coverage_t));
+}
@@ -0,0 +1,537 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../../include/fuzzkrieg.h"
+#include "../../include/executor.h"
+#include "../../include/farm.h"
+
+// Watchdog callback: abort the exec that missed its deadline
+static void farm_watchdog_fire(void *ctx) {
+    executor_kill(ctx);
+}
+
+// Wall clock time ms from now, for pthread_cond_timedwait
+static struct timespec farm_deadline(uint32_t ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    uint64_t ns = (uint64_t)ts.tv_nsec + (uint64_t)ms * 1000000ULL;
+    ts.tv_sec += ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    return ts;
+}
+
+// What a member is called in messages
+static const char *farm_kind(const farm_device_t *dev) {
+    return dev->config.jobs ? "Job" : "Device";
+}
+
+// Run the test case handed over, leaving the result in dev
+static void farm_exec(farm_device_t *dev) {
+    testcase_t *tc = dev->tc;
+    dev->status = -1;
+    dev->crashed = 0;
+    dev->crash_check_ns = 0;
+
+    uint64_t start = stats_now_ns();
+    if (executor_load(&dev->executor, tc) != 0) {
+        return;
+    }
+    uint64_t run_start = stats_now_ns();
+    dev->transfer_ns = run_start - start;
+
+    tc->timed_out = 0;
+    dev->executor.timeout_ms = dev->timeout_ms;
+    watchdog_arm(&dev->watchdog, dev->timeout_ms);
+    int ret = executor_run(&dev->executor, tc);
+    if (watchdog_disarm(&dev->watchdog)) {
+        tc->timed_out = 1;
+    }
+    if (ret != 0) {
+        return;
+    }
+    dev->run_ns = stats_now_ns() - run_start;
+
+    // Hangs keep the coverage up to the kill, for dedup
+    if (executor_collect_coverage(&dev->executor, &dev->coverage) != 0) {
+        return;
+    }
+    if (!tc->timed_out) {
+        uint64_t check_start = stats_now_ns();
+        dev->crashed = executor_check_crash(&dev->executor) != 0;
+        dev->crash_check_ns = stats_now_ns() - check_start;
+    }
+
+    dev->status = 0;
+}
+
+// Device thread: connect, run what the main thread hands over, recover
+// the device when it drops, and reconnect with backoff if that fails
+static void *farm_device_thread(void *arg) {
+    farm_device_t *dev = arg;
+    farm_t *farm = dev->farm;
+
+    pthread_mutex_lock(&farm->lock);
+    while (!farm->stop) {
+        switch (dev->state) {
+            case FARM_DEVICE_OFFLINE: {
+                uint64_t now = stats_now_ns();
+                if (now < dev->retry_ns) {
+                    struct timespec ts = farm_deadline((dev->retry_ns - now) / 1000000 + 1);
+                    pthread_cond_timedwait(&dev->wake, &farm->lock, &ts);
+                    break;
+                }
+
+                // Connecting takes round trips; never hold the farm lock across them
+                pthread_mutex_unlock(&farm->lock);
+                int ret = executor_init(&dev->executor, &dev->config, &dev->device);
+                pthread_mutex_lock(&farm->lock);
+
+                if (ret == 0) {
+                    printf("%s %s online\n", farm_kind(dev), dev->udid);
+                    dev->state = FARM_DEVICE_IDLE;
+                    dev->retry_ms = FARM_RETRY_MIN_MS;
+                    pthread_cond_signal(&farm->done);
+                } else {
+                    dev->retry_ns = stats_now_ns() + (uint64_t)dev->retry_ms * 1000000ULL;
+                    if (dev->retry_ms < FARM_RETRY_MAX_MS) {
+                        dev->retry_ms *= 2;
+                    }
+                }
+                break;
+            }
+
+            case FARM_DEVICE_BUSY:
+                pthread_mutex_unlock(&farm->lock);
+                farm_exec(dev);
+                pthread_mutex_lock(&farm->lock);
+
+                dev->state = FARM_DEVICE_DONE;
+                pthread_cond_signal(&farm->done);
+                break;
+
+            case FARM_DEVICE_DROP: {
+                // Wait out the reboot and reconnect; farm_stop cancels it.
+                // A host executor without recovery, such as a fork server
+                // that died, starts over instead.
+                pthread_mutex_unlock(&farm->lock);
+                int ret = dev->executor.ops->recover ? executor_recover(&dev->executor) : -1;
+                pthread_mutex_lock(&farm->lock);
+
+                if (ret == 0) {
+                    dev->state = FARM_DEVICE_IDLE;
+                    pthread_cond_signal(&farm->done);
+                    break;
+                }
+
+                // Gone for good as far as recovery goes; retry from scratch
+                dev->state = FARM_DEVICE_OFFLINE;
+                dev->retry_ns = stats_now_ns() + (uint64_t)dev->retry_ms * 1000000ULL;
+                pthread_mutex_unlock(&farm->lock);
+                executor_cleanup(&dev->executor);
+                pthread_mutex_lock(&farm->lock);
+                break;
+            }
+
+            default:
+                // Idle or done: the main thread moves next
+                pthread_cond_wait(&dev->wake, &farm->lock);
+                break;
+        }
+    }
+    pthread_mutex_unlock(&farm->lock);
+
+    executor_cleanup(&dev->executor);
+    return NULL;
+}
+
+// Add a device, or with another executor the job'th of its instances,
+// and start its thread; it connects on its own
+static int farm_add(fuzzer_t *fuzzer, const char *udid, uint32_t job) {
+    farm_t *farm = fuzzer->farm;
+    if (farm->count >= FARM_MAX_DEVICES) {
+        fprintf(stderr, "Failed to add device %s: farm is full\n", udid);
+        return -1;
+    }
+
+    farm_device_t *dev = calloc(1, sizeof(farm_device_t));
+    if (!dev) {
+        return -1;
+    }
+    dev->farm = farm;
+    dev->udid = strdup(udid);
+    dev->coverage.map = aligned_alloc(64, COVERAGE_MAP_SIZE);
+    dev->coverage.map_size = COVERAGE_MAP_SIZE;
+    if (!dev->udid || !dev->coverage.map) {
+        free(dev->coverage.map);
+        free(dev->udid);
+        free(dev);
+        return -1;
+    }
+    memset(dev->coverage.map, 0, COVERAGE_MAP_SIZE);
+
+    // The executor sees a configuration naming only this device or job
+    memcpy(&dev->config, &fuzzer->config, sizeof(fuzz_config_t));
+    if (fuzzer->config.jobs) {
+        dev->config.devices = NULL;
+        dev->config.device_count = 0;
+    } else {
+        dev->config.devices = &dev->udid;
+        dev->config.device_count = 1;
+    }
+    dev->config.job = job;
+    dev->config.farm = 0;
+
+    dev->state = FARM_DEVICE_OFFLINE;
+    dev->retry_ms = FARM_RETRY_MIN_MS;
+
+    if (pthread_cond_init(&dev->wake, NULL) != 0) {
+        free(dev->coverage.map);
+        free(dev->udid);
+        free(dev);
+        return -1;
+    }
+    if (watchdog_start(&dev->watchdog, farm_watchdog_fire, &dev->executor) != 0) {
+        pthread_cond_destroy(&dev->wake);
+        free(dev->coverage.map);
+        free(dev->udid);
+        free(dev);
+        return -1;
+    }
+    if (pthread_create(&dev->thread, NULL, farm_device_thread, dev) != 0) {
+        fprintf(stderr, "Failed to start thread for device %s\n", udid);
+        watchdog_stop(&dev->watchdog);
+        pthread_cond_destroy(&dev->wake);
+        free(dev->coverage.map);
+        free(dev->udid);
+        free(dev);
+        return -1;
+    }
+
+    farm->devices[farm->count++] = dev;
+    return 0;
+}
+
+// Admit attached devices the farm does not know yet
+static void farm_scan(fuzzer_t *fuzzer) {
+    farm_t *farm = fuzzer->farm;
+    farm->last_scan = time(NULL);
+
+    char **udids = NULL;
+    int count = 0;
+    if (device_list_udids(&udids, &count) != 0) {
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int known = 0;
+        for (uint32_t j = 0; j < farm->count; j++) {
+            if (strcmp(farm->devices[j]->udid, udids[i]) == 0) {
+                known = 1;
+                break;
+            }
+        }
+        if (!known && farm_add(fuzzer, udids[i], 0) == 0) {
+            printf("Admitted device %s\n", udids[i]);
+        }
+    }
+
+    device_free_udids(udids);
+}
+
+// Start one device thread per UDID in the configuration, per attached
+// device with config->farm, or per job with config->jobs
+int farm_start(fuzzer_t *fuzzer) {
+    if (!fuzzer) {
+        return -1;
+    }
+
+    // Devices are named by UDID; other executors run as many jobs
+    int devices = strcmp(fuzzer->config.executor, "device") == 0;
+    if (devices == (fuzzer->config.jobs > 0)) {
+        fprintf(stderr, "Failed to start farm: devices are given with -d or -F, %s executors with -j\n",
+                devices ? "device" : fuzzer->config.executor);
+        return -1;
+    }
+
+    farm_t *farm = calloc(1, sizeof(farm_t));
+    if (!farm) {
+        return -1;
+    }
+    if (pthread_mutex_init(&farm->lock, NULL) != 0) {
+        free(farm);
+        return -1;
+    }
+    if (pthread_cond_init(&farm->done, NULL) != 0) {
+        pthread_mutex_destroy(&farm->lock);
+        free(farm);
+        return -1;
+    }
+    farm->scan = fuzzer->config.farm;
+    fuzzer->farm = farm;
+
+    for (uint32_t i = 0; i < fuzzer->config.device_count; i++) {
+        farm_add(fuzzer, fuzzer->config.devices[i], 0);
+    }
+    for (uint32_t i = 0; i < fuzzer->config.jobs; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "%s-%u", fuzzer->config.executor, i + 1);
+        farm_add(fuzzer, name, i);
+    }
+    if (farm->scan) {
+        farm_scan(fuzzer);
+    }
+
+    if (farm->count == 0) {
+        fprintf(stderr, "Failed to start farm: no devices\n");
+        farm_stop(fuzzer);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Take the result of a finished device into the fuzzer; main thread only
+static void farm_complete(fuzzer_t *fuzzer, farm_device_t *dev) {
+    farm_t *farm = fuzzer->farm;
+    testcase_t *tc = dev->tc;
+    dev->tc = NULL;
+    farm->in_flight--;
+
+    farm_device_state_t next = FARM_DEVICE_IDLE;
+    uint32_t crash = 0;
+    if (dev->status != 0) {
+        // A panic takes the connection down with it, so the exec fails
+        // instead of reporting a crash; keep the input that was running
+        fprintf(stderr, "Failed to execute test case on %s %s, saving it as a crash\n",
+                farm_kind(dev), dev->udid);
+        dev->crashes++;
+        crash = save_crash(fuzzer, &dev->executor, tc);
+        testcase_free(tc);
+        next = FARM_DEVICE_DROP;
+    } else {
+        fuzzer->child_depth = dev->depth;
+        fuzzer->child_strategy = dev->strategy;
+        fuzzer->exec_count++;
+        fuzzer->strategies[dev->strategy].execs++;
+        record_exec(fuzzer, tc, dev->transfer_ns, dev->run_ns);
+
+        uint64_t exec_ns = dev->transfer_ns + dev->run_ns;
+        if (dev->exec_ns) {
+            dev->exec_ns = dev->exec_ns - dev->exec_ns / FARM_SPEED_WEIGHT + exec_ns / FARM_SPEED_WEIGHT;
+        } else {
+            dev->exec_ns = exec_ns;
+        }
+        dev->execs++;
+
+        // The device's map becomes the fuzzer's; the old one serves its next exec
+        uint8_t *map = fuzzer->coverage.map;
+        fuzzer->coverage.map = dev->coverage.map;
+        dev->coverage.map = map;
+
+        if (tc->timed_out) {
+            fuzzer->hang_count++;
+            save_hang(fuzzer, tc);
+        } else {
+            uint64_t start = stats_now_ns();
+            if (evaluate_coverage(fuzzer, tc) != 0) {
+                fprintf(stderr, "Failed to update coverage\n");
+            }
+            histogram_record(&fuzzer->stages[STAGE_COVERAGE], stats_now_ns() - start);
+            histogram_record(&fuzzer->stages[STAGE_CRASH_CHECK], dev->crash_check_ns);
+
+            if (dev->crashed) {
+                // A panic takes the device down; it rejoins once it is back.
+                // Host targets restart with the next exec.
+                if (dev->device.device && device_check_status(&dev->device) != 0) {
+                    next = FARM_DEVICE_DROP;
+                }
+
+                fuzzer->strategies[dev->strategy].crashes++;
+                dev->crashes++;
+                crash = save_crash(fuzzer, &dev->executor, tc);
+            } else {
+                start = stats_now_ns();
+                if (is_interesting(fuzzer, tc)) {
+                    save_interesting_case(fuzzer, tc);
+                }
+                histogram_record(&fuzzer->stages[STAGE_SAVE], stats_now_ns() - start);
+            }
+        }
+
+        testcase_free(tc);
+        fuzzer->iteration++;
+    }
+
+    if (next == FARM_DEVICE_DROP) {
+        dev->drops++;
+        printf("%s %s dropped, recovering\n", farm_kind(dev), dev->udid);
+    }
+
+    pthread_mutex_lock(&farm->lock);
+    dev->state = next;
+    pthread_cond_signal(&dev->wake);
+    pthread_mutex_unlock(&farm->lock);
+
+    // The device is already recovering or running again
+    triage_submit(&fuzzer->triage, crash);
+}
+
+// Order idle devices fastest first; unmeasured ones go first to get measured
+static int farm_compare_speed(const void *a, const void *b) {
+    const farm_device_t *x = *(farm_device_t *const *)a;
+    const farm_device_t *y = *(farm_device_t *const *)b;
+    return x->exec_ns < y->exec_ns ? -1 : x->exec_ns > y->exec_ns;
+}
+
+// Hand a new test case to an idle device; main thread only
+static int farm_dispatch(fuzzer_t *fuzzer, farm_device_t *dev) {
+    farm_t *farm = fuzzer->farm;
+
+    testcase_t *tc = generate_testcase(fuzzer);
+    if (!tc) {
+        fprintf(stderr, "Failed to generate test case\n");
+        return -1;
+    }
+
+    dev->tc = tc;
+    dev->depth = fuzzer->child_depth;
+    dev->strategy = fuzzer->child_strategy;
+    dev->timeout_ms = fuzzer->exec_timeout ? fuzzer->exec_timeout : CALIBRATION_TIMEOUT_MS;
+    farm->in_flight++;
+
+    pthread_mutex_lock(&farm->lock);
+    dev->state = FARM_DEVICE_BUSY;
+    pthread_cond_signal(&dev->wake);
+    pthread_mutex_unlock(&farm->lock);
+    return 0;
+}
+
+// Whether the loop may start another exec
+static int farm_may_dispatch(const fuzzer_t *fuzzer) {
+    return fuzzer->state == FUZZ_STATE_RUNNING &&
+           fuzzer->iteration + fuzzer->farm->in_flight < fuzzer->config.max_iterations &&
+           fuzzer->crash_count < fuzzer->config.max_crashes;
+}
+
+// When the loop must wake without a device finishing: to publish stats
+// on the next second, which also notices a stop from the signal handler,
+// or to scan for new devices
+static struct timespec farm_next_due(const fuzzer_t *fuzzer) {
+    const farm_t *farm = fuzzer->farm;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec++;
+    ts.tv_nsec = 0;
+
+    time_t scan = farm->last_scan + FARM_SCAN_INTERVAL;
+    if (farm->scan && scan < ts.tv_sec) {
+        ts.tv_sec = scan;
+    }
+    return ts;
+}
+
+// Fuzz until the iteration limit or the fuzzer stops running. The main
+// thread generates and evaluates, a triage thread handles crashes, and
+// device threads only talk to their device.
+int farm_run(fuzzer_t *fuzzer) {
+    if (!fuzzer || !fuzzer->farm) {
+        return -1;
+    }
+
+    farm_t *farm = fuzzer->farm;
+    farm_device_t *done[FARM_MAX_DEVICES];
+    farm_device_t *idle[FARM_MAX_DEVICES];
+
+    while (farm_may_dispatch(fuzzer) || farm->in_flight > 0) {
+        fuzzer_periodic(fuzzer);
+        if (farm->scan && time(NULL) - farm->last_scan >= FARM_SCAN_INTERVAL) {
+            farm_scan(fuzzer);
+        }
+
+        // Snapshot who is done and who is idle, sleeping if neither can move
+        uint32_t n_done = 0, n_idle = 0;
+        pthread_mutex_lock(&farm->lock);
+        for (uint32_t i = 0; i < farm->count; i++) {
+            if (farm->devices[i]->state == FARM_DEVICE_DONE) {
+                done[n_done++] = farm->devices[i];
+            } else if (farm->devices[i]->state == FARM_DEVICE_IDLE) {
+                idle[n_idle++] = farm->devices[i];
+            }
+        }
+        if (n_done == 0 && (n_idle == 0 || !farm_may_dispatch(fuzzer))) {
+            struct timespec ts = farm_next_due(fuzzer);
+            pthread_cond_timedwait(&farm->done, &farm->lock, &ts);
+            pthread_mutex_unlock(&farm->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&farm->lock);
+
+        for (uint32_t i = 0; i < n_done; i++) {
+            farm_complete(fuzzer, done[i]);
+        }
+
+        // Work goes to the fastest idle devices first
+        qsort(idle, n_idle, sizeof(farm_device_t *), farm_compare_speed);
+        for (uint32_t i = 0; i < n_idle && farm_may_dispatch(fuzzer); i++) {
+            if (farm_dispatch(fuzzer, idle[i]) != 0) {
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// Stop every device thread and disconnect
+void farm_stop(fuzzer_t *fuzzer) {
+    if (!fuzzer || !fuzzer->farm) {
+        return;
+    }
+
+    farm_t *farm = fuzzer->farm;
+    pthread_mutex_lock(&farm->lock);
+    farm->stop = 1;
+    for (uint32_t i = 0; i < farm->count; i++) {
+        if (farm->devices[i]->state == FARM_DEVICE_DROP) {
+            atomic_store(&farm->devices[i]->executor.cancel, 1);
+        }
+        pthread_cond_signal(&farm->devices[i]->wake);
+    }
+    pthread_mutex_unlock(&farm->lock);
+
+    for (uint32_t i = 0; i < farm->count; i++) {
+        farm_device_t *dev = farm->devices[i];
+        pthread_join(dev->thread, NULL);
+        watchdog_stop(&dev->watchdog);
+        if (dev->tc) {
+            testcase_free(dev->tc);
+        }
+        pthread_cond_destroy(&dev->wake);
+        free(dev->coverage.map);
+        free(dev->udid);
+        free(dev);
+    }
+
+    pthread_cond_destroy(&farm->done);
+    pthread_mutex_destroy(&farm->lock);
+    free(farm);
+    fuzzer->farm = NULL;
+}
+
+// Print throughput and drops per device
+void farm_report(const fuzzer_t *fuzzer) {
+    if (!fuzzer || !fuzzer->farm) {
+        return;
+    }
+
+    const farm_t *farm = fuzzer->farm;
+    printf("\n%s: %u\n", fuzzer->config.jobs ? "Jobs" : "Devices", farm->count);
+    for (uint32_t i = 0; i < farm->count; i++) {
+        const farm_device_t *dev = farm->devices[i];
+        printf("  %s: %llu execs, %.2f ms/exec, %llu crashes, %u drops\n",
+               dev->udid, (unsigned long long)dev->execs, dev->exec_ns / 1e6,
+               (unsigned long long)dev->crashes, dev->drops);
+    }
+}
@@ -3,7 +3,79 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #include "../../include/fuzzkrieg.h"
+#include "../../include/executor.h"
+#include "../../include/farm.h"
+#include "../../include/minimizer.h"
+
+// Watchdog callback: abort the exec that missed its deadline
+static void watchdog_fire(void *ctx) {
+    executor_kill(ctx);
+}
+
+// Triage callback: analyze and minimize one saved crash
+static void triage_fire(void *ctx, uint32_t crash) {
+    triage_crash(ctx, crash);
+}
+
+// Leftover callback: note a crash whose triage was cancelled, for --resume
+static void triage_defer(void *ctx, uint32_t crash) {
+    fuzzer_t *fuzzer = ctx;
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", fuzzer->config.output_dir, TRIAGE_PENDING_FILE);
+
+    FILE *f = fopen(path, "a");
+    if (!f) {
+        fprintf(stderr, "Failed to record crash_%u for triage\n", crash);
+        return;
+    }
+    fprintf(f, "%u\n", crash);
+    fclose(f);
+}
+
+// Queue the crashes an earlier run left untriaged. A fresh run numbers
+// crashes from 1 again, so it only drops the list.
+static void load_triage_pending(fuzzer_t *fuzzer) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", fuzzer->config.output_dir, TRIAGE_PENDING_FILE);
+
+    FILE *f = fuzzer->config.resume ? fopen(path, "r") : NULL;
+    if (f) {
+        unsigned int crash;
+        while (fscanf(f, "%u", &crash) == 1) {
+            if (crash > 0 && crash <= fuzzer->crash_count) {
+                triage_submit(&fuzzer->triage, crash);
+            }
+        }
+        fclose(f);
+    }
+    unlink(path);
+}
+
+// Pick up hangs saved by earlier runs, named by their path hash
+static void load_hangs(fuzzer_t *fuzzer) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", fuzzer->config.output_dir, HANGS_DIR);
+    mkdir(path, 0755);
+
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned long long path_hash;
+        if (sscanf(entry->d_name, "hang_%16llx", &path_hash) == 1 &&
+            hashset_insert(&fuzzer->hang_hashes, path_hash) == 1) {
+            fuzzer->unique_hangs++;
+        }
+    }
+
+    closedir(dir);
+}
 
 // Initialize the fuzzer with given configuration
 int fuzzer_init(fuzzer_t *fuzzer, fuzz_config_t *config) {
@@ -13,6 +85,12 @@ int fuzzer_init(fuzzer_t *fuzzer, fuzz_config_t *config) {
 
     memset(fuzzer, 0, sizeof(fuzzer_t));
     memcpy(&fuzzer->config, config, sizeof(fuzz_config_t));
+
+    // Seed the worker's generator, picking a seed if none was given
+    if (fuzzer->config.seed == 0) {
+        fuzzer->config.seed = ((uint64_t)time(NULL) << 32) ^ (uint64_t)getpid();
+    }
+    rng_seed(&fuzzer->rng, fuzzer->config.seed);
     
     // Initialize coverage tracking
     if (coverage_init(&fuzzer->coverage) != 0) {
@@ -20,34 +98,146 @@ int fuzzer_init(fuzzer_t *fuzzer, fuzz_config_t *config) {
         return -1;
     }
 
-    // Connect to device
-    if (device_connect(&fuzzer->device, NULL) != 0) {
-        fprintf(stderr, "Failed to connect to device\n");
+    // Initialize seed queue
+    if (queue_init(&fuzzer->queue, fuzzer->coverage.map_size, config->schedule) != 0) {
+        fprintf(stderr, "Failed to initialize seed queue\n");
         coverage_cleanup(&fuzzer->coverage);
         return -1;
     }
 
+    // Initialize test case buffer pool
+    // A farm keeps one test case in flight per device or job, one device
+    // up to EXECUTOR_MAX_IN_FLIGHT
+    uint32_t pool_size = TESTCASE_POOL_SIZE + EXECUTOR_MAX_IN_FLIGHT +
+                         (config->farm ? FARM_MAX_DEVICES : config->device_count + config->jobs);
+    if (testcase_pool_init(&fuzzer->pool, pool_size) != 0) {
+        fprintf(stderr, "Failed to initialize test case pool\n");
+        queue_cleanup(&fuzzer->queue);
+        coverage_cleanup(&fuzzer->coverage);
+        return -1;
+    }
+
+    // Initialize dedup sets
+    if (hashset_init(&fuzzer->corpus_hashes, 1024) != 0 ||
+        hashset_init(&fuzzer->path_hashes, 1024) != 0 ||
+        hashset_init(&fuzzer->hang_hashes, 64) != 0) {
+        fprintf(stderr, "Failed to initialize hash sets\n");
+        hashset_cleanup(&fuzzer->hang_hashes);
+        hashset_cleanup(&fuzzer->path_hashes);
+        hashset_cleanup(&fuzzer->corpus_hashes);
+        testcase_pool_cleanup(&fuzzer->pool);
+        queue_cleanup(&fuzzer->queue);
+        coverage_cleanup(&fuzzer->coverage);
+        return -1;
+    }
+
+    // Open the corpus store, picking up test cases saved by earlier runs
+    mkdir(fuzzer->config.output_dir, 0755);
+    if (corpus_open(&fuzzer->corpus, fuzzer->config.output_dir) != 0) {
+        fprintf(stderr, "Failed to open corpus store\n");
+        hashset_cleanup(&fuzzer->hang_hashes);
+        hashset_cleanup(&fuzzer->path_hashes);
+        hashset_cleanup(&fuzzer->corpus_hashes);
+        testcase_pool_cleanup(&fuzzer->pool);
+        queue_cleanup(&fuzzer->queue);
+        coverage_cleanup(&fuzzer->coverage);
+        return -1;
+    }
+    for (uint32_t i = 0; i < corpus_count(&fuzzer->corpus); i++) {
+        hashset_insert(&fuzzer->corpus_hashes, corpus_record(&fuzzer->corpus, i)->hash);
+    }
+    load_hangs(fuzzer);
+    fuzzer->exec_timeout = fuzzer->config.timeout;
+
+    // Pick up coverage, queue and counters where the last run left off
+    if (config->resume && fuzzer_resume(fuzzer) != 0) {
+        fprintf(stderr, "Failed to resume from checkpoint\n");
+        corpus_close(&fuzzer->corpus);
+        hashset_cleanup(&fuzzer->hang_hashes);
+        hashset_cleanup(&fuzzer->path_hashes);
+        hashset_cleanup(&fuzzer->corpus_hashes);
+        testcase_pool_cleanup(&fuzzer->pool);
+        queue_cleanup(&fuzzer->queue);
+        coverage_cleanup(&fuzzer->coverage);
+        return -1;
+    }
+
+    // Bring up the executor backend; in a farm each device or job gets its own
+    int farm = config->farm || config->device_count > 1 || config->jobs > 1;
+    if ((farm ? farm_start(fuzzer) : executor_init(&fuzzer->executor, &fuzzer->config, &fuzzer->device)) != 0) {
+        fprintf(stderr, "Failed to initialize executor\n");
+        corpus_close(&fuzzer->corpus);
+        hashset_cleanup(&fuzzer->hang_hashes);
+        hashset_cleanup(&fuzzer->path_hashes);
+        hashset_cleanup(&fuzzer->corpus_hashes);
+        testcase_pool_cleanup(&fuzzer->pool);
+        queue_cleanup(&fuzzer->queue);
+        coverage_cleanup(&fuzzer->coverage);
+        return -1;
+    }
+
+    // Enforce exec deadlines from a separate thread; -T fixes the timeout
+    if (!fuzzer->farm && watchdog_start(&fuzzer->watchdog, watchdog_fire, &fuzzer->executor) != 0) {
+        executor_cleanup(&fuzzer->executor);
+        corpus_close(&fuzzer->corpus);
+        hashset_cleanup(&fuzzer->hang_hashes);
+        hashset_cleanup(&fuzzer->path_hashes);
+        hashset_cleanup(&fuzzer->corpus_hashes);
+        testcase_pool_cleanup(&fuzzer->pool);
+        queue_cleanup(&fuzzer->queue);
+        coverage_cleanup(&fuzzer->coverage);
+        return -1;
+    }
+
+    // Without the triage thread, crashes are triaged in the fuzz loop
+    triage_start(&fuzzer->triage, triage_fire, fuzzer);
+    minimizer_set_cancel(&fuzzer->triage.cancel);
+    load_triage_pending(fuzzer);
+
     fuzzer->state = FUZZ_STATE_INIT;
     fuzzer->start_time = time(NULL);
+
+    // Publish live stats for fuzzkrieg-top; fuzzing goes on without them
+    if (fuzzer_stats_segment_init(fuzzer) != 0) {
+        fprintf(stderr, "Failed to create stats segment\n");
+    }
     
     return 0;
 }
 
-// Main fuzzing loop
-int fuzzer_run(fuzzer_t *fuzzer) {
-    if (!fuzzer || fuzzer->state == FUZZ_STATE_ERROR) {
-        return -1;
+// Save state periodically so a restart can resume
+void fuzzer_periodic(fuzzer_t *fuzzer) {
+    uint64_t now = time(NULL);
+    if (now - fuzzer->last_checkpoint >= CHECKPOINT_INTERVAL) {
+        fuzzer_checkpoint(fuzzer);
+    }
+    if (now - fuzzer->last_stats >= STATS_INTERVAL) {
+        fuzzer_write_stats(fuzzer);
     }
+    if (now != fuzzer->last_publish) {
+        fuzzer_publish_stats(fuzzer);
+    }
+}
 
-    fuzzer->state = FUZZ_STATE_RUNNING;
-    uint32_t iteration = 0;
+// Queue a crash for triage and recover the target meanwhile; fuzzing
+// resumes as soon as it is back. -1 if it did not come back
+static int recover_and_triage(fuzzer_t *fuzzer, uint32_t crash) {
+    triage_submit(&fuzzer->triage, crash);
+    return executor_recover(&fuzzer->executor);
+}
 
+// Fuzz on the one executor until the iteration or crash limit, recovering
+// the target after each crash
+static void fuzz_loop(fuzzer_t *fuzzer) {
     while (fuzzer->state == FUZZ_STATE_RUNNING) {
-        // Check if we've reached max iterations
-        if (iteration >= fuzzer->config.max_iterations) {
+        // Check if we've reached max iterations or crashes
+        if (fuzzer->iteration >= fuzzer->config.max_iterations ||
+            fuzzer->crash_count >= fuzzer->config.max_crashes) {
             break;
         }
 
+        fuzzer_periodic(fuzzer);
+
         // Generate or mutate test case
         testcase_t *tc = generate_testcase(fuzzer);
         if (!tc) {
@@ -61,28 +251,275 @@ int fuzzer_run(fuzzer_t *fuzzer) {
             testcase_free(tc);
             continue;
         }
+        fuzzer->exec_count++;
+        fuzzer->strategies[fuzzer->child_strategy].execs++;
+
+        // Hangs go to their own corpus; their coverage is cut short
+        if (tc->timed_out) {
+            handle_hang(fuzzer, tc);
+            testcase_free(tc);
+            fuzzer->iteration++;
+            continue;
+        }
 
         // Update coverage information
+        uint64_t start = stats_now_ns();
         if (update_coverage(fuzzer, tc) != 0) {
             fprintf(stderr, "Failed to update coverage\n");
         }
+        histogram_record(&fuzzer->stages[STAGE_COVERAGE], stats_now_ns() - start);
 
         // Check for crashes
-        if (check_crash(fuzzer) != 0) {
-            fuzzer->state = FUZZ_STATE_CRASHED;
-            handle_crash(fuzzer, tc);
-            break;
+        start = stats_now_ns();
+        int crashed = check_crash(fuzzer);
+        histogram_record(&fuzzer->stages[STAGE_CRASH_CHECK], stats_now_ns() - start);
+        if (crashed != 0) {
+            fuzzer->strategies[fuzzer->child_strategy].crashes++;
+            uint32_t crash = save_crash(fuzzer, &fuzzer->executor, tc);
+            testcase_free(tc);
+            fuzzer->iteration++;
+
+            // The queue stays in memory; fuzzing resumes once the target is back
+            if (recover_and_triage(fuzzer, crash) != 0) {
+                if (fuzzer->state == FUZZ_STATE_RUNNING) {
+                    fprintf(stderr, "Failed to recover the target, stopping\n");
+                    fuzzer->state = FUZZ_STATE_CRASHED;
+                }
+                break;
+            }
+            continue;
         }
 
         // Save interesting test cases
+        start = stats_now_ns();
         if (is_interesting(fuzzer, tc)) {
             save_interesting_case(fuzzer, tc);
         }
+        histogram_record(&fuzzer->stages[STAGE_SAVE], stats_now_ns() - start);
+
+        testcase_free(tc);
+        fuzzer->iteration++;
+    }
+}
+
+// Collect the test cases still queued on the executor. Behind a crash,
+// any of them may have caused it, a lagging event pointing at the wrong
+// one; they are saved as candidates for it. Otherwise they are dropped.
+static void drain_in_flight(fuzzer_t *fuzzer, uint32_t in_flight, uint32_t crash) {
+    char path[512];
+    if (crash != 0 && in_flight > 0) {
+        snprintf(path, sizeof(path), "%s/%s", fuzzer->config.output_dir, CANDIDATES_DIR);
+        mkdir(path, 0755);
+    }
+
+    executor_result_t result;
+    for (uint32_t n = 1; n <= in_flight; n++) {
+        if (executor_reap(&fuzzer->executor, &fuzzer->coverage, &result) != 1) {
+            break;
+        }
+        if (crash != 0) {
+            snprintf(path, sizeof(path), "%s/%s/crash_%u_%u",
+                     fuzzer->config.output_dir, CANDIDATES_DIR, crash, n);
+            testcase_save(result.tc, path);
+        }
+        testcase_free(result.tc);
+    }
+}
 
+// Save a test case that crashed the target and free it; returns the crash number
+static uint32_t keep_crash(fuzzer_t *fuzzer, testcase_t *tc) {
+    fuzzer->strategies[fuzzer->child_strategy].crashes++;
+    uint32_t crash = save_crash(fuzzer, &fuzzer->executor, tc);
+    testcase_free(tc);
+    fuzzer->iteration++;
+    return crash;
+}
+
+// Analyze stage: account for a result and keep what is new. Returns the
+// crash number if it crashed the target, 0 otherwise.
+static uint32_t analyze_result(fuzzer_t *fuzzer, const executor_result_t *result) {
+    testcase_t *tc = result->tc;
+    if (result->status != 0) {
+        // The target went down with it: a crash, with no coverage to evaluate
+        if (result->crashed) {
+            fprintf(stderr, "Failed to execute test case, target lost; saving it as a crash\n");
+            return keep_crash(fuzzer, tc);
+        }
+        fprintf(stderr, "Failed to execute test case\n");
         testcase_free(tc);
-        iteration++;
+        return 0;
+    }
+    fuzzer->exec_count++;
+    fuzzer->strategies[fuzzer->child_strategy].execs++;
+    record_exec(fuzzer, tc, result->transfer_ns, result->run_ns);
+
+    // Hangs go to their own corpus; their coverage is cut short
+    if (tc->timed_out) {
+        fuzzer->hang_count++;
+        save_hang(fuzzer, tc);
+        testcase_free(tc);
+        fuzzer->iteration++;
+        return 0;
+    }
+
+    uint64_t start = stats_now_ns();
+    if (evaluate_coverage(fuzzer, tc) != 0) {
+        fprintf(stderr, "Failed to update coverage\n");
+    }
+    histogram_record(&fuzzer->stages[STAGE_COVERAGE], stats_now_ns() - start);
+    histogram_record(&fuzzer->stages[STAGE_CRASH_CHECK], result->crash_check_ns);
+
+    if (result->crashed) {
+        return keep_crash(fuzzer, tc);
+    }
+
+    start = stats_now_ns();
+    if (is_interesting(fuzzer, tc)) {
+        save_interesting_case(fuzzer, tc);
+    }
+    histogram_record(&fuzzer->stages[STAGE_SAVE], stats_now_ns() - start);
+
+    testcase_free(tc);
+    fuzzer->iteration++;
+    return 0;
+}
+
+// Whether the pipelined loop may queue another test case behind in_flight
+static int async_may_dispatch(const fuzzer_t *fuzzer, uint32_t in_flight) {
+    return fuzzer->state == FUZZ_STATE_RUNNING &&
+           fuzzer->iteration + in_flight < fuzzer->config.max_iterations &&
+           fuzzer->crash_count < fuzzer->config.max_crashes;
+}
+
+// Fuzz as a pipeline of four stages: mutate and analyze here, transfer
+// and execute on the executor's lanes, with up to EXECUTOR_MAX_IN_FLIGHT
+// test cases between them. While this thread evaluates test case N-1
+// and mutates N+2, the executor runs N and ships N+1. Mutate and analyze
+// share the seed queue, so they take turns on this thread.
+static void fuzz_loop_async(fuzzer_t *fuzzer) {
+    executor_t *exec = &fuzzer->executor;
+    pipeline_stage_t *mutate = &fuzzer->pipeline[PIPELINE_MUTATE];
+    pipeline_stage_t *analyze = &fuzzer->pipeline[PIPELINE_ANALYZE];
+
+    // Lineage of the queued test cases, oldest at head, for evaluation
+    struct {
+        uint32_t depth;
+        strategy_t strategy;
+    } queued[EXECUTOR_MAX_IN_FLIGHT];
+    uint32_t head = 0;
+    uint32_t in_flight = 0;
+
+    for (;;) {
+        int dispatch = async_may_dispatch(fuzzer, in_flight);
+        if (!dispatch && in_flight == 0) {
+            break;
+        }
+
+        fuzzer_periodic(fuzzer);
+
+        // Mutate: top up the pipeline so the target never waits on the generator
+        while (dispatch && in_flight < EXECUTOR_MAX_IN_FLIGHT) {
+            uint64_t start = stats_now_ns();
+            testcase_t *tc = generate_testcase(fuzzer);
+            if (!tc) {
+                fprintf(stderr, "Failed to generate test case\n");
+                break;
+            }
+
+            exec->timeout_ms = fuzzer->exec_timeout ? fuzzer->exec_timeout : CALIBRATION_TIMEOUT_MS;
+            if (executor_submit(exec, tc) != 0) {
+                fprintf(stderr, "Failed to execute test case\n");
+                testcase_free(tc);
+                break;
+            }
+            stats_add(&mutate->busy_ns, stats_now_ns() - start);
+            stats_add(&mutate->items, 1);
+
+            uint32_t slot = (head + in_flight) % EXECUTOR_MAX_IN_FLIGHT;
+            queued[slot].depth = fuzzer->child_depth;
+            queued[slot].strategy = fuzzer->child_strategy;
+            in_flight++;
+            dispatch = async_may_dispatch(fuzzer, in_flight);
+        }
+
+        // Nothing queued and nothing could be: retrying would only spin
+        if (in_flight == 0) {
+            if (dispatch) {
+                fprintf(stderr, "Failed to keep the pipeline fed, stopping\n");
+                fuzzer->state = FUZZ_STATE_ERROR;
+            }
+            break;
+        }
+
+        // Take the oldest result; the target is busy with the rest meanwhile.
+        // Waiting here starves analysis, and with the pipeline full it is
+        // backpressure on mutation too.
+        executor_result_t result;
+        uint64_t start = stats_now_ns();
+        int full = in_flight == EXECUTOR_MAX_IN_FLIGHT;
+        if (executor_reap(exec, &fuzzer->coverage, &result) != 1) {
+            fprintf(stderr, "Failed to collect test case result\n");
+            break;
+        }
+        uint64_t now = stats_now_ns();
+        stats_add(&analyze->starved_ns, now - start);
+        if (full) {
+            stats_add(&mutate->blocked_ns, now - start);
+        }
+        fuzzer->child_depth = queued[head].depth;
+        fuzzer->child_strategy = queued[head].strategy;
+        head = (head + 1) % EXECUTOR_MAX_IN_FLIGHT;
+        in_flight--;
+
+        // Analyze
+        uint32_t crash = analyze_result(fuzzer, &result);
+        stats_add(&analyze->busy_ns, stats_now_ns() - now);
+        stats_add(&analyze->items, 1);
+        if (crash == 0) {
+            continue;
+        }
+
+        // What was queued behind the crash ran on a target going down
+        drain_in_flight(fuzzer, in_flight, crash);
+        in_flight = 0;
+
+        if (recover_and_triage(fuzzer, crash) != 0) {
+            if (fuzzer->state == FUZZ_STATE_RUNNING) {
+                fprintf(stderr, "Failed to recover the target, stopping\n");
+                fuzzer->state = FUZZ_STATE_CRASHED;
+            }
+            break;
+        }
+    }
+
+    drain_in_flight(fuzzer, in_flight, 0);
+}
+
+// Main fuzzing loop
+int fuzzer_run(fuzzer_t *fuzzer) {
+    if (!fuzzer || fuzzer->state == FUZZ_STATE_ERROR) {
+        return -1;
     }
 
+    fuzzer->state = FUZZ_STATE_RUNNING;
+    fuzzer->last_checkpoint = time(NULL);
+    fuzzer->last_stats = fuzzer->last_checkpoint;
+    fuzzer->start_execs = fuzzer->exec_count;
+    fuzzer->last_stats_execs = fuzzer->exec_count;
+
+    if (fuzzer->farm) {
+        farm_run(fuzzer);
+    } else if (fuzzer->executor.ops->submit) {
+        fuzz_loop_async(fuzzer);
+    } else {
+        fuzz_loop(fuzzer);
+    }
+
+    // Leave a checkpoint and final stats behind however the loop ended
+    fuzzer_checkpoint(fuzzer);
+    fuzzer_write_stats(fuzzer);
+    fuzzer_publish_stats(fuzzer);
+
     return 0;
 }
 
@@ -92,125 +529,273 @@ void fuzzer_cleanup(fuzzer_t *fuzzer) {
         return;
     }
 
-    // Disconnect from device
-    device_disconnect(&fuzzer->device);
+    // Stop the watchdog before the executor it kills
+    watchdog_stop(&fuzzer->watchdog);
+
+    // Shut down the executor backend, or every device of the farm
+    executor_cleanup(&fuzzer->executor);
+    farm_stop(fuzzer);
+
+    // Crashes already saved still get triaged unless interrupted; the
+    // rest are left for --resume
+    uint32_t queued = triage_queued(&fuzzer->triage);
+    if (queued > 0) {
+        printf("Triaging %u queued crashes, interrupt to leave them for --resume\n", queued);
+    }
+    triage_stop(&fuzzer->triage, triage_defer);
+    minimizer_set_cancel(NULL);
 
     // Clean up coverage tracking
     coverage_cleanup(&fuzzer->coverage);
 
-    // Free test cases
-    for (uint32_t i = 0; i < fuzzer->testcase_count; i++) {
-        testcase_free(&fuzzer->testcases[i]);
-    }
-    free(fuzzer->testcases);
+    // Free seed queue
+    queue_cleanup(&fuzzer->queue);
+
+    // Close the corpus store
+    corpus_close(&fuzzer->corpus);
+
+    // Remove the live stats segment
+    shmstats_destroy(fuzzer->shm, fuzzer->shm_path);
+
+    // Release pooled test case buffers
+    testcase_pool_cleanup(&fuzzer->pool);
+
+    // Free dedup sets
+    hashset_cleanup(&fuzzer->corpus_hashes);
+    hashset_cleanup(&fuzzer->path_hashes);
+    hashset_cleanup(&fuzzer->hang_hashes);
 
     memset(fuzzer, 0, sizeof(fuzzer_t));
 }
 
+// Derive a child from a queue entry by stacking mutations
+static testcase_t *mutate_parent(fuzzer_t *fuzzer, const queue_entry_t *parent, uint64_t start) {
+    testcase_t *tc = testcase_pool_acquire(&fuzzer->pool);
+    if (!tc) {
+        return NULL;
+    }
+    memcpy(tc->data, parent->data, parent->size);
+    tc->size = parent->size;
+    tc->parent = parent->data;
+    tc->parent_size = parent->size;
+
+    uint64_t mutate_start = stats_now_ns();
+    histogram_record(&fuzzer->stages[STAGE_GENERATE], mutate_start - start);
+
+    // Stack 2-16 mutations, AFL havoc style
+    int stack = 1 << (1 + rng_below(&fuzzer->rng, 4));
+    for (int i = 0; i < stack; i++) {
+        if (rng_below(&fuzzer->rng, 4) == 0) {
+            testcase_mutate_advanced(tc, &fuzzer->rng);
+        } else {
+            testcase_mutate(tc, &fuzzer->rng);
+        }
+    }
+
+    histogram_record(&fuzzer->stages[STAGE_MUTATE], stats_now_ns() - mutate_start);
+
+    fuzzer->child_depth = parent->depth + 1;
+    fuzzer->child_strategy = STRATEGY_HAVOC;
+    return tc;
+}
+
+// Rerun a test case from the corpus store to rebuild its coverage and queue entry
+static testcase_t *requeue_testcase(fuzzer_t *fuzzer, uint64_t start) {
+    uint32_t index = fuzzer->requeue_next++;
+    size_t size;
+    const uint8_t *data = corpus_data(&fuzzer->corpus, index, &size);
+    if (!data || size == 0 || size > MAX_TESTCASE_SIZE) {
+        return NULL;
+    }
+
+    testcase_t *tc = testcase_pool_acquire(&fuzzer->pool);
+    if (!tc) {
+        return NULL;
+    }
+    memcpy(tc->data, data, size);
+    tc->size = size;
+    tc->corpus_index = index;
+    histogram_record(&fuzzer->stages[STAGE_GENERATE], stats_now_ns() - start);
+
+    fuzzer->child_depth = 0;
+    fuzzer->child_strategy = STRATEGY_HAVOC;
+    return tc;
+}
+
 // Helper function to generate test cases
 testcase_t *generate_testcase(fuzzer_t *fuzzer) {
-    testcase_t *tc = malloc(sizeof(testcase_t));
+    uint64_t start = stats_now_ns();
+
+    // After a resume, test cases saved since the checkpoint come first
+    if (fuzzer->requeue_next < fuzzer->requeue_end) {
+        return requeue_testcase(fuzzer, start);
+    }
+
+    // Mutate a parent from the seed queue once there is one
+    queue_entry_t *parent = queue_next(&fuzzer->queue);
+    if (parent) {
+        return mutate_parent(fuzzer, parent, start);
+    }
+
+    testcase_t *tc = testcase_pool_acquire(&fuzzer->pool);
     if (!tc) {
         return NULL;
     }
 
     // Generate a test case with a mix of strategies
-    size_t size = 64 + (rand() % (MAX_TESTCASE_SIZE - 64));  // Minimum 64 bytes
-    tc->data = malloc(size);
-    if (!tc->data) {
-        free(tc);
-        return NULL;
-    }
+    size_t size = 64 + rng_below(&fuzzer->rng, MAX_TESTCASE_SIZE - 64);  // Minimum 64 bytes
     tc->size = size;
 
     // Fill with initial pattern
-    for (size_t i = 0; i < size; i++) {
-        tc->data[i] = rand() % 256;
-    }
+    rng_fill(&fuzzer->rng, tc->data, size);
+
+    uint64_t mutate_start = stats_now_ns();
+    histogram_record(&fuzzer->stages[STAGE_GENERATE], mutate_start - start);
 
     // Apply mutation strategies
-    int strategy = rand() % 5;
+    strategy_t strategy = STRATEGY_KERNEL_STRUCT + rng_below(&fuzzer->rng, 5);
     switch (strategy) {
-        case 0:  // Kernel structure mutation
-            mutate_kernel_struct(tc, &kernel_structs[rand() % NUM_KERNEL_STRUCTS]);
+        case STRATEGY_KERNEL_STRUCT:
+            mutate_kernel_struct(tc, &fuzzer->rng, &kernel_structs[rng_below(&fuzzer->rng, NUM_KERNEL_STRUCTS)]);
             break;
-        case 1:  // Memory pattern mutation
-            mutate_memory_pattern(tc);
+        case STRATEGY_MEMORY_PATTERN:
+            mutate_memory_pattern(tc, &fuzzer->rng);
             break;
-        case 2:  // System call mutation
-            mutate_syscall(tc);
+        case STRATEGY_SYSCALL:
+            mutate_syscall(tc, &fuzzer->rng);
             break;
-        case 3:  // IOCTL mutation
-            mutate_ioctl(tc);
+        case STRATEGY_IOCTL:
+            mutate_ioctl(tc, &fuzzer->rng);
             break;
-        case 4:  // Mach message mutation
-            mutate_mach_msg(tc);
+        case STRATEGY_MACH_MSG:
+            mutate_mach_msg(tc, &fuzzer->rng);
+            break;
+        default:
             break;
     }
+    histogram_record(&fuzzer->stages[STAGE_MUTATE], stats_now_ns() - mutate_start);
 
     tc->hash = 0;  // Will be computed when needed
     tc->exec_time = 0;
     tc->coverage_count = 0;
+    tc->path_hash = 0;
+    tc->novelty = COVERAGE_NONE;
+    tc->new_path = 0;
+    fuzzer->child_depth = 0;
+    fuzzer->child_strategy = strategy;
 
     return tc;
 }
 
-// Helper function to execute test case on device
+// Set the exec timeout from the exec times seen so far, once there are enough
+static void calibrate_timeout(fuzzer_t *fuzzer) {
+    const histogram_t *h = &fuzzer->stages[STAGE_EXECUTE];
+    if (atomic_load_explicit(&h->count, memory_order_relaxed) < CALIBRATION_EXECS) {
+        return;
+    }
+
+    uint64_t p95_ms = histogram_percentile(h, 95.0) / 1000000;
+    uint64_t timeout = p95_ms * TIMEOUT_MULTIPLIER;
+    if (timeout < TIMEOUT_MIN_MS) {
+        timeout = TIMEOUT_MIN_MS;
+    }
+    if (timeout > CALIBRATION_TIMEOUT_MS) {
+        timeout = CALIBRATION_TIMEOUT_MS;
+    }
+
+    fuzzer->exec_timeout = timeout;
+    printf("Calibrated exec timeout: %u ms\n", fuzzer->exec_timeout);
+}
+
+// Helper function to execute test case on the executor backend
 int execute_testcase(fuzzer_t *fuzzer, testcase_t *tc) {
     if (!fuzzer || !tc || !tc->data) {
         return -1;
     }
 
-    // Create a temporary file for the test case
-    char temp_path[256];
-    snprintf(temp_path, sizeof(temp_path), "/tmp/fuzzkrieg_%d", getpid());
-    if (testcase_save(tc, temp_path) != 0) {
+    // Ship the test case to the target
+    uint64_t start = stats_now_ns();
+    if (executor_load(&fuzzer->executor, tc) != 0) {
         return -1;
     }
-
-    // Transfer test case to device
-    if (device_transfer_file(&fuzzer->device, temp_path, "/var/root/testcase") != 0) {
-        unlink(temp_path);
+    uint64_t run_start = stats_now_ns();
+
+    // Run test case under the watchdog
+    tc->timed_out = 0;
+    fuzzer->executor.timeout_ms = fuzzer->exec_timeout ? fuzzer->exec_timeout : CALIBRATION_TIMEOUT_MS;
+    watchdog_arm(&fuzzer->watchdog, fuzzer->executor.timeout_ms);
+    int ret = executor_run(&fuzzer->executor, tc);
+    if (watchdog_disarm(&fuzzer->watchdog)) {
+        tc->timed_out = 1;  // Backends that time out on their own side set this too
+    }
+    if (ret != 0) {
         return -1;
     }
 
-    // Execute test case on device
-    char cmd[512];
-    snprintf(cmd, sizeof(cmd), "chmod +x /var/root/testcase && /var/root/testcase");
-    if (device_execute_command(&fuzzer->device, cmd) != 0) {
-        unlink(temp_path);
+    record_exec(fuzzer, tc, run_start - start, stats_now_ns() - run_start);
+    return 0;
+}
+
+// Account for one exec, wherever it ran, and calibrate the timeout from it
+void record_exec(fuzzer_t *fuzzer, testcase_t *tc, uint64_t transfer_ns, uint64_t run_ns) {
+    histogram_record(&fuzzer->stages[STAGE_TRANSFER], transfer_ns);
+    histogram_record(&fuzzer->stages[STAGE_EXECUTE], run_ns);
+
+    // Execution time in microseconds
+    tc->exec_time = run_ns / 1000;
+
+    if (!fuzzer->exec_timeout) {
+        calibrate_timeout(fuzzer);
+    }
+}
+
+// Helper function to update coverage information
+int update_coverage(fuzzer_t *fuzzer, testcase_t *tc) {
+    if (!fuzzer || !tc) {
         return -1;
     }
 
     // Collect coverage information
-    if (device_collect_coverage(&fuzzer->device, &fuzzer->coverage) != 0) {
-        unlink(temp_path);
+    if (executor_collect_coverage(&fuzzer->executor, &fuzzer->coverage) != 0) {
         return -1;
     }
 
-    unlink(temp_path);
-    return 0;
+    return evaluate_coverage(fuzzer, tc);
 }
 
-// Helper function to update coverage information
-int update_coverage(fuzzer_t *fuzzer, testcase_t *tc) {
+// Classify the coverage in the coverage map and check it for anything new
+int evaluate_coverage(fuzzer_t *fuzzer, testcase_t *tc) {
     if (!fuzzer || !tc) {
         return -1;
     }
 
-    // Update coverage map
-    if (coverage_update(&fuzzer->coverage, fuzzer->coverage.map, fuzzer->coverage.map_size) != 0) {
+    // Bucket hit counts, counting the edges hit on the way
+    tc->coverage_count = coverage_classify(fuzzer->coverage.map, fuzzer->coverage.map_size);
+
+    // Most executions retrace a known path; reject those before any virgin map work
+    tc->path_hash = coverage_checksum(fuzzer->coverage.map, fuzzer->coverage.map_size);
+    int added = hashset_insert(&fuzzer->path_hashes, tc->path_hash);
+    if (added < 0) {
         return -1;
     }
+    tc->new_path = added;
 
-    // Update test case coverage count
-    tc->coverage_count = 0;
-    for (size_t i = 0; i < fuzzer->coverage.map_size; i++) {
-        if (fuzzer->coverage.map[i]) {
-            tc->coverage_count++;
+    if (tc->new_path) {
+        // Compare against the virgin map
+        int novelty = coverage_has_new_bits(&fuzzer->coverage, fuzzer->coverage.map, fuzzer->coverage.map_size);
+        if (novelty < 0) {
+            return -1;
         }
+        tc->novelty = novelty;
+    } else {
+        // A known path cannot set virgin bits
+        tc->novelty = COVERAGE_NONE;
+        fuzzer->coverage.total_hits++;
     }
 
+    // Track edge frequencies for the power schedule
+    queue_record_hits(&fuzzer->queue, fuzzer->coverage.map);
+
     return 0;
 }
 
@@ -220,25 +805,14 @@ int check_crash(fuzzer_t *fuzzer) {
         return -1;
     }
 
-    // Check device status
-    if (device_check_status(&fuzzer->device) != 0) {
-        return 1;  // Device is in a crashed state
-    }
-
-    // Check for crash logs
-    char crash_log[256];
-    snprintf(crash_log, sizeof(crash_log), "/var/log/crash_%s.log", fuzzer->device.udid);
-    if (device_file_exists(&fuzzer->device, crash_log)) {
-        return 1;  // Crash log exists
-    }
-
-    return 0;  // No crash detected
+    return executor_check_crash(&fuzzer->executor);
 }
 
-// Helper function to handle crashes
-void handle_crash(fuzzer_t *fuzzer, testcase_t *tc) {
-    if (!fuzzer || !tc) {
-        return;
+// Save a crash and its log; exec is the executor that ran tc. Returns the
+// crash number, 0 on bad arguments.
+uint32_t save_crash(fuzzer_t *fuzzer, executor_t *exec, testcase_t *tc) {
+    if (!fuzzer || !exec || !tc) {
+        return 0;
     }
 
     fuzzer->crash_count++;
@@ -256,8 +830,23 @@ void handle_crash(fuzzer_t *fuzzer, testcase_t *tc) {
     snprintf(crash_log, sizeof(crash_log), "%s/crash_%u.log", 
              fuzzer->config.output_dir, fuzzer->crash_count);
     
-    // Copy crash log from device
-    device_copy_file(&fuzzer->device, "/var/log/crash.log", crash_log);
+    // Fetch crash log from the executor
+    executor_crash_log(exec, crash_log);
+
+    return fuzzer->crash_count;
+}
+
+// Analyze and minimize a saved crash; needs no executor, so it can run
+// while the target recovers
+void triage_crash(fuzzer_t *fuzzer, uint32_t crash) {
+    if (!fuzzer || crash == 0) {
+        return;
+    }
+
+    char crash_path[256];
+    snprintf(crash_path, sizeof(crash_path), "%s/crash_%u", fuzzer->config.output_dir, crash);
+    char crash_log[256];
+    snprintf(crash_log, sizeof(crash_log), "%s/crash_%u.log", fuzzer->config.output_dir, crash);
 
     // Analyze crash
     analyze_crash(crash_log, crash_path);
@@ -266,27 +855,71 @@ void handle_crash(fuzzer_t *fuzzer, testcase_t *tc) {
     minimize_testcase(crash_path, crash_log);
 }
 
+// Save a hang under hangs/ unless one with the same path is already there
+void handle_hang(fuzzer_t *fuzzer, testcase_t *tc) {
+    if (!fuzzer || !tc) {
+        return;
+    }
+
+    fuzzer->hang_count++;
+
+    // Dedup on the path taken up to the kill, kept apart from the main path set
+    if (executor_collect_coverage(&fuzzer->executor, &fuzzer->coverage) != 0) {
+        return;
+    }
+    save_hang(fuzzer, tc);
+}
+
+// Save a hang whose coverage is in the coverage map, once per path
+void save_hang(fuzzer_t *fuzzer, testcase_t *tc) {
+    if (!fuzzer || !tc) {
+        return;
+    }
+
+    coverage_classify(fuzzer->coverage.map, fuzzer->coverage.map_size);
+    uint64_t path_hash = coverage_checksum(fuzzer->coverage.map, fuzzer->coverage.map_size);
+    if (hashset_insert(&fuzzer->hang_hashes, path_hash) != 1) {
+        return;
+    }
+    fuzzer->unique_hangs++;
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s/hang_%016llx",
+             fuzzer->config.output_dir, HANGS_DIR, (unsigned long long)path_hash);
+    testcase_save(tc, path);
+}
+
 // Helper function to determine if a test case is interesting
 int is_interesting(fuzzer_t *fuzzer, testcase_t *tc) {
     if (!fuzzer || !tc) {
         return 0;
     }
 
-    // Check if this test case increases coverage
-    if (tc->coverage_count > fuzzer->coverage.unique_paths) {
-        return 1;
+    // Inputs that retrace a known path add nothing. Exec time is no
+    // reason to keep an input either: with measured times nearly every
+    // input differs from the last. Timing instead weighs each entry's
+    // energy in queue_calculate_energy.
+    if (!tc->new_path) {
+        return 0;
     }
 
-    // Check if this test case has unique execution time
-    if (tc->exec_time > 0 && tc->exec_time < fuzzer->config.timeout) {
+    // A new path must also set virgin bits: a new edge or a new hit-count
+    // bucket. New combinations of what was already seen are not kept.
+    if (tc->novelty == COVERAGE_NONE) {
+        return 0;
+    }
+
+    // A rerun of a stored test case is kept for its path alone
+    if (tc->corpus_index >= 0) {
         return 1;
     }
 
-    // Check if this test case has unique hash
-    for (uint32_t i = 0; i < fuzzer->testcase_count; i++) {
-        if (fuzzer->testcases[i].hash == tc->hash) {
-            return 0;
-        }
+    // Identical inputs are already in the corpus
+    if (!tc->hash) {
+        tc->hash = testcase_hash(tc);
+    }
+    if (hashset_contains(&fuzzer->corpus_hashes, tc->hash)) {
+        return 0;
     }
 
     return 1;
@@ -298,17 +931,34 @@ void save_interesting_case(fuzzer_t *fuzzer, testcase_t *tc) {
         return;
     }
 
-    char path[256];
-    snprintf(path, sizeof(path), "%s/interesting_%u", 
-             fuzzer->config.output_dir, fuzzer->testcase_count);
-    
-    if (testcase_save(tc, path) == 0) {
-        // Add to test case array
-        fuzzer->testcases = realloc(fuzzer->testcases, 
-                                  (fuzzer->testcase_count + 1) * sizeof(testcase_t));
-        if (fuzzer->testcases) {
-            memcpy(&fuzzer->testcases[fuzzer->testcase_count], tc, sizeof(testcase_t));
-            fuzzer->testcase_count++;
+    // A rerun after a resume is stored already
+    int64_t index = tc->corpus_index;
+    if (index < 0) {
+        // Record the content hash for dedup
+        if (!tc->hash) {
+            tc->hash = testcase_hash(tc);
+        }
+        hashset_insert(&fuzzer->corpus_hashes, tc->hash);
+
+        // Append to the corpus store; its mapping owns the copy
+        index = corpus_append(&fuzzer->corpus, tc->data, tc->size, tc->hash,
+                              tc->exec_time, tc->coverage_count);
+        if (index < 0) {
+            fprintf(stderr, "Failed to add test case to corpus store\n");
+            return;
         }
+        fuzzer->strategies[fuzzer->child_strategy].finds++;
+
+        char path[256];
+        snprintf(path, sizeof(path), "%s/interesting_%u",
+                 fuzzer->config.output_dir, (uint32_t)index);
+        testcase_save(tc, path);
+    }
+
+    // Feed it back as a parent for future mutations, viewing the stored copy
+    const uint8_t *data = corpus_data(&fuzzer->corpus, (uint32_t)index, NULL);
+    if (queue_add(&fuzzer->queue, data, tc->size, tc->exec_time,
+                  fuzzer->coverage.map, tc->path_hash, fuzzer->child_depth) != 0) {
+        fprintf(stderr, "Failed to add test case to seed queue\n");
     }
 } 
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/hash.h"
+
+// wyhash default secret
+static const uint64_t wyp[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+static inline void wymum(uint64_t *a, uint64_t *b) {
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t wymix(uint64_t a, uint64_t b) {
+    wymum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t wyr8(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t wyr4(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t wyr3(const uint8_t *p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+// Hash a buffer; three independent lanes keep large inputs fast
+uint64_t hash64(const void *data, size_t len, uint64_t seed) {
+    const uint8_t *p = data;
+    uint64_t a, b;
+
+    seed ^= wymix(seed ^ wyp[0], wyp[1]);
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+
+    a ^= wyp[1];
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ wyp[0] ^ len, b ^ wyp[1]);
+}
+
+// Zero marks an empty slot, so remap it
+static inline uint64_t slot_key(uint64_t key) {
+    return key ? key : 1;
+}
+
+// Initialize a hash set
+int hashset_init(hashset_t *set, size_t capacity) {
+    if (!set) {
+        return -1;
+    }
+
+    size_t cap = 16;
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+
+    set->slots = calloc(cap, sizeof(uint64_t));
+    if (!set->slots) {
+        return -1;
+    }
+
+    set->capacity = cap;
+    set->count = 0;
+    return 0;
+}
+
+// Free a hash set
+void hashset_cleanup(hashset_t *set) {
+    if (!set) {
+        return;
+    }
+
+    free(set->slots);
+    memset(set, 0, sizeof(hashset_t));
+}
+
+// Place a key with linear probing; the key must not be present
+static void hashset_place(uint64_t *slots, size_t capacity, uint64_t key) {
+    size_t mask = capacity - 1;
+    size_t i = key & mask;
+    while (slots[i]) {
+        i = (i + 1) & mask;
+    }
+    slots[i] = key;
+}
+
+// Double the table once it is half full
+static int hashset_grow(hashset_t *set) {
+    size_t capacity = set->capacity * 2;
+    uint64_t *slots = calloc(capacity, sizeof(uint64_t));
+    if (!slots) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < set->capacity; i++) {
+        if (set->slots[i]) {
+            hashset_place(slots, capacity, set->slots[i]);
+        }
+    }
+
+    free(set->slots);
+    set->slots = slots;
+    set->capacity = capacity;
+    return 0;
+}
+
+// Add a key to the set
+int hashset_insert(hashset_t *set, uint64_t key) {
+    if (!set || !set->slots) {
+        return -1;
+    }
+
+    key = slot_key(key);
+
+    size_t mask = set->capacity - 1;
+    for (size_t i = key & mask; set->slots[i]; i = (i + 1) & mask) {
+        if (set->slots[i] == key) {
+            return 0;
+        }
+    }
+
+    if ((set->count + 1) * 2 > set->capacity && hashset_grow(set) != 0) {
+        return -1;
+    }
+
+    hashset_place(set->slots, set->capacity, key);
+    set->count++;
+    return 1;
+}
+
+// Check whether a key is in the set
+int hashset_contains(const hashset_t *set, uint64_t key) {
+    if (!set || !set->slots) {
+        return 0;
+    }
+
+    key = slot_key(key);
+
+    size_t mask = set->capacity - 1;
+    for (size_t i = key & mask; set->slots[i]; i = (i + 1) & mask) {
+        if (set->slots[i] == key) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <string.h>
+#include "../../include/pipeline.h"
+
+// Stage names, in pipeline_stage_id_t order
+static const char *stage_names[PIPELINE_STAGES] = {
+    "mutate",
+    "transfer",
+    "execute",
+    "analyze"
+};
+
+// Names of the queues feeding each stage after the first
+static const char *queue_names[PIPELINE_QUEUES] = {
+    "submit",
+    "handoff",
+    "results"
+};
+
+// Set up an empty queue of capacity entries
+int pipeline_queue_init(pipeline_queue_t *q, uint32_t capacity) {
+    if (!q || capacity == 0 || capacity > PIPELINE_QUEUE_MAX || (capacity & (capacity - 1)) != 0) {
+        return -1;
+    }
+
+    memset(q, 0, sizeof(pipeline_queue_t));
+    q->capacity = capacity;
+    return 0;
+}
+
+// Snapshot a queue; counters are read one by one, so may be a push apart
+void pipeline_queue_stats(const pipeline_queue_t *q, pipeline_queue_stats_t *stats) {
+    memset(stats, 0, sizeof(pipeline_queue_stats_t));
+    if (!q) {
+        return;
+    }
+
+    stats->capacity = q->capacity;
+    stats->depth = pipeline_queue_depth(q);
+    stats->peak = atomic_load_explicit(&q->peak, memory_order_relaxed);
+    stats->pushes = atomic_load_explicit(&q->pushes, memory_order_relaxed);
+    stats->full = atomic_load_explicit(&q->full, memory_order_relaxed);
+    stats->empty = atomic_load_explicit(&q->empty, memory_order_relaxed);
+
+    uint64_t depth_sum = atomic_load_explicit(&q->depth_sum, memory_order_relaxed);
+    stats->mean_depth = stats->pushes ? (double)depth_sum / stats->pushes : 0.0;
+}
+
+// Snapshot a stage
+void pipeline_stage_stats(const pipeline_stage_t *stage, pipeline_stage_stats_t *stats) {
+    memset(stats, 0, sizeof(pipeline_stage_stats_t));
+    if (!stage) {
+        return;
+    }
+
+    stats->items = atomic_load_explicit(&stage->items, memory_order_relaxed);
+    stats->busy_ns = atomic_load_explicit(&stage->busy_ns, memory_order_relaxed);
+    stats->starved_ns = atomic_load_explicit(&stage->starved_ns, memory_order_relaxed);
+    stats->blocked_ns = atomic_load_explicit(&stage->blocked_ns, memory_order_relaxed);
+}
+
+// Name of a stage, as used in fuzzer_stats
+const char *pipeline_stage_name(pipeline_stage_id_t stage) {
+    if (stage >= PIPELINE_STAGES) {
+        return "unknown";
+    }
+
+    return stage_names[stage];
+}
+
+// Name of the queue feeding a stage, as used in fuzzer_stats
+const char *pipeline_queue_name(pipeline_stage_id_t consumer) {
+    if (consumer == PIPELINE_MUTATE || consumer >= PIPELINE_STAGES) {
+        return "unknown";
+    }
+
+    return queue_names[consumer - 1];
+}
@@ -0,0 +1,305 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/queue.h"
+
+// Upper bound of the schedule factor
+#define MAX_SCHEDULE_FACTOR 32.0
+
+// Initialize the seed queue
+int queue_init(seed_queue_t *queue, size_t map_size, power_schedule_t schedule) {
+    if (!queue || map_size == 0) {
+        return -1;
+    }
+
+    memset(queue, 0, sizeof(seed_queue_t));
+
+    queue->edge_hits = calloc(map_size, sizeof(uint32_t));
+    if (!queue->edge_hits) {
+        return -1;
+    }
+
+    if (hashset_init(&queue->paths, 256) != 0) {
+        free(queue->edge_hits);
+        queue->edge_hits = NULL;
+        return -1;
+    }
+
+    queue->map_size = map_size;
+    queue->schedule = schedule;
+    queue->current = UINT32_MAX;  // First selection starts at entry 0
+    return 0;
+}
+
+// Free the queue
+void queue_cleanup(seed_queue_t *queue) {
+    if (!queue) {
+        return;
+    }
+
+    free(queue->entries);
+    free(queue->edge_hits);
+    hashset_cleanup(&queue->paths);
+
+    memset(queue, 0, sizeof(seed_queue_t));
+}
+
+// Make room for one more entry
+static int queue_grow(seed_queue_t *queue) {
+    if (queue->count < queue->capacity) {
+        return 0;
+    }
+
+    uint32_t capacity = queue->capacity ? queue->capacity * 2 : 64;
+    queue_entry_t *entries = realloc(queue->entries, capacity * sizeof(queue_entry_t));
+    if (!entries) {
+        return -1;
+    }
+    queue->entries = entries;
+    queue->capacity = capacity;
+    return 0;
+}
+
+// Add an input to the queue, one entry per path
+int queue_add(seed_queue_t *queue, const uint8_t *data, size_t size, uint64_t exec_time,
+              const uint8_t *trace, uint64_t path_hash, uint32_t depth) {
+    if (!queue || !data || size == 0 || !trace) {
+        return -1;
+    }
+
+    // Entries are deduplicated by behaviour, not by bytes; the first input
+    // to reach a path keeps it
+    if (hashset_contains(&queue->paths, path_hash)) {
+        return 0;
+    }
+
+    if (queue_grow(queue) != 0) {
+        return -1;
+    }
+
+    queue_entry_t *entry = &queue->entries[queue->count];
+    memset(entry, 0, sizeof(queue_entry_t));
+
+    entry->data = data;
+    entry->size = size;
+    entry->exec_time = exec_time;
+    entry->path_hash = path_hash;
+    entry->depth = depth;
+
+    // Remember the rarest edge this input reaches
+    uint32_t rarest = UINT32_MAX;
+    for (size_t i = 0; i < queue->map_size; i++) {
+        if (!trace[i]) {
+            continue;
+        }
+        entry->coverage_count++;
+        if (queue->edge_hits[i] < rarest) {
+            rarest = queue->edge_hits[i];
+            entry->rare_edge = i;
+        }
+    }
+
+    if (hashset_insert(&queue->paths, path_hash) < 0) {
+        return -1;
+    }
+
+    queue->total_exec_time += exec_time;
+    queue->total_coverage += entry->coverage_count;
+    queue->count++;
+    return 0;
+}
+
+// Re-add an entry saved by a checkpoint, metadata and all
+int queue_restore(seed_queue_t *queue, const queue_entry_t *saved) {
+    if (!queue || !saved || !saved->data || saved->size == 0) {
+        return -1;
+    }
+
+    if (queue_grow(queue) != 0 || hashset_insert(&queue->paths, saved->path_hash) < 0) {
+        return -1;
+    }
+
+    queue->entries[queue->count++] = *saved;
+    queue->total_exec_time += saved->exec_time;
+    queue->total_coverage += saved->coverage_count;
+    return 0;
+}
+
+// Count one execution against every edge in the trace
+void queue_record_hits(seed_queue_t *queue, const uint8_t *trace) {
+    if (!queue || !trace) {
+        return;
+    }
+
+    // Skip empty words, traces are sparse
+    const uint64_t *words = (const uint64_t *)trace;
+    for (size_t w = 0; w < queue->map_size / sizeof(uint64_t); w++) {
+        if (!words[w]) {
+            continue;
+        }
+        for (size_t i = w * sizeof(uint64_t); i < (w + 1) * sizeof(uint64_t); i++) {
+            if (trace[i]) {
+                queue->edge_hits[i]++;
+            }
+        }
+    }
+}
+
+// Mean hit count of the rare edges of all entries
+static double mean_rare_hits(const seed_queue_t *queue) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < queue->count; i++) {
+        total += queue->edge_hits[queue->entries[i].rare_edge];
+    }
+    return queue->count ? (double)total / queue->count : 1.0;
+}
+
+// Compute how many children an entry gets, AFLFast style
+uint32_t queue_calculate_energy(const seed_queue_t *queue, const queue_entry_t *entry) {
+    if (!queue || !entry || queue->count == 0) {
+        return 0;
+    }
+
+    double score = 100.0;
+    double avg_exec = (double)queue->total_exec_time / queue->count;
+    double avg_cov = (double)queue->total_coverage / queue->count;
+
+    // Fast inputs get more energy
+    if (entry->exec_time && avg_exec > 0) {
+        double t = (double)entry->exec_time;
+        if (t * 0.1 > avg_exec) score = 10;
+        else if (t * 0.25 > avg_exec) score = 25;
+        else if (t * 0.5 > avg_exec) score = 50;
+        else if (t * 0.75 > avg_exec) score = 75;
+        else if (t * 4 < avg_exec) score = 300;
+        else if (t * 3 < avg_exec) score = 200;
+        else if (t * 2 < avg_exec) score = 150;
+    }
+
+    // Inputs with more coverage get more energy
+    if (avg_cov > 0) {
+        double c = (double)entry->coverage_count;
+        if (c * 0.3 > avg_cov) score *= 3;
+        else if (c * 0.5 > avg_cov) score *= 2;
+        else if (c * 0.75 > avg_cov) score *= 1.5;
+        else if (c * 3 < avg_cov) score *= 0.25;
+        else if (c * 2 < avg_cov) score *= 0.5;
+        else if (c * 1.5 < avg_cov) score *= 0.75;
+    }
+
+    // Large inputs are expensive to ship to the device
+    if (entry->size > 64 * 1024) {
+        score *= 0.5;
+    } else if (entry->size < 1024) {
+        score *= 1.5;
+    }
+
+    // Deeper entries were found by building on earlier finds
+    if (entry->depth >= 14) score *= 4;
+    else if (entry->depth >= 8) score *= 3;
+    else if (entry->depth >= 4) score *= 2;
+
+    // Schedule factor from times fuzzed and edge rarity
+    double hits = queue->edge_hits[entry->rare_edge];
+    double rarity = mean_rare_hits(queue) / (hits > 0 ? hits : 1);
+    double factor = 1.0;
+    double level = entry->fuzz_level;
+
+    switch (queue->schedule) {
+        case SCHEDULE_EXPLORE:
+            break;
+
+        case SCHEDULE_COE:
+            // Entries on frequently hit edges are skipped entirely
+            if (rarity < 1.0) {
+                return 0;
+            }
+            // fall through
+
+        case SCHEDULE_FAST:
+            factor = (entry->fuzz_level < 16 ? (double)(1u << entry->fuzz_level) : MAX_SCHEDULE_FACTOR) * rarity;
+            break;
+
+        case SCHEDULE_LIN:
+            factor = (level + 1) * rarity;
+            break;
+
+        case SCHEDULE_QUAD:
+            factor = (level + 1) * (level + 1) * rarity;
+            break;
+    }
+
+    if (factor > MAX_SCHEDULE_FACTOR) {
+        factor = MAX_SCHEDULE_FACTOR;
+    }
+    score *= factor;
+
+    double energy = score / 100.0 * QUEUE_BASE_ENERGY;
+    if (energy < 1) {
+        return 1;
+    }
+    if (energy > QUEUE_MAX_ENERGY) {
+        return QUEUE_MAX_ENERGY;
+    }
+    return (uint32_t)energy;
+}
+
+// Select the parent for the next child
+queue_entry_t *queue_next(seed_queue_t *queue) {
+    if (!queue || queue->count == 0) {
+        return NULL;
+    }
+
+    if (queue->energy_left == 0) {
+        uint32_t energy = 0;
+
+        // Move on to the next entry that has energy left
+        for (uint32_t tries = 0; tries < queue->count && energy == 0; tries++) {
+            uint32_t next = queue->current + 1;
+            if (next >= queue->count) {
+                if (queue->current != UINT32_MAX) {
+                    queue->cycles++;
+                }
+                next = 0;
+            }
+            queue->current = next;
+
+            queue_entry_t *entry = &queue->entries[queue->current];
+            energy = queue_calculate_energy(queue, entry);
+            entry->fuzz_level++;
+        }
+
+        queue->energy_left = energy ? energy : 1;
+    }
+
+    queue->energy_left--;
+    return &queue->entries[queue->current];
+}
+
+// Parse a schedule name
+int queue_parse_schedule(const char *name, power_schedule_t *schedule) {
+    static const struct {
+        const char *name;
+        power_schedule_t schedule;
+    } schedules[] = {
+        { "explore", SCHEDULE_EXPLORE },
+        { "fast", SCHEDULE_FAST },
+        { "exponential", SCHEDULE_FAST },
+        { "coe", SCHEDULE_COE },
+        { "lin", SCHEDULE_LIN },
+        { "quad", SCHEDULE_QUAD }
+    };
+
+    if (!name || !schedule) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < sizeof(schedules) / sizeof(schedules[0]); i++) {
+        if (strcmp(schedules[i].name, name) == 0) {
+            *schedule = schedules[i].schedule;
+            return 0;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,56 @@
+#include <stdint.h>
+#include <string.h>
+#include "../../include/rng.h"
+
+// splitmix64 step, used to expand a single seed into the full state
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Seed the generator
+void rng_seed(rng_t *rng, uint64_t seed) {
+    if (!rng) {
+        return;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&seed);
+    }
+}
+
+// Fill a buffer with random bytes
+void rng_fill(rng_t *rng, uint8_t *buf, size_t n) {
+    if (!rng || !buf) {
+        return;
+    }
+
+    // Keep the state in registers for the bulk of the buffer
+    rng_t local = *rng;
+
+    while (n >= 4 * sizeof(uint64_t)) {
+        uint64_t words[4] = {
+            rng_next(&local), rng_next(&local),
+            rng_next(&local), rng_next(&local)
+        };
+        memcpy(buf, words, sizeof(words));
+        buf += sizeof(words);
+        n -= sizeof(words);
+    }
+
+    while (n >= sizeof(uint64_t)) {
+        uint64_t word = rng_next(&local);
+        memcpy(buf, &word, sizeof(word));
+        buf += sizeof(word);
+        n -= sizeof(word);
+    }
+
+    if (n > 0) {
+        uint64_t word = rng_next(&local);
+        memcpy(buf, &word, n);
+    }
+
+    *rng = local;
+}
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../../include/shmstats.h"
+
+// Give up on a snapshot after this many torn reads
+#define READ_RETRIES 1000
+
+// Directory holding the segments
+const char *shmstats_dir(void) {
+    const char *dir = getenv(SHMSTATS_DIR_ENV);
+    return dir && *dir ? dir : SHMSTATS_DIR;
+}
+
+// Create and map this instance's segment
+shmstats_t *shmstats_create(char *path, size_t path_size) {
+    if (!path || path_size == 0) {
+        return NULL;
+    }
+
+    const char *dir = shmstats_dir();
+    mkdir(dir, 0755);
+    snprintf(path, path_size, "%s/%d%s", dir, (int)getpid(), SHMSTATS_SUFFIX);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (ftruncate(fd, sizeof(shmstats_t)) != 0) {
+        close(fd);
+        unlink(path);
+        return NULL;
+    }
+
+    shmstats_t *stats = mmap(NULL, sizeof(shmstats_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (stats == MAP_FAILED) {
+        unlink(path);
+        return NULL;
+    }
+
+    // The magic goes in last so readers never see a half-initialized header
+    stats->version = SHMSTATS_VERSION;
+    stats->size = sizeof(shmstats_t);
+    stats->pid = getpid();
+    atomic_thread_fence(memory_order_release);
+    stats->magic = SHMSTATS_MAGIC;
+
+    return stats;
+}
+
+// Unmap and remove this instance's segment
+void shmstats_destroy(shmstats_t *stats, const char *path) {
+    if (!stats) {
+        return;
+    }
+
+    munmap(stats, sizeof(shmstats_t));
+    if (path) {
+        unlink(path);
+    }
+}
+
+// Start an update; readers retry until it ends
+void shmstats_write_begin(shmstats_t *stats) {
+    uint64_t seq = atomic_load_explicit(&stats->seq, memory_order_relaxed);
+    atomic_store_explicit(&stats->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+// Finish an update
+void shmstats_write_end(shmstats_t *stats) {
+    uint64_t seq = atomic_load_explicit(&stats->seq, memory_order_relaxed);
+    atomic_store_explicit(&stats->seq, seq + 1, memory_order_release);
+}
+
+// Map another instance's segment read-only
+const shmstats_t *shmstats_attach(const char *path) {
+    if (!path) {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(shmstats_t)) {
+        close(fd);
+        return NULL;
+    }
+
+    const shmstats_t *stats = mmap(NULL, sizeof(shmstats_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (stats == MAP_FAILED) {
+        return NULL;
+    }
+
+    if (stats->magic != SHMSTATS_MAGIC || stats->version != SHMSTATS_VERSION ||
+        stats->size != sizeof(shmstats_t)) {
+        munmap((void *)stats, sizeof(shmstats_t));
+        return NULL;
+    }
+
+    return stats;
+}
+
+// Unmap a segment mapped by shmstats_attach
+void shmstats_detach(const shmstats_t *stats) {
+    if (stats) {
+        munmap((void *)stats, sizeof(shmstats_t));
+    }
+}
+
+// Copy the segment, retrying while the writer is mid-update
+int shmstats_read(const shmstats_t *stats, shmstats_t *snapshot) {
+    if (!stats || !snapshot) {
+        return -1;
+    }
+
+    for (int tries = 0; tries < READ_RETRIES; tries++) {
+        uint64_t before = atomic_load_explicit(&stats->seq, memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+
+        memcpy(snapshot, (const void *)stats, sizeof(shmstats_t));
+        atomic_thread_fence(memory_order_acquire);
+
+        uint64_t after = atomic_load_explicit(&stats->seq, memory_order_relaxed);
+        if (before == after) {
+            return 0;
+        }
+    }
+
+    return -1;
+}
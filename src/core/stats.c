@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../../include/fuzzkrieg.h"
+#include "../../include/executor.h"
+
+// Stage names, in stage_t order
+static const char *stage_names[NUM_STAGES] = {
+    "generate",
+    "mutate",
+    "transfer",
+    "execute",
+    "coverage",
+    "crash_check",
+    "save"
+};
+
+// Name of a stage, as used in fuzzer_stats
+const char *stats_stage_name(stage_t stage) {
+    if (stage >= NUM_STAGES) {
+        return "unknown";
+    }
+
+    return stage_names[stage];
+}
+
+// Midpoint of a bucket in nanoseconds
+static uint64_t bucket_midpoint(uint32_t bucket) {
+    if (bucket < (1u << HISTOGRAM_SUB_BITS)) {
+        return bucket;
+    }
+
+    uint32_t shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+    uint64_t sub = bucket & ((1u << HISTOGRAM_SUB_BITS) - 1);
+    uint64_t lower = ((1ULL << HISTOGRAM_SUB_BITS) | sub) << shift;
+    return lower + ((1ULL << shift) >> 1);
+}
+
+// Latency at a percentile (0-100), estimated from the bucket midpoint
+uint64_t histogram_percentile(const histogram_t *h, double percentile) {
+    if (!h) {
+        return 0;
+    }
+
+    // Sum the buckets rather than trusting count, which the writer may be updating
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        counts[i] = atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(percentile / 100.0 * total);
+    if (rank >= total) {
+        rank = total - 1;
+    }
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen > rank) {
+            return bucket_midpoint(i);
+        }
+    }
+
+    return bucket_midpoint(HISTOGRAM_BUCKETS - 1);
+}
+
+// Write output_dir/fuzzer_stats, replacing the previous one atomically
+int fuzzer_write_stats(fuzzer_t *fuzzer) {
+    if (!fuzzer) {
+        return -1;
+    }
+
+    uint64_t now = time(NULL);
+    uint64_t run_time = now - fuzzer->start_time;
+    uint64_t interval = now - fuzzer->last_stats;
+
+    char path[512], tmp_path[sizeof(path) + sizeof(".tmp")];
+    snprintf(path, sizeof(path), "%s/%s", fuzzer->config.output_dir, STATS_FILE);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *f = fopen(tmp_path, "w");
+    if (!f) {
+        return -1;
+    }
+
+    fprintf(f, "start_time        : %llu\n", (unsigned long long)fuzzer->start_time);
+    fprintf(f, "last_update       : %llu\n", (unsigned long long)now);
+    fprintf(f, "run_time          : %llu\n", (unsigned long long)run_time);
+    fprintf(f, "fuzzer_pid        : %d\n", (int)getpid());
+    fprintf(f, "executor          : %s\n", fuzzer->config.executor);
+    fprintf(f, "iterations        : %u\n", fuzzer->iteration);
+    fprintf(f, "execs_done        : %llu\n", (unsigned long long)fuzzer->exec_count);
+    fprintf(f, "execs_per_sec     : %.2f\n",
+            interval ? (double)(fuzzer->exec_count - fuzzer->last_stats_execs) / interval : 0.0);
+    fprintf(f, "execs_per_sec_avg : %.2f\n",
+            run_time ? (double)(fuzzer->exec_count - fuzzer->start_execs) / run_time : 0.0);
+    fprintf(f, "corpus_count      : %u\n", corpus_count(&fuzzer->corpus));
+    fprintf(f, "queue_count       : %u\n", fuzzer->queue.count);
+    fprintf(f, "cycles_done       : %u\n", fuzzer->queue.cycles);
+    fprintf(f, "unique_paths      : %u\n", fuzzer->coverage.unique_paths);
+    fprintf(f, "saved_crashes     : %u\n", fuzzer->crash_count);
+    fprintf(f, "total_hangs       : %llu\n", (unsigned long long)fuzzer->hang_count);
+    fprintf(f, "saved_hangs       : %u\n", fuzzer->unique_hangs);
+    fprintf(f, "exec_timeout      : %u\n", fuzzer->exec_timeout);
+
+    // Share of loop time per stage shows whether device I/O or host work dominates
+    uint64_t loop_ns = 0;
+    for (int i = 0; i < NUM_STAGES; i++) {
+        loop_ns += atomic_load_explicit(&fuzzer->stages[i].total_ns, memory_order_relaxed);
+    }
+
+    for (int i = 0; i < NUM_STAGES; i++) {
+        const histogram_t *h = &fuzzer->stages[i];
+        uint64_t total_ns = atomic_load_explicit(&h->total_ns, memory_order_relaxed);
+        const char *name = stats_stage_name(i);
+        char key[64];
+
+        snprintf(key, sizeof(key), "%s_p50_ns", name);
+        fprintf(f, "%-18s: %llu\n", key, (unsigned long long)histogram_percentile(h, 50.0));
+        snprintf(key, sizeof(key), "%s_p99_ns", name);
+        fprintf(f, "%-18s: %llu\n", key, (unsigned long long)histogram_percentile(h, 99.0));
+        snprintf(key, sizeof(key), "%s_share", name);
+        fprintf(f, "%-18s: %.1f%%\n", key, loop_ns ? 100.0 * total_ns / loop_ns : 0.0);
+    }
+
+    // Pipeline stages: the share of each one's time spent working, waiting
+    // for input and held back by the stage after it, then how full the
+    // queue feeding each stage runs
+    pipeline_stats_t pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    if (!fuzzer->farm && executor_pipeline_stats(&fuzzer->executor, &pipeline) == 0) {
+        pipeline_stage_stats(&fuzzer->pipeline[PIPELINE_MUTATE], &pipeline.stage[PIPELINE_MUTATE]);
+        pipeline_stage_stats(&fuzzer->pipeline[PIPELINE_ANALYZE], &pipeline.stage[PIPELINE_ANALYZE]);
+
+        for (int i = 0; i < PIPELINE_STAGES; i++) {
+            const pipeline_stage_stats_t *stage = &pipeline.stage[i];
+            uint64_t total_ns = stage->busy_ns + stage->starved_ns + stage->blocked_ns;
+            const char *name = pipeline_stage_name(i);
+            char key[64];
+
+            snprintf(key, sizeof(key), "%s_busy", name);
+            fprintf(f, "%-18s: %.1f%%\n", key, total_ns ? 100.0 * stage->busy_ns / total_ns : 0.0);
+            snprintf(key, sizeof(key), "%s_starved", name);
+            fprintf(f, "%-18s: %.1f%%\n", key, total_ns ? 100.0 * stage->starved_ns / total_ns : 0.0);
+            snprintf(key, sizeof(key), "%s_blocked", name);
+            fprintf(f, "%-18s: %.1f%%\n", key, total_ns ? 100.0 * stage->blocked_ns / total_ns : 0.0);
+        }
+
+        for (int i = PIPELINE_TRANSFER; i < PIPELINE_STAGES; i++) {
+            const pipeline_queue_stats_t *queue = &pipeline.queue[i - 1];
+            const char *name = pipeline_queue_name(i);
+            char key[64];
+
+            snprintf(key, sizeof(key), "%s_depth_avg", name);
+            fprintf(f, "%-18s: %.2f\n", key, queue->mean_depth);
+            snprintf(key, sizeof(key), "%s_depth_max", name);
+            fprintf(f, "%-18s: %llu\n", key, (unsigned long long)queue->peak);
+            snprintf(key, sizeof(key), "%s_full", name);
+            fprintf(f, "%-18s: %llu\n", key, (unsigned long long)queue->full);
+            snprintf(key, sizeof(key), "%s_empty", name);
+            fprintf(f, "%-18s: %llu\n", key, (unsigned long long)queue->empty);
+        }
+    }
+
+    if (fclose(f) != 0 || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+
+    fuzzer->last_stats = now;
+    fuzzer->last_stats_execs = fuzzer->exec_count;
+    return 0;
+}
+
+// Create the live stats segment and fill in its fixed fields
+int fuzzer_stats_segment_init(fuzzer_t *fuzzer) {
+    if (!fuzzer) {
+        return -1;
+    }
+
+    fuzzer->shm = shmstats_create(fuzzer->shm_path, sizeof(fuzzer->shm_path));
+    if (!fuzzer->shm) {
+        return -1;
+    }
+
+    shmstats_t *shm = fuzzer->shm;
+    snprintf(shm->executor, sizeof(shm->executor), "%s", fuzzer->config.executor);
+    snprintf(shm->target, sizeof(shm->target), "%s", fuzzer->config.target ? fuzzer->config.target : "");
+    shm->num_stages = NUM_STAGES;
+    for (int i = 0; i < NUM_STAGES; i++) {
+        snprintf(shm->stage_names[i], sizeof(shm->stage_names[i]), "%s", stats_stage_name(i));
+    }
+
+    fuzzer->last_publish_ns = stats_now_ns();
+    fuzzer->last_publish_execs = fuzzer->exec_count;
+    return 0;
+}
+
+// Publish live counters to the stats segment
+void fuzzer_publish_stats(fuzzer_t *fuzzer) {
+    if (!fuzzer || !fuzzer->shm) {
+        return;
+    }
+
+    // Work everything out first to keep the write window short
+    shmstats_stage_t stages[NUM_STAGES];
+    for (int i = 0; i < NUM_STAGES; i++) {
+        const histogram_t *h = &fuzzer->stages[i];
+        stages[i].p50_ns = histogram_percentile(h, 50.0);
+        stages[i].p99_ns = histogram_percentile(h, 99.0);
+        stages[i].total_ns = atomic_load_explicit(&h->total_ns, memory_order_relaxed);
+        stages[i].count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    }
+
+    uint64_t now_ns = stats_now_ns();
+    uint64_t elapsed = now_ns - fuzzer->last_publish_ns;
+    double execs_per_sec = elapsed ? (double)(fuzzer->exec_count - fuzzer->last_publish_execs) * 1e9 / elapsed : 0.0;
+    uint32_t edges = coverage_edges(&fuzzer->coverage);
+
+    shmstats_t *shm = fuzzer->shm;
+    shmstats_write_begin(shm);
+    shm->start_time = fuzzer->start_time;
+    shm->last_update = time(NULL);
+    shm->iterations = fuzzer->iteration;
+    shm->execs = fuzzer->exec_count;
+    shm->execs_per_sec = execs_per_sec;
+    shm->crashes = fuzzer->crash_count;
+    shm->hangs = fuzzer->unique_hangs;
+    shm->exec_timeout = fuzzer->exec_timeout;
+    shm->corpus_count = corpus_count(&fuzzer->corpus);
+    shm->queue_count = fuzzer->queue.count;
+    shm->unique_edges = edges;
+    memcpy(shm->stages, stages, sizeof(stages));
+    shmstats_write_end(shm);
+
+    fuzzer->last_publish = shm->last_update;
+    fuzzer->last_publish_ns = now_ns;
+    fuzzer->last_publish_execs = fuzzer->exec_count;
+}
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/triage.h"
+
+// Triage queued crashes in order; drains the queue before stopping
+static void *triage_thread(void *arg) {
+    triage_t *triage = arg;
+
+    pthread_mutex_lock(&triage->lock);
+    for (;;) {
+        if (triage->count == 0 || atomic_load(&triage->cancel)) {
+            if (triage->stop) {
+                break;
+            }
+            pthread_cond_wait(&triage->wake, &triage->lock);
+            continue;
+        }
+
+        uint32_t crash = triage->pending[triage->head];
+        triage->head = (triage->head + 1) % triage->capacity;
+        triage->count--;
+
+        pthread_mutex_unlock(&triage->lock);
+        triage->fn(triage->ctx, crash);
+        pthread_mutex_lock(&triage->lock);
+    }
+    pthread_mutex_unlock(&triage->lock);
+
+    return NULL;
+}
+
+// Double the queue, unwrapping it so the oldest crash comes first
+static int triage_grow(triage_t *triage) {
+    uint32_t capacity = triage->capacity * 2;
+    uint32_t *pending = malloc(capacity * sizeof(uint32_t));
+    if (!pending) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < triage->count; i++) {
+        pending[i] = triage->pending[(triage->head + i) % triage->capacity];
+    }
+    free(triage->pending);
+    triage->pending = pending;
+    triage->capacity = capacity;
+    triage->head = 0;
+    return 0;
+}
+
+// Start the triage thread
+int triage_start(triage_t *triage, triage_fn_t fn, void *ctx) {
+    if (!triage || !fn) {
+        return -1;
+    }
+
+    memset(triage, 0, sizeof(triage_t));
+    triage->fn = fn;
+    triage->ctx = ctx;
+
+    triage->pending = malloc(TRIAGE_QUEUE * sizeof(uint32_t));
+    if (!triage->pending) {
+        return -1;
+    }
+    triage->capacity = TRIAGE_QUEUE;
+
+    if (pthread_mutex_init(&triage->lock, NULL) != 0) {
+        free(triage->pending);
+        triage->pending = NULL;
+        return -1;
+    }
+    if (pthread_cond_init(&triage->wake, NULL) != 0) {
+        pthread_mutex_destroy(&triage->lock);
+        free(triage->pending);
+        triage->pending = NULL;
+        return -1;
+    }
+    if (pthread_create(&triage->thread, NULL, triage_thread, triage) != 0) {
+        fprintf(stderr, "Failed to start crash triage thread\n");
+        pthread_cond_destroy(&triage->wake);
+        pthread_mutex_destroy(&triage->lock);
+        free(triage->pending);
+        triage->pending = NULL;
+        return -1;
+    }
+
+    triage->running = 1;
+    return 0;
+}
+
+// Queue a saved crash for the triage thread
+void triage_submit(triage_t *triage, uint32_t crash) {
+    if (!triage || crash == 0) {
+        return;
+    }
+
+    // Without the thread, crashes are triaged by the caller
+    if (!triage->running) {
+        if (triage->fn) {
+            triage->fn(triage->ctx, crash);
+        }
+        return;
+    }
+
+    // The fuzz loop never waits on triage; the queue grows instead
+    pthread_mutex_lock(&triage->lock);
+    int queued = triage->count < triage->capacity || triage_grow(triage) == 0;
+    if (queued) {
+        triage->pending[(triage->head + triage->count) % triage->capacity] = crash;
+        triage->count++;
+        pthread_cond_signal(&triage->wake);
+    }
+    pthread_mutex_unlock(&triage->lock);
+
+    // Out of memory: triage here, holding the caller back until it is done
+    if (!queued) {
+        triage->fn(triage->ctx, crash);
+    }
+}
+
+// Crashes queued and not started yet
+uint32_t triage_queued(triage_t *triage) {
+    if (!triage || !triage->running) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&triage->lock);
+    uint32_t count = triage->count;
+    pthread_mutex_unlock(&triage->lock);
+    return count;
+}
+
+// Only an atomic store, so a signal handler may call it; the thread
+// notices once the crash in progress is done
+void triage_cancel(triage_t *triage) {
+    if (triage) {
+        atomic_store(&triage->cancel, 1);
+    }
+}
+
+// Stop the triage thread once the queue is drained or triage is cancelled
+void triage_stop(triage_t *triage, triage_fn_t leftover) {
+    if (!triage || !triage->running) {
+        return;
+    }
+
+    pthread_mutex_lock(&triage->lock);
+    triage->stop = 1;
+    pthread_cond_signal(&triage->wake);
+    pthread_mutex_unlock(&triage->lock);
+
+    pthread_join(triage->thread, NULL);
+    for (uint32_t i = 0; i < triage->count && leftover; i++) {
+        leftover(triage->ctx, triage->pending[(triage->head + i) % triage->capacity]);
+    }
+    triage->count = 0;
+
+    pthread_cond_destroy(&triage->wake);
+    pthread_mutex_destroy(&triage->lock);
+    free(triage->pending);
+    triage->pending = NULL;
+    triage->running = 0;
+}
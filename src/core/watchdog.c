@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../../include/watchdog.h"
+#include "../../include/stats.h"
+
+// Wall clock time remaining_ns from now, for pthread_cond_timedwait
+static struct timespec deadline_timespec(uint64_t remaining_ns) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    uint64_t ns = (uint64_t)ts.tv_nsec + remaining_ns;
+    ts.tv_sec += ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    return ts;
+}
+
+// Sleep until the armed deadline passes or is cancelled
+static void *watchdog_thread(void *arg) {
+    watchdog_t *wd = arg;
+
+    pthread_mutex_lock(&wd->lock);
+    while (!wd->stop) {
+        if (wd->deadline_ns == 0) {
+            pthread_cond_wait(&wd->cond, &wd->lock);
+            continue;
+        }
+
+        // Deadlines are monotonic; the wall clock only bounds each wait
+        uint64_t now = stats_now_ns();
+        if (now < wd->deadline_ns) {
+            struct timespec ts = deadline_timespec(wd->deadline_ns - now);
+            pthread_cond_timedwait(&wd->cond, &wd->lock, &ts);
+            continue;
+        }
+
+        // Fire under the lock so the exec cannot finish and rearm meanwhile
+        wd->deadline_ns = 0;
+        wd->fired = 1;
+        wd->fire(wd->ctx);
+    }
+    pthread_mutex_unlock(&wd->lock);
+
+    return NULL;
+}
+
+// Start the watchdog thread
+int watchdog_start(watchdog_t *wd, watchdog_fire_t fire, void *ctx) {
+    if (!wd || !fire) {
+        return -1;
+    }
+
+    memset(wd, 0, sizeof(watchdog_t));
+    wd->fire = fire;
+    wd->ctx = ctx;
+
+    if (pthread_mutex_init(&wd->lock, NULL) != 0) {
+        return -1;
+    }
+    if (pthread_cond_init(&wd->cond, NULL) != 0) {
+        pthread_mutex_destroy(&wd->lock);
+        return -1;
+    }
+    if (pthread_create(&wd->thread, NULL, watchdog_thread, wd) != 0) {
+        fprintf(stderr, "Failed to start watchdog thread\n");
+        pthread_cond_destroy(&wd->cond);
+        pthread_mutex_destroy(&wd->lock);
+        return -1;
+    }
+
+    wd->running = 1;
+    return 0;
+}
+
+// Fire unless disarmed within timeout_ms
+void watchdog_arm(watchdog_t *wd, uint32_t timeout_ms) {
+    if (!wd || !wd->running) {
+        return;
+    }
+
+    pthread_mutex_lock(&wd->lock);
+    wd->deadline_ns = stats_now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    wd->fired = 0;
+    pthread_cond_signal(&wd->cond);
+    pthread_mutex_unlock(&wd->lock);
+}
+
+// Cancel the deadline; returns 1 if it had already fired
+int watchdog_disarm(watchdog_t *wd) {
+    if (!wd || !wd->running) {
+        return 0;
+    }
+
+    // No wakeup needed: a thread waiting on a stale deadline sees it cleared
+    pthread_mutex_lock(&wd->lock);
+    wd->deadline_ns = 0;
+    int fired = wd->fired;
+    wd->fired = 0;
+    pthread_mutex_unlock(&wd->lock);
+
+    return fired;
+}
+
+// Stop and join the watchdog thread
+void watchdog_stop(watchdog_t *wd) {
+    if (!wd || !wd->running) {
+        return;
+    }
+
+    pthread_mutex_lock(&wd->lock);
+    wd->stop = 1;
+    pthread_cond_signal(&wd->cond);
+    pthread_mutex_unlock(&wd->lock);
+
+    pthread_join(wd->thread, NULL);
+    pthread_cond_destroy(&wd->cond);
+    pthread_mutex_destroy(&wd->lock);
+    wd->running = 0;
+}
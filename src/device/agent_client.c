@@ -0,0 +1,823 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "../../include/agent.h"
+#include "../../include/hash.h"
+
+// Pieces of an outgoing frame, sent without copying input bytes
+#define AGENT_MAX_IOV (2 + 2 * AGENT_MAX_BATCH)
+
+// Patches find where an input lines up with its base by blocks of this
+// many bytes; a shorter copy saves less than its run headers cost
+#define PATCH_BLOCK 16
+#define PATCH_HASH_MUL 0x100000001b3ULL
+
+// Grow a buffer to at least len bytes
+static int reserve(uint8_t **buf, size_t *size, size_t len) {
+    if (len <= *size) {
+        return 0;
+    }
+
+    size_t new_size = *size ? *size : 64 * 1024;
+    while (new_size < len) {
+        new_size *= 2;
+    }
+
+    uint8_t *p = realloc(*buf, new_size);
+    if (!p) {
+        return -1;
+    }
+    *buf = p;
+    *size = new_size;
+    return 0;
+}
+
+// Send every byte of every piece
+static int send_iov(agent_client_t *agent, struct iovec *iov, int count) {
+    if (agent->conn) {
+        for (int i = 0; i < count; i++) {
+            const char *p = iov[i].iov_base;
+            size_t left = iov[i].iov_len;
+            while (left > 0) {
+                uint32_t sent = 0;
+                if (idevice_connection_send(agent->conn, p, left, &sent) != IDEVICE_E_SUCCESS || sent == 0) {
+                    return -1;
+                }
+                p += sent;
+                left -= sent;
+            }
+        }
+        return 0;
+    }
+
+    while (count > 0) {
+        ssize_t n = writev(agent->fd, iov, count);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+
+        // Skip what went out, possibly stopping inside a piece
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+// Receive exactly len bytes within timeout_ms
+static int recv_full(agent_client_t *agent, void *buf, size_t len, uint32_t timeout_ms) {
+    uint8_t *p = buf;
+
+    while (len > 0) {
+        if (agent->conn) {
+            uint32_t got = 0;
+            if (idevice_connection_receive_timeout(agent->conn, (char *)p, len, &got, timeout_ms) != IDEVICE_E_SUCCESS ||
+                got == 0) {
+                return -1;
+            }
+            p += got;
+            len -= got;
+            continue;
+        }
+
+        struct pollfd pfd = { .fd = agent->fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, timeout_ms);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            return -1;
+        }
+
+        ssize_t n = read(agent->fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Send a frame whose payload is split over iov[1..count-1]; iov[0] is filled in here
+static int send_frame(agent_client_t *agent, agent_msg_t type, struct iovec *iov, int count) {
+    agent_frame_t frame = {
+        .magic = AGENT_MAGIC,
+        .type = type,
+        .seq = ++agent->seq
+    };
+
+    size_t length = 0;
+    for (int i = 1; i < count; i++) {
+        length += iov[i].iov_len;
+    }
+    if (length > AGENT_MAX_FRAME) {
+        fprintf(stderr, "Agent request of %zu bytes is too large\n", length);
+        return -1;
+    }
+    frame.length = length;
+
+    iov[0].iov_base = &frame;
+    iov[0].iov_len = sizeof(frame);
+    return send_iov(agent, iov, count);
+}
+
+// Receive the reply to the oldest request still waiting for one into the
+// frame buffer; replies come back in the order requests went out
+static int recv_frame(agent_client_t *agent, agent_msg_t expected, uint32_t timeout_ms, uint32_t *length) {
+    agent_frame_t frame;
+    if (recv_full(agent, &frame, sizeof(frame), timeout_ms) != 0) {
+        fprintf(stderr, "Failed to receive agent reply\n");
+        return -1;
+    }
+
+    if (frame.magic != AGENT_MAGIC || frame.length > AGENT_MAX_FRAME || frame.seq != agent->acked + 1) {
+        fprintf(stderr, "Malformed agent reply\n");
+        return -1;
+    }
+    agent->acked = frame.seq;
+
+    if (reserve(&agent->buf, &agent->buf_size, frame.length + 1) != 0 ||
+        recv_full(agent, agent->buf, frame.length, timeout_ms) != 0) {
+        return -1;
+    }
+
+    if (frame.type == AGENT_MSG_ERROR && frame.length >= sizeof(uint32_t)) {
+        agent->last_error = agent_get_u32(agent->buf);
+        if (agent->last_error != AGENT_ERR_CACHE_MISS) {
+            agent->buf[frame.length] = '\0';
+            fprintf(stderr, "Agent error %u: %s\n", agent->last_error, (char *)agent->buf + sizeof(uint32_t));
+        }
+        return -1;
+    }
+    if (frame.type != expected) {
+        fprintf(stderr, "Unexpected agent reply type %u\n", frame.type);
+        return -1;
+    }
+
+    *length = frame.length;
+    return 0;
+}
+
+// Agree on version, map size and batch limit
+static int agent_handshake(agent_client_t *agent, uint32_t map_size) {
+    agent_hello_t hello = {
+        .version = AGENT_VERSION,
+        .map_size = map_size < AGENT_MAX_MAP_SIZE ? map_size : AGENT_MAX_MAP_SIZE,
+        .max_batch = AGENT_MAX_BATCH
+    };
+
+    struct iovec iov[2] = { { 0 }, { &hello, sizeof(hello) } };
+    uint32_t length;
+    if (send_frame(agent, AGENT_MSG_HELLO, iov, 2) != 0 ||
+        recv_frame(agent, AGENT_MSG_HELLO_OK, AGENT_IO_TIMEOUT_MS, &length) != 0 ||
+        length < sizeof(agent_hello_t)) {
+        return -1;
+    }
+
+    memcpy(&hello, agent->buf, sizeof(hello));
+    if (hello.version != AGENT_VERSION || hello.max_batch == 0 || hello.map_size == 0 ||
+        hello.map_size > AGENT_MAX_MAP_SIZE) {
+        fprintf(stderr, "Agent handshake failed (version %u)\n", hello.version);
+        return -1;
+    }
+
+    agent->map_size = hello.map_size;
+    agent->max_batch = hello.max_batch < AGENT_MAX_BATCH ? hello.max_batch : AGENT_MAX_BATCH;
+    agent->cache_slots = hello.cache_slots;
+    return 0;
+}
+
+// Bytes at the start of a and b that agree, up to max, a word at a time
+static size_t match_length(const uint8_t *a, const uint8_t *b, size_t max) {
+    size_t n = 0;
+    while (n + 8 <= max) {
+        uint64_t x, y;
+        memcpy(&x, a + n, sizeof(x));
+        memcpy(&y, b + n, sizeof(y));
+        if (x != y) {
+            break;
+        }
+        n += 8;
+    }
+    while (n < max && a[n] == b[n]) {
+        n++;
+    }
+    return n;
+}
+
+// Bytes of data from i on that match the base from offset from on
+static size_t match_at(const uint8_t *base, size_t base_size, size_t from,
+                       const uint8_t *data, size_t size, size_t i) {
+    if (from >= base_size) {
+        return 0;
+    }
+    size_t max = base_size - from < size - i ? base_size - from : size - i;
+    return match_length(base + from, data + i, max);
+}
+
+// Polynomial hash of a PATCH_BLOCK window, rolled a byte at a time
+static uint64_t block_hash(const uint8_t *p) {
+    uint64_t h = 0;
+    for (size_t i = 0; i < PATCH_BLOCK; i++) {
+        h = h * PATCH_HASH_MUL + p[i];
+    }
+    return h;
+}
+
+// Slide a block hash one byte on, dropping out and taking in; top is
+// PATCH_HASH_MUL to the power PATCH_BLOCK - 1
+static uint64_t block_roll(uint64_t h, uint64_t top, uint8_t out, uint8_t in) {
+    return (h - out * top) * PATCH_HASH_MUL + in;
+}
+
+// Bucket of a block hash in the index
+static uint32_t block_bucket(const agent_client_t *agent, uint64_t h) {
+    return (uint32_t)((h * 0x9e3779b97f4a7c15ULL) >> (64 - agent->block_bits));
+}
+
+// Index the base's aligned blocks by hash, unless already done for it.
+// Children of one parent share the table.
+static int block_index(agent_client_t *agent, const uint8_t *base, size_t base_size, uint64_t base_hash) {
+    if (agent->blocks && agent->blocks_hash == base_hash && agent->blocks_size == base_size) {
+        return 0;
+    }
+
+    size_t count = base_size / PATCH_BLOCK;
+    uint32_t bits = 10;
+    while (bits < 24 && ((size_t)1 << bits) < 2 * count) {
+        bits++;
+    }
+    if (bits > agent->block_bits || !agent->blocks) {
+        uint32_t *blocks = realloc(agent->blocks, sizeof(uint32_t) << bits);
+        if (!blocks) {
+            return -1;
+        }
+        agent->blocks = blocks;
+    }
+    agent->block_bits = bits;
+    memset(agent->blocks, 0, sizeof(uint32_t) << bits);
+
+    // Filled from the end, so the first of repeated blocks wins
+    for (size_t i = count; i-- > 0;) {
+        agent->blocks[block_bucket(agent, block_hash(base + i * PATCH_BLOCK))] = i * PATCH_BLOCK + 1;
+    }
+    agent->blocks_hash = base_hash;
+    agent->blocks_size = base_size;
+    return 0;
+}
+
+// Append a run to the patch in out: a copy of the base, or else the
+// bytes at data. Returns -1 once it would reach limit.
+static int patch_run(uint8_t *out, size_t *n, size_t limit, uint32_t *runs,
+                     uint32_t base_offset, const uint8_t *data, size_t length) {
+    size_t len = sizeof(agent_run_t) + (base_offset == AGENT_RUN_LITERAL ? length : 0);
+    if (*n + len >= limit) {
+        return -1;
+    }
+
+    agent_run_t run = { .base_offset = base_offset, .length = length };
+    memcpy(out + *n, &run, sizeof(run));
+    if (base_offset == AGENT_RUN_LITERAL) {
+        memcpy(out + *n + sizeof(run), data, length);
+    }
+    *n += len;
+    (*runs)++;
+    return 0;
+}
+
+// Encode data as a patch against base into out. Returns the encoded size, or
+// 0 once it would reach limit and the input is better sent in full.
+static size_t patch_encode(agent_client_t *agent, uint8_t *out, size_t limit, const uint8_t *base,
+                           size_t base_size, uint64_t base_hash, const uint8_t *data, size_t size,
+                           uint64_t hash) {
+    size_t n = sizeof(agent_patch_t);
+    uint32_t runs = 0;
+    if (n >= limit) {
+        return 0;
+    }
+
+    // Where the base lines up with data: in step with the last copy, or
+    // end to end. Offsets wrap when the input grew, as unsigned ones do.
+    size_t shift = 0;
+    size_t end_shift = base_size - size;
+    int indexed = 0;
+    uint64_t h = 0, top = 1;
+    size_t hashed = SIZE_MAX;       // Where h was taken
+    for (size_t k = 1; k < PATCH_BLOCK; k++) {
+        top *= PATCH_HASH_MUL;
+    }
+
+    size_t literal = 0;             // First byte not covered by a run yet
+    size_t i = 0;
+    while (i < size) {
+        size_t from = i + shift;
+        size_t len = match_at(base, base_size, from, data, size, i);
+        if (len < PATCH_BLOCK) {
+            from = i + end_shift;
+            len = match_at(base, base_size, from, data, size, i);
+        }
+
+        // Neither holds after a block of misses: the input was cut or
+        // spliced here, so look the next block up in the base
+        if (len < PATCH_BLOCK && i - literal >= PATCH_BLOCK && i + PATCH_BLOCK <= size) {
+            if (!indexed) {
+                indexed = block_index(agent, base, base_size, base_hash) == 0 ? 1 : -1;
+            }
+            if (indexed > 0) {
+                h = hashed == i - 1 ? block_roll(h, top, data[i - 1], data[i + PATCH_BLOCK - 1])
+                                    : block_hash(data + i);
+                hashed = i;
+                uint32_t entry = agent->blocks[block_bucket(agent, h)];
+                if (entry) {
+                    from = entry - 1;
+                    len = match_at(base, base_size, from, data, size, i);
+                }
+            }
+        }
+        if (len < PATCH_BLOCK) {
+            i++;
+            continue;
+        }
+
+        // The copy may start before the miss that found it
+        while (i > literal && from > 0 && base[from - 1] == data[i - 1]) {
+            i--;
+            from--;
+            len++;
+        }
+        if (i > literal &&
+            patch_run(out, &n, limit, &runs, AGENT_RUN_LITERAL, data + literal, i - literal) != 0) {
+            return 0;
+        }
+        if (patch_run(out, &n, limit, &runs, (uint32_t)from, data + i, len) != 0) {
+            return 0;
+        }
+        shift = from - i;
+        i += len;
+        literal = i;
+    }
+    if (literal < size &&
+        patch_run(out, &n, limit, &runs, AGENT_RUN_LITERAL, data + literal, size - literal) != 0) {
+        return 0;
+    }
+
+    agent_patch_t patch = {
+        .base_hash = base_hash,
+        .hash = hash,
+        .size = size,
+        .runs = runs
+    };
+    memcpy(out, &patch, sizeof(patch));
+    return n;
+}
+
+// Connect to a stand-in agent over TCP
+int agent_connect_tcp(agent_client_t *agent, const char *host, uint16_t port, uint32_t map_size) {
+    if (!agent || !host) {
+        return -1;
+    }
+
+    memset(agent, 0, sizeof(agent_client_t));
+    agent->fd = -1;
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(host, service, &hints, &res) != 0) {
+        fprintf(stderr, "Failed to resolve agent host %s\n", host);
+        return -1;
+    }
+
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            agent->fd = fd;
+            break;
+        }
+        close(fd);
+    }
+    freeaddrinfo(res);
+
+    if (agent->fd < 0) {
+        fprintf(stderr, "Failed to connect to agent at %s:%u\n", host, port);
+        return -1;
+    }
+
+    agent->connected = 1;
+
+    // Requests are single writes followed by a wait; do not hold them back
+    int one = 1;
+    setsockopt(agent->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (agent_handshake(agent, map_size) != 0) {
+        agent_close(agent);
+        return -1;
+    }
+    return 0;
+}
+
+// Connect to the agent on the device through usbmux
+int agent_connect_device(agent_client_t *agent, idevice_t device, uint16_t port, uint32_t map_size) {
+    if (!agent || !device) {
+        return -1;
+    }
+
+    memset(agent, 0, sizeof(agent_client_t));
+    agent->fd = -1;
+
+    if (idevice_connect(device, port, &agent->conn) != IDEVICE_E_SUCCESS) {
+        agent->conn = NULL;
+        return -1;
+    }
+    agent->connected = 1;
+
+    if (agent_handshake(agent, map_size) != 0) {
+        agent_close(agent);
+        return -1;
+    }
+    return 0;
+}
+
+// One entry of a request: an input to run, or a base to cache ahead of it
+typedef struct {
+    agent_input_t header;
+    const uint8_t *data;         // Bytes sent in full, NULL for a patch
+    size_t patch_offset;
+} batch_entry_t;
+
+// Hash of a base; consecutive children share one, so the last is remembered
+static uint64_t base_hash_of(agent_client_t *agent, const uint8_t *base, size_t size) {
+    if (base != agent->hint || size != agent->hint_size) {
+        agent->hint = base;
+        agent->hint_size = size;
+        agent->hint_hash = hash64(base, size, 0);
+    }
+    return agent->hint_hash;
+}
+
+// Fill in an entry for data, as a patch against base if the agent has it and
+// that is smaller, and play it into the cache index as the agent will
+static void add_entry(agent_client_t *agent, batch_entry_t *entry, size_t *patch_len, uint8_t flags,
+                      const uint8_t *data, size_t size, uint64_t hash,
+                      const uint8_t *base, size_t base_size, uint64_t base_hash) {
+    memset(&entry->header, 0, sizeof(agent_input_t));
+    entry->header.size = size;
+    entry->header.kind = AGENT_INPUT_FULL;
+    entry->header.flags = flags;
+    entry->data = data;
+
+    int slot = base ? agent_cache_find(&agent->cache, base_hash) : -1;
+    size_t limit = size / AGENT_PATCH_MAX_RATIO;
+    if (slot >= 0 && reserve(&agent->patch, &agent->patch_size, *patch_len + limit) == 0) {
+        size_t len = patch_encode(agent, agent->patch + *patch_len, limit, base, base_size, base_hash,
+                                  data, size, hash);
+        if (len > 0) {
+            entry->header.size = len;
+            entry->header.kind = AGENT_INPUT_PATCH;
+            entry->data = NULL;
+            entry->patch_offset = *patch_len;
+            *patch_len += len;
+            agent_cache_touch(&agent->cache, slot);
+        }
+    }
+
+    int added;
+    agent_cache_insert(&agent->cache, hash, &added);
+}
+
+// Encode and send one batch; exec_recv takes its results
+static int exec_send(agent_client_t *agent, const agent_exec_t *inputs, uint32_t count, uint32_t timeout_ms) {
+    batch_entry_t entries[AGENT_MAX_BATCH];
+    uint32_t n_entries = 0;
+    size_t patch_len = 0;
+
+    // Patch against the input's base, else the input before it; patches are
+    // encoded before any iovec points into the buffer, which may move
+    int patching = agent->cache_slots >= AGENT_CACHE_SLOTS;
+    const uint8_t *prev = NULL;
+    size_t prev_size = 0;
+    uint64_t prev_hash = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!patching) {
+            add_entry(agent, &entries[n_entries++], &patch_len, 0, inputs[i].data, inputs[i].size, 0, NULL, 0, 0);
+            continue;
+        }
+
+        const uint8_t *base = prev;
+        size_t base_size = prev_size;
+        uint64_t base_hash = prev_hash;
+        if (inputs[i].base) {
+            uint64_t hash = base_hash_of(agent, inputs[i].base, inputs[i].base_size);
+
+            // A base the agent lacks goes first, if the batch has room; the
+            // children that follow it then cost a patch each
+            if (agent_cache_find(&agent->cache, hash) < 0 && n_entries + (count - i) < agent->max_batch) {
+                add_entry(agent, &entries[n_entries++], &patch_len, AGENT_INPUT_CACHE_ONLY,
+                          inputs[i].base, inputs[i].base_size, hash, base, base_size, base_hash);
+            }
+            if (agent_cache_find(&agent->cache, hash) >= 0) {
+                base = inputs[i].base;
+                base_size = inputs[i].base_size;
+                base_hash = hash;
+            }
+        }
+
+        prev = inputs[i].data;
+        prev_size = inputs[i].size;
+        prev_hash = hash64(prev, prev_size, 0);
+        add_entry(agent, &entries[n_entries++], &patch_len, 0, prev, prev_size, prev_hash,
+                  base, base_size, base_hash);
+    }
+
+    // Frame header, batch header, then a header and the bytes of each entry
+    agent_batch_t batch = { .count = n_entries, .timeout_ms = timeout_ms };
+    struct iovec iov[AGENT_MAX_IOV];
+    int n = 1;
+    iov[n].iov_base = &batch;
+    iov[n++].iov_len = sizeof(batch);
+    for (uint32_t i = 0; i < n_entries; i++) {
+        iov[n].iov_base = &entries[i].header;
+        iov[n++].iov_len = sizeof(agent_input_t);
+        if (entries[i].header.size > 0) {
+            iov[n].iov_base = entries[i].data ? (void *)entries[i].data : agent->patch + entries[i].patch_offset;
+            iov[n++].iov_len = entries[i].header.size;
+        }
+        agent->wire_bytes += entries[i].header.size;
+    }
+
+    if (send_frame(agent, AGENT_MSG_EXEC_BATCH, iov, n) != 0) {
+        // What the agent cached is unknown now; assume nothing
+        memset(&agent->cache, 0, sizeof(agent->cache));
+        return -1;
+    }
+    return 0;
+}
+
+// Receive and parse the results of the oldest batch in flight
+static int exec_recv(agent_client_t *agent, uint32_t count, uint32_t timeout_ms, agent_exec_result_t *results) {
+    uint32_t length;
+    uint32_t wait_ms = AGENT_IO_TIMEOUT_MS + count * timeout_ms;
+    agent->last_error = 0;
+    if (recv_frame(agent, AGENT_MSG_BATCH_RESULT, wait_ms, &length) != 0) {
+        return -1;
+    }
+
+    // Results in input order, each followed by its coverage
+    const uint8_t *p = agent->buf;
+    const uint8_t *end = agent->buf + length;
+    if (length < sizeof(uint32_t) || agent_get_u32(p) != count) {
+        fprintf(stderr, "Malformed agent batch result\n");
+        return -1;
+    }
+    p += sizeof(uint32_t);
+
+    for (uint32_t i = 0; i < count; i++) {
+        agent_result_t r;
+        if ((size_t)(end - p) < sizeof(r)) {
+            fprintf(stderr, "Malformed agent batch result\n");
+            return -1;
+        }
+        memcpy(&r, p, sizeof(r));
+        p += sizeof(r);
+        if ((size_t)(end - p) < r.coverage_size) {
+            fprintf(stderr, "Malformed agent batch result\n");
+            return -1;
+        }
+
+        results[i].status = r.status;
+        results[i].signal = r.signal;
+        results[i].exec_time_us = r.exec_time_us;
+        results[i].coverage_format = r.coverage_format;
+        results[i].coverage = p;
+        results[i].coverage_size = r.coverage_size;
+        p += r.coverage_size;
+    }
+
+    return 0;
+}
+
+// Send one batch and parse its results
+static int exec_batch(agent_client_t *agent, const agent_exec_t *inputs, uint32_t count,
+                      uint32_t timeout_ms, agent_exec_result_t *results) {
+    agent->last_error = 0;
+    if (exec_send(agent, inputs, count, timeout_ms) != 0) {
+        return -1;
+    }
+    if (exec_recv(agent, count, timeout_ms, results) != 0) {
+        memset(&agent->cache, 0, sizeof(agent->cache));
+        return -1;
+    }
+    return 0;
+}
+
+// Run a batch of inputs in one round trip
+int agent_exec_batch(agent_client_t *agent, const agent_exec_t *inputs, uint32_t count,
+                     uint32_t timeout_ms, agent_exec_result_t *results) {
+    if (!agent || !agent->connected || !inputs || !results || count == 0 || count > agent->max_batch) {
+        return -1;
+    }
+
+    int ret = exec_batch(agent, inputs, count, timeout_ms, results);
+
+    // The agent lost a base we counted on; the index is reset, so resend
+    if (ret != 0 && agent->last_error == AGENT_ERR_CACHE_MISS) {
+        ret = exec_batch(agent, inputs, count, timeout_ms, results);
+    }
+    if (ret != 0) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        agent->input_bytes += inputs[i].size;
+    }
+    agent->inputs += count;
+    agent->batches++;
+    return 0;
+}
+
+// Send a batch without waiting for its results
+int agent_exec_send(agent_client_t *agent, const agent_exec_t *inputs, uint32_t count, uint32_t timeout_ms) {
+    if (!agent || !agent->connected || !inputs || count == 0 || count > agent->max_batch) {
+        return -1;
+    }
+
+    if (exec_send(agent, inputs, count, timeout_ms) != 0) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        agent->input_bytes += inputs[i].size;
+    }
+    agent->inputs += count;
+    agent->batches++;
+    return 0;
+}
+
+// Receive the results of the oldest batch sent and not received yet
+int agent_exec_recv(agent_client_t *agent, uint32_t count, uint32_t timeout_ms, agent_exec_result_t *results) {
+    if (!agent || !agent->connected || !results || count == 0 || count > agent->max_batch) {
+        return -1;
+    }
+
+    return exec_recv(agent, count, timeout_ms, results);
+}
+
+// Requests sent whose replies have not been received
+uint32_t agent_pending(const agent_client_t *agent) {
+    if (!agent) {
+        return 0;
+    }
+
+    return agent->seq - agent->acked;
+}
+
+// Assume the agent caches nothing, so inputs go in full until it does again
+void agent_forget_cache(agent_client_t *agent) {
+    if (!agent) {
+        return;
+    }
+
+    memset(&agent->cache, 0, sizeof(agent->cache));
+}
+
+// Run a shell command on the agent's side
+int agent_command(agent_client_t *agent, const char *command, int32_t *status) {
+    if (!agent || !agent->connected || !command) {
+        return -1;
+    }
+
+    struct iovec iov[2] = { { 0 }, { (void *)command, strlen(command) } };
+    uint32_t length;
+    if (send_frame(agent, AGENT_MSG_COMMAND, iov, 2) != 0 ||
+        recv_frame(agent, AGENT_MSG_COMMAND_DONE, AGENT_IO_TIMEOUT_MS, &length) != 0 ||
+        length < sizeof(int32_t)) {
+        return -1;
+    }
+
+    if (status) {
+        *status = (int32_t)agent_get_u32(agent->buf);
+    }
+    return 0;
+}
+
+// Expand a result's coverage into a dense map
+int agent_coverage_decode(const agent_exec_result_t *result, uint8_t *map, size_t map_size) {
+    if (!result || !map) {
+        return -1;
+    }
+
+    const uint8_t *p = result->coverage;
+    const uint8_t *end = p + result->coverage_size;
+
+    switch (result->coverage_format) {
+        case AGENT_COV_SPARSE:
+            if (result->coverage_size % AGENT_COV_SPARSE_ENTRY != 0) {
+                return -1;
+            }
+            memset(map, 0, map_size);
+
+            // Eight entries per three words; indices past a smaller map are dropped
+            for (; end - p >= 8 * AGENT_COV_SPARSE_ENTRY; p += 8 * AGENT_COV_SPARSE_ENTRY) {
+                uint64_t w[3];
+                memcpy(w, p, sizeof(w));
+                uint64_t e[8] = {
+                    w[0], w[0] >> 24, (w[0] >> 48) | (w[1] << 16), w[1] >> 8,
+                    w[1] >> 32, (w[1] >> 56) | (w[2] << 8), w[2] >> 16, w[2] >> 40
+                };
+                for (int k = 0; k < 8; k++) {
+                    size_t index = e[k] & 0xffff;
+                    if (index < map_size) {
+                        map[index] = (uint8_t)(e[k] >> 16);
+                    }
+                }
+            }
+            for (; p < end; p += AGENT_COV_SPARSE_ENTRY) {
+                size_t index = p[0] | ((size_t)p[1] << 8);
+                if (index < map_size) {
+                    map[index] = p[2];
+                }
+            }
+            return 0;
+
+        case AGENT_COV_RUNS: {
+            size_t at = 0;
+            while (p < end) {
+                uint16_t skip, length;
+                if (end - p < AGENT_COV_RUN_HEADER) {
+                    return -1;
+                }
+                memcpy(&skip, p, sizeof(skip));
+                memcpy(&length, p + 2, sizeof(length));
+                p += AGENT_COV_RUN_HEADER;
+                if ((size_t)(end - p) < length || at + skip + length > map_size) {
+                    return -1;
+                }
+                memset(map + at, 0, skip);
+                memcpy(map + at + skip, p, length);
+                at += skip + length;
+                p += length;
+            }
+            memset(map + at, 0, map_size - at);
+            return 0;
+        }
+
+        case AGENT_COV_DENSE:
+            if (result->coverage_size > map_size) {
+                return -1;
+            }
+            memcpy(map, p, result->coverage_size);
+            memset(map + result->coverage_size, 0, map_size - result->coverage_size);
+            return 0;
+
+        default:
+            return -1;
+    }
+}
+
+// Say goodbye and close the connection
+void agent_close(agent_client_t *agent) {
+    if (!agent || !agent->connected) {
+        return;
+    }
+
+    struct iovec iov[1];
+    send_frame(agent, AGENT_MSG_BYE, iov, 1);
+
+    if (agent->conn) {
+        idevice_disconnect(agent->conn);
+    }
+    if (agent->fd >= 0) {
+        close(agent->fd);
+    }
+    free(agent->buf);
+    free(agent->patch);
+    free(agent->blocks);
+
+    memset(agent, 0, sizeof(agent_client_t));
+    agent->fd = -1;
+}
@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/stat.h>
+#include "../../include/fuzzkrieg.h"
+
+// The mover hands new reports to the copy service, which serves them over AFC
+#define CRASH_MOVER_SERVICE "com.apple.crashreportmover"
+#define CRASH_COPY_SERVICE "com.apple.crashreportcopymobile"
+#define CRASH_MOVER_TIMEOUT_MS 5000
+
+// Report names carry the time they were written, as YYYY-MM-DD-HHMMSS
+#define CRASH_STAMP_LEN 17
+
+// A report on the device newer than the cursor
+typedef struct {
+    char name[256];
+    uint64_t mtime;
+} crash_entry_t;
+
+// Ask the device to move new reports to the copy service; it says "ping" when done
+static int crash_move_reports(device_ctx_t *ctx) {
+    lockdownd_service_descriptor_t service = NULL;
+    if (device_start_service(ctx, CRASH_MOVER_SERVICE, &service) != 0) {
+        return -1;
+    }
+
+    idevice_connection_t conn = NULL;
+    int ret = -1;
+    if (idevice_connect(ctx->device, service->port, &conn) == IDEVICE_E_SUCCESS) {
+        if (!service->ssl_enabled || idevice_connection_enable_ssl(conn) == IDEVICE_E_SUCCESS) {
+            char ping[4];
+            uint32_t got = 0;
+            while (got < sizeof(ping)) {
+                uint32_t n = 0;
+                if (idevice_connection_receive_timeout(conn, ping + got, sizeof(ping) - got, &n,
+                                                       CRASH_MOVER_TIMEOUT_MS) != IDEVICE_E_SUCCESS || n == 0) {
+                    break;
+                }
+                got += n;
+            }
+            ret = got == sizeof(ping) && memcmp(ping, "ping", sizeof(ping)) == 0 ? 0 : -1;
+        }
+        idevice_disconnect(conn);
+    }
+
+    lockdownd_service_descriptor_free(service);
+    return ret;
+}
+
+// Connect an AFC client to the copy service
+static afc_client_t crash_connect(device_ctx_t *ctx) {
+    lockdownd_service_descriptor_t service = NULL;
+    if (device_start_service(ctx, CRASH_COPY_SERVICE, &service) != 0) {
+        return NULL;
+    }
+
+    afc_client_t afc = NULL;
+    afc_error_t ret = afc_client_new(ctx->device, service, &afc);
+    lockdownd_service_descriptor_free(service);
+    return ret == AFC_E_SUCCESS ? afc : NULL;
+}
+
+// Find the time stamp in a report name
+static int crash_name_stamp(const char *name, char *stamp) {
+    static const char pattern[] = "dddd-dd-dd-dddddd";
+    size_t len = strlen(name);
+
+    for (size_t i = 0; i + CRASH_STAMP_LEN <= len; i++) {
+        size_t j = 0;
+        while (j < CRASH_STAMP_LEN &&
+               (pattern[j] == 'd' ? isdigit((unsigned char)name[i + j]) : name[i + j] == pattern[j])) {
+            j++;
+        }
+        if (j == CRASH_STAMP_LEN) {
+            memcpy(stamp, name + i, CRASH_STAMP_LEN);
+            stamp[CRASH_STAMP_LEN] = '\0';
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Whether a name is a report, rather than a directory such as Retired/
+static int crash_is_report(const char *name) {
+    const char *ext = strrchr(name, '.');
+    return ext && ext != name &&
+           (strcmp(ext, ".ips") == 0 || strcmp(ext, ".crash") == 0 || strcmp(ext, ".panic") == 0);
+}
+
+// Modification time of a regular file; -1 for anything else
+static int crash_stat(afc_client_t afc, const char *name, uint64_t *mtime, afc_error_t *err) {
+    char remote[260];
+    snprintf(remote, sizeof(remote), "/%s", name);
+
+    char **info = NULL;
+    *err = afc_get_file_info(afc, remote, &info);
+    if (*err != AFC_E_SUCCESS) {
+        return -1;
+    }
+
+    int regular = 0, found = 0;
+    for (char **p = info; p && p[0] && p[1]; p += 2) {
+        if (strcmp(p[0], "st_mtime") == 0) {
+            *mtime = strtoull(p[1], NULL, 10);
+            found = 1;
+        } else if (strcmp(p[0], "st_ifmt") == 0) {
+            regular = strcmp(p[1], "S_IFREG") == 0;
+        }
+    }
+
+    afc_dictionary_free(info);
+    return regular && found ? 0 : -1;
+}
+
+// Order reports by modification time, then name
+static int crash_entry_newer(uint64_t mtime, const char *name, uint64_t than_mtime, const char *than_name) {
+    return mtime != than_mtime ? mtime > than_mtime : strcmp(name, than_name) > 0;
+}
+
+static int crash_entry_compare(const void *a, const void *b) {
+    const crash_entry_t *x = a, *y = b;
+    if (crash_entry_newer(x->mtime, x->name, y->mtime, y->name)) {
+        return 1;
+    }
+    return crash_entry_newer(y->mtime, y->name, x->mtime, x->name) ? -1 : 0;
+}
+
+// Load the cursor of a store, if it has one
+static void crash_load_cursor(device_crash_store_t *store, const char *dir) {
+    snprintf(store->dir, sizeof(store->dir), "%s", dir);
+    store->name[0] = '\0';
+    store->mtime = 0;
+    store->started = 0;
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, DEVICE_CRASH_CURSOR);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return;
+    }
+
+    // The name is empty if the device had no reports when the store started
+    unsigned long long mtime;
+    char name[256] = "";
+    if (fscanf(f, "%llu %255[^\n]", &mtime, name) >= 1) {
+        store->mtime = mtime;
+        snprintf(store->name, sizeof(store->name), "%s", name);
+        store->started = 1;
+    }
+    fclose(f);
+}
+
+// Persist the cursor, replacing the old one atomically
+static int crash_save_cursor(const device_crash_store_t *store) {
+    char path[512], tmp[520];
+    snprintf(path, sizeof(path), "%s/%s", store->dir, DEVICE_CRASH_CURSOR);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        return -1;
+    }
+    fprintf(f, "%llu %s\n", (unsigned long long)store->mtime, store->name);
+    if (fclose(f) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return rename(tmp, path);
+}
+
+// Stream one report into the store; it appears under its name only when complete
+static afc_error_t crash_copy(afc_client_t afc, const char *name, const char *path, int *local_error) {
+    char part[520];
+    snprintf(part, sizeof(part), "%s.part", path);
+
+    FILE *f = fopen(part, "wb");
+    if (!f) {
+        *local_error = 1;
+        return AFC_E_SUCCESS;
+    }
+
+    char remote[260];
+    snprintf(remote, sizeof(remote), "/%s", name);
+
+    uint64_t handle;
+    afc_error_t ret = afc_file_open(afc, remote, AFC_FOPEN_RDONLY, &handle);
+    if (ret == AFC_E_SUCCESS) {
+        char buffer[DEVICE_UPLOAD_CHUNK / 4];
+        uint32_t bytes_read;
+        while ((ret = afc_file_read(afc, handle, buffer, sizeof(buffer), &bytes_read)) == AFC_E_SUCCESS &&
+               bytes_read > 0) {
+            if (fwrite(buffer, 1, bytes_read, f) != bytes_read) {
+                *local_error = 1;
+                break;
+            }
+        }
+        afc_file_close(afc, handle);
+    }
+
+    if (fclose(f) != 0) {
+        *local_error = 1;
+    }
+    if (ret != AFC_E_SUCCESS || *local_error || rename(part, path) != 0) {
+        remove(part);
+        *local_error = *local_error || ret == AFC_E_SUCCESS;
+    }
+    return ret;
+}
+
+// Copy reports newer than the store's cursor into the store, oldest first,
+// and return how many were copied. Names carry their time stamp, so older
+// reports are skipped without a round trip each. A store without a cursor
+// starts at the newest report; the device's history is not copied.
+int device_get_crash_logs(device_ctx_t *ctx, const char *store_dir, device_report_fn report, void *arg) {
+    if (!ctx || !ctx->device || !store_dir) {
+        return -1;
+    }
+
+    device_crash_store_t *store = &ctx->crashes;
+    if (strcmp(store->dir, store_dir) != 0) {
+        mkdir(store_dir, 0755);
+        crash_load_cursor(store, store_dir);
+    }
+
+    // Reports only reach the copy service once moved; keep going on failure,
+    // as moved reports may still be waiting
+    crash_move_reports(ctx);
+
+    if (!store->afc && !(store->afc = crash_connect(ctx))) {
+        return -1;
+    }
+
+    char **names = NULL;
+    afc_error_t err = afc_read_directory(store->afc, "/", &names);
+    if (err != AFC_E_SUCCESS) {
+        afc_client_free(store->afc);
+        store->afc = NULL;
+        return -1;
+    }
+
+    // Without a cursor only the newest stamp matters
+    int baseline = !store->started;
+    char floor[CRASH_STAMP_LEN + 1] = "";
+    char stamp[CRASH_STAMP_LEN + 1];
+    if (baseline) {
+        for (char **n = names; n && *n; n++) {
+            if (crash_is_report(*n) && crash_name_stamp(*n, stamp) && strcmp(stamp, floor) > 0) {
+                memcpy(floor, stamp, sizeof(floor));
+            }
+        }
+    } else {
+        crash_name_stamp(store->name, floor);
+    }
+
+    crash_entry_t *fresh = malloc(DEVICE_CRASH_MAX_NEW * sizeof(crash_entry_t));
+    if (!fresh) {
+        afc_dictionary_free(names);
+        return -1;
+    }
+
+    size_t n_fresh = 0;
+    int ret = 0;
+    for (char **n = names; n && *n; n++) {
+        if (!crash_is_report(*n) || strchr(*n, '/') || strlen(*n) >= sizeof(fresh->name)) {
+            continue;
+        }
+        if (crash_name_stamp(*n, stamp) && strcmp(stamp, floor) < 0) {
+            continue;
+        }
+
+        uint64_t mtime = 0;
+        if (crash_stat(store->afc, *n, &mtime, &err) != 0) {
+            if (err != AFC_E_SUCCESS && err != AFC_E_OBJECT_NOT_FOUND) {
+                ret = -1;
+                break;
+            }
+            continue;
+        }
+        if (!crash_entry_newer(mtime, *n, store->mtime, store->name)) {
+            continue;
+        }
+
+        if (baseline) {
+            snprintf(store->name, sizeof(store->name), "%s", *n);
+            store->mtime = mtime;
+            continue;
+        }
+
+        // Past the per-poll cap, keep the oldest; the rest wait for the next poll
+        crash_entry_t entry = { .mtime = mtime };
+        snprintf(entry.name, sizeof(entry.name), "%s", *n);
+        if (n_fresh < DEVICE_CRASH_MAX_NEW) {
+            fresh[n_fresh++] = entry;
+        } else {
+            size_t newest = 0;
+            for (size_t i = 1; i < n_fresh; i++) {
+                if (crash_entry_compare(&fresh[i], &fresh[newest]) > 0) {
+                    newest = i;
+                }
+            }
+            if (crash_entry_compare(&entry, &fresh[newest]) < 0) {
+                fresh[newest] = entry;
+            }
+        }
+    }
+    afc_dictionary_free(names);
+
+    if (baseline && ret == 0) {
+        store->started = 1;
+        if (crash_save_cursor(store) != 0) {
+            fprintf(stderr, "Failed to save crash report cursor in %s\n", store->dir);
+        }
+    }
+
+    // Copy oldest first, moving the cursor past each report as it lands
+    qsort(fresh, n_fresh, sizeof(crash_entry_t), crash_entry_compare);
+    int copied = 0;
+    for (size_t i = 0; ret == 0 && i < n_fresh; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", store->dir, fresh[i].name);
+
+        int local_error = 0;
+        err = crash_copy(store->afc, fresh[i].name, path, &local_error);
+        if (err != AFC_E_SUCCESS || local_error) {
+            fprintf(stderr, "Failed to copy crash report %s\n", fresh[i].name);
+            ret = -1;
+            break;
+        }
+
+        snprintf(store->name, sizeof(store->name), "%s", fresh[i].name);
+        store->mtime = fresh[i].mtime;
+        if (crash_save_cursor(store) != 0) {
+            fprintf(stderr, "Failed to save crash report cursor in %s\n", store->dir);
+        }
+        copied++;
+
+        if (report) {
+            report(path, arg);
+        }
+    }
+    free(fresh);
+
+    // A dead connection is replaced on the next poll
+    if (ret != 0 && err != AFC_E_SUCCESS && err != AFC_E_OBJECT_NOT_FOUND) {
+        afc_client_free(store->afc);
+        store->afc = NULL;
+    }
+
+    return ret == 0 ? copied : -1;
+}
+
+// Drop the copy service connection
+void device_close_crash_logs(device_ctx_t *ctx) {
+    if (!ctx) {
+        return;
+    }
+
+    if (ctx->crashes.afc) {
+        afc_client_free(ctx->crashes.afc);
+        ctx->crashes.afc = NULL;
+    }
+}
@@ -1,13 +1,153 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <libimobiledevice/libimobiledevice.h>
 #include <libimobiledevice/lockdown.h>
 #include <libimobiledevice/installation_proxy.h>
 #include <libimobiledevice/afc.h>
 #include "../../include/fuzzkrieg.h"
 
+// AFC errors after which a client is dropped rather than reused
+static int afc_error_is_fatal(afc_error_t err) {
+    switch (err) {
+        case AFC_E_SUCCESS:
+        case AFC_E_OBJECT_NOT_FOUND:
+        case AFC_E_OBJECT_IS_DIR:
+        case AFC_E_OBJECT_EXISTS:
+        case AFC_E_PERM_DENIED:
+        case AFC_E_INVALID_ARG:
+        case AFC_E_NO_SPACE_LEFT:
+        case AFC_E_DIR_NOT_EMPTY:
+        case AFC_E_END_OF_DATA:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+// Start the AFC service and connect a new client
+static afc_client_t afc_connect(device_ctx_t *ctx) {
+    lockdownd_service_descriptor_t service = NULL;
+    if (device_start_service(ctx, "com.apple.afc", &service) != 0) {
+        return NULL;
+    }
+
+    afc_client_t afc = NULL;
+    afc_error_t ret = afc_client_new(ctx->device, service, &afc);
+    lockdownd_service_descriptor_free(service);
+    if (ret != AFC_E_SUCCESS) {
+        return NULL;
+    }
+
+    return afc;
+}
+
+// A client that sat idle may have been dropped by the device; ask it something cheap
+static int afc_healthy(afc_client_t afc) {
+    char **info = NULL;
+    if (afc_get_device_info(afc, &info) != AFC_E_SUCCESS) {
+        return 0;
+    }
+
+    afc_dictionary_free(info);
+    return 1;
+}
+
+// Take an AFC client from the pool, connecting one if the pool has none ready
+static afc_client_t afc_acquire(device_ctx_t *ctx) {
+    afc_client_t afc = NULL;
+    uint64_t now = time(NULL);
+
+    pthread_mutex_lock(&ctx->afc_lock);
+    for (int i = 0; i < DEVICE_AFC_POOL_SIZE; i++) {
+        device_afc_t *slot = &ctx->afc[i];
+        if (slot->client && !slot->in_use) {
+            if (now - slot->last_used >= DEVICE_AFC_IDLE_CHECK && !afc_healthy(slot->client)) {
+                afc_client_free(slot->client);
+                slot->client = NULL;
+                continue;
+            }
+            slot->in_use = 1;
+            afc = slot->client;
+            break;
+        }
+    }
+
+    // Connect into a free slot; with every slot busy the client is not pooled
+    if (!afc) {
+        afc = afc_connect(ctx);
+        for (int i = 0; afc && i < DEVICE_AFC_POOL_SIZE; i++) {
+            if (!ctx->afc[i].client) {
+                ctx->afc[i].client = afc;
+                ctx->afc[i].in_use = 1;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&ctx->afc_lock);
+
+    return afc;
+}
+
+// Return an AFC client to the pool, dropping it if its connection failed
+static void afc_release(device_ctx_t *ctx, afc_client_t afc, afc_error_t err) {
+    int fatal = afc_error_is_fatal(err);
+
+    pthread_mutex_lock(&ctx->afc_lock);
+    int pooled = 0;
+    for (int i = 0; i < DEVICE_AFC_POOL_SIZE; i++) {
+        device_afc_t *slot = &ctx->afc[i];
+        if (slot->client == afc) {
+            slot->in_use = 0;
+            slot->last_used = time(NULL);
+            if (fatal) {
+                slot->client = NULL;
+            }
+            pooled = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ctx->afc_lock);
+
+    if (!pooled || fatal) {
+        afc_client_free(afc);
+    }
+}
+
+// Run an AFC operation on a pooled client, reconnecting and retrying once on a dead connection
+static afc_error_t afc_call(device_ctx_t *ctx, afc_error_t (*op)(afc_client_t afc, void *arg), void *arg) {
+    afc_error_t ret = AFC_E_UNKNOWN_ERROR;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        afc_client_t afc = afc_acquire(ctx);
+        if (!afc) {
+            return AFC_E_MUX_ERROR;
+        }
+
+        ret = op(afc, arg);
+        afc_release(ctx, afc, ret);
+        if (!afc_error_is_fatal(ret)) {
+            break;
+        }
+    }
+
+    return ret;
+}
+
+// Drop every pooled AFC client
+static void afc_pool_close(device_ctx_t *ctx) {
+    for (int i = 0; i < DEVICE_AFC_POOL_SIZE; i++) {
+        if (ctx->afc[i].client) {
+            afc_client_free(ctx->afc[i].client);
+            ctx->afc[i].client = NULL;
+        }
+        ctx->afc[i].in_use = 0;
+    }
+}
+
 // Connect to device
 int device_connect(device_ctx_t *ctx, const char *udid) {
     if (!ctx) {
@@ -18,6 +158,7 @@ int device_connect(device_ctx_t *ctx, const char *udid) {
     idevice_error_t ret = idevice_new(&ctx->device, udid);
     if (ret != IDEVICE_E_SUCCESS) {
         fprintf(stderr, "Failed to connect to device: %d\n", ret);
+        ctx->device = NULL;
         return -1;
     }
 
@@ -26,13 +167,28 @@ int device_connect(device_ctx_t *ctx, const char *udid) {
     if (ret != LOCKDOWN_E_SUCCESS) {
         fprintf(stderr, "Failed to connect to lockdown service: %d\n", ret);
         idevice_free(ctx->device);
+        ctx->device = NULL;
+        ctx->client = NULL;
         return -1;
     }
 
+    // Start the AFC pool with one client so the first transfer skips service start-up
+    pthread_mutex_init(&ctx->client_lock, NULL);
+    pthread_mutex_init(&ctx->afc_lock, NULL);
+    memset(ctx->afc, 0, sizeof(ctx->afc));
+    ctx->afc[0].client = afc_connect(ctx);
+    ctx->afc[0].last_used = time(NULL);
+
+    // Prefer the persistent agent for commands and execs when one is running
+    if (agent_connect_device(&ctx->agent, ctx->device, AGENT_DEFAULT_PORT, COVERAGE_MAP_SIZE) == 0) {
+        printf("Connected to device agent (batches of up to %u)\n", ctx->agent.max_batch);
+    }
+
     // Get device information
     char *product_type = NULL;
     char *product_version = NULL;
     
+    pthread_mutex_lock(&ctx->client_lock);
     ret = lockdownd_get_value(ctx->client, NULL, "ProductType", &product_type);
     if (ret == LOCKDOWN_E_SUCCESS) {
         ctx->product_type = strdup(product_type);
@@ -40,6 +196,7 @@ int device_connect(device_ctx_t *ctx, const char *udid) {
     }
 
     ret = lockdownd_get_value(ctx->client, NULL, "ProductVersion", &product_version);
+    pthread_mutex_unlock(&ctx->client_lock);
     if (ret == LOCKDOWN_E_SUCCESS) {
         ctx->product_version = strdup(product_version);
         free(product_version);
@@ -56,18 +213,79 @@ int device_connect(device_ctx_t *ctx, const char *udid) {
     return 0;
 }
 
+// Start a lockdown service. The monitor, the I/O lanes and the fuzzing
+// thread all start services, and the lockdown client takes one request
+// at a time.
+int device_start_service(device_ctx_t *ctx, const char *name, lockdownd_service_descriptor_t *service) {
+    pthread_mutex_lock(&ctx->client_lock);
+    lockdownd_error_t ret = lockdownd_start_service(ctx->client, name, service);
+    pthread_mutex_unlock(&ctx->client_lock);
+
+    return ret == LOCKDOWN_E_SUCCESS ? 0 : -1;
+}
+
+// List the UDIDs of attached devices; free them with device_free_udids
+int device_list_udids(char ***udids, int *count) {
+    if (!udids || !count) {
+        return -1;
+    }
+
+    if (idevice_get_device_list(udids, count) != IDEVICE_E_SUCCESS) {
+        *udids = NULL;
+        *count = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Free a list from device_list_udids
+void device_free_udids(char **udids) {
+    if (udids) {
+        idevice_device_list_free(udids);
+    }
+}
+
+// Return 1 if usbmuxd lists the device, e.g. once it is back from a reboot
+int device_is_attached(const char *udid) {
+    char **udids = NULL;
+    int count = 0;
+    if (!udid || device_list_udids(&udids, &count) != 0) {
+        return 0;
+    }
+
+    int found = 0;
+    for (int i = 0; i < count && !found; i++) {
+        found = strcmp(udids[i], udid) == 0;
+    }
+
+    device_free_udids(udids);
+    return found;
+}
+
 // Disconnect from device
 int device_disconnect(device_ctx_t *ctx) {
     if (!ctx) {
         return -1;
     }
 
+    // The monitor, agent and AFC connections ride on the device connection,
+    // so they go first
+    if (ctx->device) {
+        device_monitor_stop(ctx);
+        device_close_crash_logs(ctx);
+        agent_close(&ctx->agent);
+        afc_pool_close(ctx);
+        pthread_mutex_destroy(&ctx->afc_lock);
+    }
+
     if (ctx->client) {
         lockdownd_client_free(ctx->client);
         ctx->client = NULL;
     }
 
     if (ctx->device) {
+        pthread_mutex_destroy(&ctx->client_lock);
         idevice_free(ctx->device);
         ctx->device = NULL;
     }
@@ -83,63 +301,302 @@ int device_disconnect(device_ctx_t *ctx) {
     return 0;
 }
 
+// Arguments of a file transfer on a pooled AFC client
+typedef struct {
+    FILE *local;
+    const char *remote_path;
+    int local_error;         // The local side failed; not a reason to reconnect
+} afc_transfer_t;
+
+// Upload a local file, starting from its beginning
+static afc_error_t afc_put_file(afc_client_t afc, void *arg) {
+    afc_transfer_t *t = arg;
+    rewind(t->local);
+
+    uint64_t handle;
+    afc_error_t ret = afc_file_open(afc, t->remote_path, AFC_FOPEN_WRONLY, &handle);
+    if (ret != AFC_E_SUCCESS) {
+        return ret;
+    }
+
+    char buffer[4096];
+    size_t bytes_read;
+    while ((bytes_read = fread(buffer, 1, sizeof(buffer), t->local)) > 0) {
+        uint32_t bytes_written;
+        ret = afc_file_write(afc, handle, buffer, bytes_read, &bytes_written);
+        if (ret == AFC_E_SUCCESS && bytes_written != bytes_read) {
+            ret = AFC_E_IO_ERROR;
+        }
+        if (ret != AFC_E_SUCCESS) {
+            break;
+        }
+    }
+    if (ferror(t->local)) {
+        t->local_error = 1;
+    }
+
+    afc_file_close(afc, handle);
+    return ret;
+}
+
+// Download a remote file over the local file's contents
+static afc_error_t afc_get_file(afc_client_t afc, void *arg) {
+    afc_transfer_t *t = arg;
+
+    uint64_t handle;
+    afc_error_t ret = afc_file_open(afc, t->remote_path, AFC_FOPEN_RDONLY, &handle);
+    if (ret != AFC_E_SUCCESS) {
+        return ret;
+    }
+
+    rewind(t->local);
+    if (ftruncate(fileno(t->local), 0) != 0) {
+        t->local_error = 1;
+        afc_file_close(afc, handle);
+        return AFC_E_SUCCESS;
+    }
+
+    char buffer[4096];
+    uint32_t bytes_read;
+    while ((ret = afc_file_read(afc, handle, buffer, sizeof(buffer), &bytes_read)) == AFC_E_SUCCESS &&
+           bytes_read > 0) {
+        if (fwrite(buffer, 1, bytes_read, t->local) != bytes_read) {
+            t->local_error = 1;
+            break;
+        }
+    }
+
+    afc_file_close(afc, handle);
+    return ret;
+}
+
+// Arguments of an upload from memory
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    const char *remote_path;
+} afc_upload_t;
+
+// Write a buffer to a remote file in large chunks
+static afc_error_t afc_put_buffer(afc_client_t afc, void *arg) {
+    afc_upload_t *u = arg;
+
+    uint64_t handle;
+    afc_error_t ret = afc_file_open(afc, u->remote_path, AFC_FOPEN_WRONLY, &handle);
+    if (ret != AFC_E_SUCCESS) {
+        return ret;
+    }
+
+    size_t offset = 0;
+    while (offset < u->size) {
+        uint32_t chunk = u->size - offset < DEVICE_UPLOAD_CHUNK ? u->size - offset : DEVICE_UPLOAD_CHUNK;
+        uint32_t bytes_written = 0;
+        ret = afc_file_write(afc, handle, (const char *)u->data + offset, chunk, &bytes_written);
+        if (ret == AFC_E_SUCCESS && bytes_written == 0) {
+            ret = AFC_E_IO_ERROR;
+        }
+        if (ret != AFC_E_SUCCESS) {
+            break;
+        }
+        offset += bytes_written;
+    }
+
+    afc_file_close(afc, handle);
+    return ret;
+}
+
+// Arguments of a small download into memory
+typedef struct {
+    const char *remote_path;
+    char *buf;
+    size_t size;             // Capacity, including the terminator
+    size_t len;
+} afc_download_t;
+
+// Read a small remote file into a NUL-terminated buffer
+static afc_error_t afc_get_buffer(afc_client_t afc, void *arg) {
+    afc_download_t *d = arg;
+    d->len = 0;
+
+    uint64_t handle;
+    afc_error_t ret = afc_file_open(afc, d->remote_path, AFC_FOPEN_RDONLY, &handle);
+    if (ret != AFC_E_SUCCESS) {
+        return ret;
+    }
+
+    uint32_t bytes_read;
+    while (d->len + 1 < d->size &&
+           (ret = afc_file_read(afc, handle, d->buf + d->len, d->size - 1 - d->len, &bytes_read)) == AFC_E_SUCCESS &&
+           bytes_read > 0) {
+        d->len += bytes_read;
+    }
+    d->buf[d->len] = '\0';
+
+    afc_file_close(afc, handle);
+    return ret;
+}
+
+// Arguments of a remote size lookup
+typedef struct {
+    const char *remote_path;
+    uint64_t size;
+} afc_size_t;
+
+// Size of a remote file, from its st_size attribute
+static afc_error_t afc_file_size(afc_client_t afc, void *arg) {
+    afc_size_t *sz = arg;
+
+    char **info = NULL;
+    afc_error_t ret = afc_get_file_info(afc, sz->remote_path, &info);
+    if (ret != AFC_E_SUCCESS) {
+        return ret;
+    }
+
+    ret = AFC_E_OBJECT_NOT_FOUND;
+    for (char **p = info; p && p[0] && p[1]; p += 2) {
+        if (strcmp(p[0], "st_size") == 0) {
+            sz->size = strtoull(p[1], NULL, 10);
+            ret = AFC_E_SUCCESS;
+            break;
+        }
+    }
+
+    afc_dictionary_free(info);
+    return ret;
+}
+
+// Create a remote directory
+static afc_error_t afc_mkdir(afc_client_t afc, void *arg) {
+    return afc_make_directory(afc, (const char *)arg);
+}
+
+// Look up a remote path
+static afc_error_t afc_stat_path(afc_client_t afc, void *arg) {
+    char **info = NULL;
+    afc_error_t ret = afc_get_file_info(afc, (const char *)arg, &info);
+    if (ret == AFC_E_SUCCESS && info) {
+        afc_dictionary_free(info);
+    }
+    return ret;
+}
+
+// Arguments of a remote directory listing
+typedef struct {
+    const char *path;
+    char **entries;
+} afc_list_t;
+
+// List a remote directory
+static afc_error_t afc_list(afc_client_t afc, void *arg) {
+    afc_list_t *list = arg;
+    return afc_read_directory(afc, list->path, &list->entries);
+}
+
 // Transfer file to device
 int device_transfer_file(device_ctx_t *ctx, const char *local_path, const char *remote_path) {
     if (!ctx || !local_path || !remote_path) {
         return -1;
     }
 
-    afc_client_t afc = NULL;
-    lockdownd_service_descriptor_t service = NULL;
-    
-    // Connect to AFC service
-    lockdownd_error_t ret = lockdownd_start_service(ctx->client, "com.apple.afc", &service);
-    if (ret != LOCKDOWN_E_SUCCESS) {
+    // Open local file
+    afc_transfer_t t = { .remote_path = remote_path };
+    t.local = fopen(local_path, "rb");
+    if (!t.local) {
         return -1;
     }
 
-    ret = afc_client_new(ctx->device, service, &afc);
-    if (ret != AFC_E_SUCCESS) {
-        lockdownd_service_descriptor_free(service);
+    afc_error_t ret = afc_call(ctx, afc_put_file, &t);
+    fclose(t.local);
+
+    return (ret == AFC_E_SUCCESS && !t.local_error) ? 0 : -1;
+}
+
+// Upload a buffer straight from memory
+int device_upload_buffer(device_ctx_t *ctx, const uint8_t *data, size_t size, const char *remote_path) {
+    if (!ctx || (!data && size > 0) || !remote_path) {
         return -1;
     }
 
-    // Open local file
-    FILE *f = fopen(local_path, "rb");
+    afc_upload_t u = { .data = data, .size = size, .remote_path = remote_path };
+    return afc_call(ctx, afc_put_buffer, &u) == AFC_E_SUCCESS ? 0 : -1;
+}
+
+// Read a whole local file into memory
+static uint8_t *read_local_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
     if (!f) {
-        afc_client_free(afc);
-        lockdownd_service_descriptor_free(service);
+        return NULL;
+    }
+
+    uint8_t *data = NULL;
+    long len;
+    if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) >= 0 && fseek(f, 0, SEEK_SET) == 0) {
+        data = malloc(len ? len : 1);
+        if (data && fread(data, 1, len, f) != (size_t)len) {
+            free(data);
+            data = NULL;
+        }
+        *size = len;
+    }
+
+    fclose(f);
+    return data;
+}
+
+// Install a local file on the device unless an identical copy is there already.
+// The copy is identified by <remote_path>.hash; returns 1 if it was uploaded,
+// 0 if it was already installed and -1 on error.
+int device_install_file(device_ctx_t *ctx, const char *local_path, const char *remote_path) {
+    if (!ctx || !local_path || !remote_path) {
         return -1;
     }
 
-    // Create remote file
-    uint64_t handle;
-    ret = afc_file_open(afc, remote_path, AFC_FOPEN_WRONLY, &handle);
-    if (ret != AFC_E_SUCCESS) {
-        fclose(f);
-        afc_client_free(afc);
-        lockdownd_service_descriptor_free(service);
+    size_t size;
+    uint8_t *data = read_local_file(local_path, &size);
+    if (!data) {
+        fprintf(stderr, "Failed to read %s\n", local_path);
         return -1;
     }
 
-    // Transfer file
-    char buffer[4096];
-    size_t bytes_read;
-    while ((bytes_read = fread(buffer, 1, sizeof(buffer), f)) > 0) {
-        uint32_t bytes_written;
-        ret = afc_file_write(afc, handle, buffer, bytes_read, &bytes_written);
-        if (ret != AFC_E_SUCCESS || bytes_written != bytes_read) {
-            break;
-        }
+    char hash[32];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)hash64(data, size, 0));
+
+    char marker_path[512];
+    snprintf(marker_path, sizeof(marker_path), "%s.hash", remote_path);
+
+    // Installed already if the marker matches and the file is whole
+    char marker[32];
+    afc_download_t d = { .remote_path = marker_path, .buf = marker, .size = sizeof(marker) };
+    afc_size_t sz = { .remote_path = remote_path };
+    if (afc_call(ctx, afc_get_buffer, &d) == AFC_E_SUCCESS && strcmp(marker, hash) == 0 &&
+        afc_call(ctx, afc_file_size, &sz) == AFC_E_SUCCESS && sz.size == size) {
+        free(data);
+        return 0;
     }
 
-    // Clean up
-    fclose(f);
-    afc_file_close(afc, handle);
-    afc_client_free(afc);
-    lockdownd_service_descriptor_free(service);
+    // The marker goes last so an interrupted install is redone
+    afc_upload_t file = { .data = data, .size = size, .remote_path = remote_path };
+    afc_upload_t hash_file = { .data = (const uint8_t *)hash, .size = strlen(hash), .remote_path = marker_path };
+    int ret = -1;
+    if (afc_call(ctx, afc_put_buffer, &file) == AFC_E_SUCCESS &&
+        afc_call(ctx, afc_file_size, &sz) == AFC_E_SUCCESS && sz.size == size &&
+        afc_call(ctx, afc_put_buffer, &hash_file) == AFC_E_SUCCESS) {
+        ret = 1;
+    } else {
+        fprintf(stderr, "Failed to install %s to %s\n", local_path, remote_path);
+    }
 
-    return (ret == AFC_E_SUCCESS) ? 0 : -1;
+    free(data);
+    return ret;
+}
+
+// Create a directory on the device
+int device_make_directory(device_ctx_t *ctx, const char *path) {
+    if (!ctx || !path) {
+        return -1;
+    }
+
+    return afc_call(ctx, afc_mkdir, (void *)path) == AFC_E_SUCCESS ? 0 : -1;
 }
 
 // Execute command on device
@@ -148,8 +605,31 @@ int device_execute_command(device_ctx_t *ctx, const char *command) {
         return -1;
     }
 
-    // TODO: Implement command execution using libimobiledevice
-    // This would require additional services and permissions
+    // Without the agent there is no way to run commands; pretend success as before
+    if (!ctx->agent.connected) {
+        return 0;
+    }
+
+    int32_t status;
+    if (agent_command(&ctx->agent, command, &status) != 0) {
+        fprintf(stderr, "Failed to run command on device: %s\n", command);
+        return -1;
+    }
+    return status == 0 ? 0 : -1;
+}
+
+// List a directory on the device; free the entries with afc_dictionary_free
+int device_list_directory(device_ctx_t *ctx, const char *path, char ***entries) {
+    if (!ctx || !path || !entries) {
+        return -1;
+    }
+
+    afc_list_t list = { .path = path };
+    if (afc_call(ctx, afc_list, &list) != AFC_E_SUCCESS) {
+        return -1;
+    }
+
+    *entries = list.entries;
     return 0;
 }
 
@@ -170,37 +650,7 @@ int device_file_exists(device_ctx_t *ctx, const char *path) {
         return 0;
     }
 
-    afc_client_t afc = NULL;
-    lockdownd_service_descriptor_t service = NULL;
-    
-    // Connect to AFC service
-    lockdownd_error_t ret = lockdownd_start_service(ctx->client, "com.apple.afc", &service);
-    if (ret != LOCKDOWN_E_SUCCESS) {
-        return 0;
-    }
-
-    ret = afc_client_new(ctx->device, service, &afc);
-    if (ret != AFC_E_SUCCESS) {
-        lockdownd_service_descriptor_free(service);
-        return 0;
-    }
-
-    // Check if file exists
-    char **list = NULL;
-    ret = afc_read_directory(afc, path, &list);
-    
-    afc_client_free(afc);
-    lockdownd_service_descriptor_free(service);
-
-    if (ret == AFC_E_SUCCESS && list) {
-        for (char **p = list; *p; p++) {
-            free(*p);
-        }
-        free(list);
-        return 1;
-    }
-
-    return 0;
+    return afc_call(ctx, afc_stat_path, (void *)path) == AFC_E_SUCCESS;
 }
 
 // Copy file from device
@@ -209,65 +659,30 @@ int device_copy_file(device_ctx_t *ctx, const char *remote_path, const char *loc
         return -1;
     }
 
-    afc_client_t afc = NULL;
-    lockdownd_service_descriptor_t service = NULL;
-    
-    // Connect to AFC service
-    lockdownd_error_t ret = lockdownd_start_service(ctx->client, "com.apple.afc", &service);
-    if (ret != LOCKDOWN_E_SUCCESS) {
-        return -1;
-    }
-
-    ret = afc_client_new(ctx->device, service, &afc);
-    if (ret != AFC_E_SUCCESS) {
-        lockdownd_service_descriptor_free(service);
-        return -1;
-    }
-
-    // Open remote file
-    uint64_t handle;
-    ret = afc_file_open(afc, remote_path, AFC_FOPEN_RDONLY, &handle);
-    if (ret != AFC_E_SUCCESS) {
-        afc_client_free(afc);
-        lockdownd_service_descriptor_free(service);
-        return -1;
-    }
-
     // Create local file
-    FILE *f = fopen(local_path, "wb");
-    if (!f) {
-        afc_file_close(afc, handle);
-        afc_client_free(afc);
-        lockdownd_service_descriptor_free(service);
+    afc_transfer_t t = { .remote_path = remote_path };
+    t.local = fopen(local_path, "wb");
+    if (!t.local) {
         return -1;
     }
 
-    // Transfer file
-    char buffer[4096];
-    uint32_t bytes_read;
-    while (afc_file_read(afc, handle, buffer, sizeof(buffer), &bytes_read) == AFC_E_SUCCESS && bytes_read > 0) {
-        if (fwrite(buffer, 1, bytes_read, f) != bytes_read) {
-            break;
-        }
+    afc_error_t ret = afc_call(ctx, afc_get_file, &t);
+    if (fclose(t.local) != 0) {
+        t.local_error = 1;
     }
 
-    // Clean up
-    fclose(f);
-    afc_file_close(afc, handle);
-    afc_client_free(afc);
-    lockdownd_service_descriptor_free(service);
-
-    return 0;
+    return (ret == AFC_E_SUCCESS && !t.local_error) ? 0 : -1;
 }
 
 // Collect coverage information from device
 int device_collect_coverage(device_ctx_t *ctx, coverage_t *coverage) {
-    if (!ctx || !coverage) {
+    if (!ctx || !coverage || !coverage->map) {
         return -1;
     }
 
-    // TODO: Implement coverage collection
-    // This would require additional services and permissions
+    // Coverage only travels with agent exec results (agent_coverage_decode);
+    // without the agent nothing runs on the device to produce any
+    memset(coverage->map, 0, coverage->map_size);
     return 0;
 }
 
@@ -278,7 +693,9 @@ int device_install_binary(device_ctx_t *ctx, const char *binary_path) {
     }
 
     instproxy_client_t ipc = NULL;
+    pthread_mutex_lock(&ctx->client_lock);
     instproxy_error_t ret = instproxy_client_new(ctx->device, ctx->client, &ipc);
+    pthread_mutex_unlock(&ctx->client_lock);
     if (ret != INSTPROXY_E_SUCCESS) {
         fprintf(stderr, "Failed to create installation proxy client: %d\n", ret);
         return -1;
@@ -310,35 +727,3 @@ int device_execute_binary(device_ctx_t *ctx, const char *binary_path, const char
 
     return 0;
 }
-
-// Get device crash logs
-int device_get_crash_logs(device_ctx_t *ctx, const char *output_dir) {
-    if (!ctx || !output_dir) {
-        return -1;
-    }
-
-    // TODO: Implement crash log collection
-    // This will involve:
-    // 1. Connecting to the device's crash log service
-    // 2. Retrieving crash logs
-    // 3. Parsing and analyzing crash information
-    // 4. Saving relevant crash data
-
-    return 0;
-}
-
-// Monitor device status
-int device_monitor_status(device_ctx_t *ctx) {
-    if (!ctx) {
-        return -1;
-    }
-
-    // TODO: Implement device status monitoring
-    // This will involve:
-    // 1. Setting up notification monitoring
-    // 2. Tracking device state changes
-    // 3. Detecting disconnections
-    // 4. Handling device recovery
-
-    return 0;
-} 
\ No newline at end of file
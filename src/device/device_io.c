@@ -0,0 +1,518 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../../include/fuzzkrieg.h"
+#include "../../include/device_io.h"
+
+// Wall clock time ms from now, for pthread_cond_timedwait
+static struct timespec device_io_deadline(uint32_t ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    uint64_t ns = (uint64_t)ts.tv_nsec + (uint64_t)ms * 1000000ULL;
+    ts.tv_sec += ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    return ts;
+}
+
+// Wake the side sleeping on cond
+static void device_io_signal(device_io_t *io, pthread_cond_t *cond) {
+    pthread_mutex_lock(&io->lock);
+    pthread_cond_signal(cond);
+    pthread_mutex_unlock(&io->lock);
+}
+
+// Wait for the oldest entry of a lane's input, leaving it queued; NULL once stopped
+static device_io_entry_t *device_io_next(device_io_t *io, pipeline_queue_t *q, pthread_cond_t *cond,
+                                         pipeline_stage_t *stage) {
+    if (atomic_load(&io->stop)) {
+        return NULL;
+    }
+
+    device_io_entry_t *entry = pipeline_queue_front(q);
+    if (entry) {
+        return entry;
+    }
+
+    uint64_t start = stats_now_ns();
+    pthread_mutex_lock(&io->lock);
+    while (!atomic_load(&io->stop) && !(entry = pipeline_queue_peek(q, 0))) {
+        pthread_cond_wait(cond, &io->lock);
+    }
+    pthread_mutex_unlock(&io->lock);
+    stats_add(&stage->starved_ns, stats_now_ns() - start);
+
+    return atomic_load(&io->stop) ? NULL : entry;
+}
+
+// Crash report callback: keep the newest copy and count them
+static void device_io_report(const char *path, void *arg) {
+    device_io_completion_t *completion = arg;
+    snprintf(completion->report, sizeof(completion->report), "%s", path);
+    completion->reports++;
+}
+
+// Put a batch of executes on the wire to the agent as one request; agent_lock held
+static int device_io_send(device_io_t *io, device_io_entry_t **batch, uint32_t count) {
+    agent_exec_t inputs[DEVICE_IO_HANDOFF_SIZE];
+    uint32_t timeout_ms = 0;
+
+    if (count == 0 || count > DEVICE_IO_HANDOFF_SIZE) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        const device_io_request_t *request = &batch[i]->request;
+        inputs[i] = (agent_exec_t){
+            .data = request->data,
+            .size = request->size,
+            .base = request->base,
+            .base_size = request->base_size
+        };
+        if (request->timeout_ms > timeout_ms) {
+            timeout_ms = request->timeout_ms;
+        }
+    }
+
+    int sent = agent_exec_send(&io->device->agent, inputs, count, timeout_ms) == 0;
+    for (uint32_t i = 0; i < count; i++) {
+        batch[i]->sent = sent;
+        batch[i]->batch = i == 0 ? count : 0;
+    }
+    if (sent) {
+        atomic_fetch_add(&io->batches, 1);
+    }
+    return sent ? 0 : -1;
+}
+
+// The agent lost a base the oldest batch was patched against and ran none
+// of it. Batches sent behind it may count on the same base, so take every
+// reply still due and send them all again in full. Returns -1 if the
+// connection failed; nothing is on the wire then.
+static int device_io_replay(device_io_t *io) {
+    agent_client_t *agent = &io->device->agent;
+    device_io_entry_t *entry;
+    int ret = 0;
+
+    // The transfer lane sends and hands over under the lock, so whatever
+    // is on the wire is in the handoff, the oldest batch at its head
+    pthread_mutex_lock(&io->agent_lock);
+    for (uint32_t i = 1; ret == 0 && (entry = pipeline_queue_peek(&io->handoff, i)) != NULL; i++) {
+        if (!entry->batch || !entry->sent) {
+            continue;
+        }
+        if (agent_exec_recv(agent, entry->batch, entry->request.timeout_ms, io->results) != 0 &&
+            agent->last_error == 0) {
+            ret = -1;
+        }
+        atomic_fetch_sub(&io->batches, 1);
+    }
+    agent_forget_cache(agent);
+    if (ret != 0) {
+        atomic_store(&io->batches, 0);
+    }
+
+    for (uint32_t i = 0; (entry = pipeline_queue_peek(&io->handoff, i)) != NULL; i++) {
+        if (!entry->batch || !entry->sent) {
+            continue;
+        }
+
+        // The rest of its batch follows it in the handoff
+        device_io_entry_t *batch[DEVICE_IO_HANDOFF_SIZE], *member;
+        uint32_t count = 0;
+        for (uint32_t j = i; count < entry->batch && (member = pipeline_queue_peek(&io->handoff, j)) != NULL; j++) {
+            if (member->request.op == DEVICE_IO_EXECUTE) {
+                batch[count++] = member;
+            }
+        }
+        if (ret != 0 || count != entry->batch || device_io_send(io, batch, count) != 0) {
+            for (uint32_t k = 0; k < count; k++) {
+                batch[k]->sent = 0;
+            }
+            ret = -1;
+        }
+    }
+    pthread_mutex_unlock(&io->agent_lock);
+
+    return ret;
+}
+
+// Take the agent's reply to an execute sent by the transfer lane. The
+// first execute of a batch receives the results of all of it; the rest
+// take theirs in turn.
+static void device_io_receive(device_io_t *io, device_io_entry_t *entry) {
+    agent_client_t *agent = &io->device->agent;
+    device_io_completion_t *completion = &entry->completion;
+    uint32_t timeout_ms = entry->request.timeout_ms;
+
+    if (entry->batch) {
+        io->result_count = entry->batch;
+        io->result_next = 0;
+        io->batch_status = -1;
+        if (entry->sent) {
+            int ret = agent_exec_recv(agent, entry->batch, timeout_ms, io->results);
+            atomic_fetch_sub(&io->batches, 1);
+            if (ret != 0 && agent->last_error == AGENT_ERR_CACHE_MISS && device_io_replay(io) == 0) {
+                ret = agent_exec_recv(agent, entry->batch, timeout_ms, io->results);
+                atomic_fetch_sub(&io->batches, 1);
+            }
+            if (ret != 0) {
+                // What the agent caches is unknown now; patch against nothing
+                pthread_mutex_lock(&io->agent_lock);
+                agent_forget_cache(agent);
+                pthread_mutex_unlock(&io->agent_lock);
+            }
+            io->batch_status = ret;
+        }
+    }
+    entry->sent = 0;
+
+    if (io->batch_status != 0 || io->result_next >= io->result_count) {
+        io->result = NULL;
+        completion->status = -1;
+        return;
+    }
+
+    io->result = &io->results[io->result_next++];
+    completion->exec_status = io->result->status;
+    completion->exec_time_us = io->result->exec_time_us;
+    completion->status = io->result->status == AGENT_STATUS_ERROR ? -1 : 0;
+}
+
+// Make the execute lane's part of a call
+static void device_io_call(device_io_t *io, device_io_entry_t *entry) {
+    const device_io_request_t *request = &entry->request;
+    device_io_completion_t *completion = &entry->completion;
+    device_ctx_t *ctx = io->device;
+
+    switch (request->op) {
+        case DEVICE_IO_UPLOAD:
+            // Done by the transfer lane
+            break;
+
+        case DEVICE_IO_EXECUTE:
+            if (ctx->agent.connected) {
+                device_io_receive(io, entry);
+            } else {
+                completion->status = device_execute_command(ctx, request->path);
+            }
+            break;
+
+        case DEVICE_IO_COVERAGE:
+            // The agent's result stays in its frame buffer until the next batch is received
+            if (ctx->agent.connected) {
+                completion->status = agent_coverage_decode(io->result, request->map, request->map_size);
+            } else {
+                coverage_t coverage = { .map = request->map, .map_size = request->map_size };
+                completion->status = device_collect_coverage(ctx, &coverage);
+            }
+            break;
+
+        case DEVICE_IO_CRASH:
+            completion->status = device_get_crash_logs(ctx, request->path, device_io_report, completion) < 0 ? -1 : 0;
+            break;
+
+        default:
+            completion->status = -1;
+            break;
+    }
+}
+
+// Reset an entry's completion as the transfer lane takes it up
+static void device_io_begin(device_io_entry_t *entry) {
+    device_io_completion_t *completion = &entry->completion;
+    memset(completion, 0, sizeof(device_io_completion_t));
+    completion->op = entry->request.op;
+    completion->tag = entry->request.tag;
+    entry->sent = 0;
+    entry->batch = 0;
+}
+
+// Collect the executes queued behind head, the execute at the front of
+// the submission queue, up to the agent's batch limit and what the handoff
+// has room for, passing over the coverage fetches between them, and reset
+// their completions. Returns how many entries, up to the last execute
+// taken, move to the handoff with the batch.
+static uint32_t device_io_gather(device_io_t *io, device_io_entry_t *head,
+                                 device_io_entry_t **batch, uint32_t *count) {
+    uint32_t room = io->handoff.capacity - pipeline_queue_depth(&io->handoff);
+    uint32_t max = io->device->agent.max_batch;
+    uint32_t span = 1;
+    device_io_entry_t *entry;
+
+    device_io_begin(head);
+    batch[0] = head;
+    *count = 1;
+    for (uint32_t i = 1; i < room && *count < max && (entry = pipeline_queue_peek(&io->sq, i)) != NULL; i++) {
+        if (entry->request.op == DEVICE_IO_EXECUTE) {
+            batch[(*count)++] = entry;
+            span = i + 1;
+        } else if (entry->request.op != DEVICE_IO_COVERAGE) {
+            break;
+        }
+        device_io_begin(entry);
+    }
+    return span;
+}
+
+// Transfer lane: upload payloads and send inputs ahead of their turn, at
+// most DEVICE_IO_HANDOFF_SIZE calls ahead of the execute lane
+static void *device_io_transfer_thread(void *arg) {
+    device_io_t *io = arg;
+    int agent = io->device->agent.connected;
+
+    for (;;) {
+        device_io_entry_t *entry = device_io_next(io, &io->sq, &io->submitted, &io->transfer);
+        if (!entry) {
+            break;
+        }
+
+        // Wait for room first: once sent, an input must be in the handoff.
+        // An execute also waits while the agent has its fill of batches,
+        // so what is queued meanwhile goes as one.
+        int execute = entry->request.op == DEVICE_IO_EXECUTE && agent;
+        if (!pipeline_queue_has_room(&io->handoff) ||
+            (execute && atomic_load(&io->batches) >= DEVICE_IO_AGENT_BATCHES)) {
+            uint64_t start = stats_now_ns();
+            pthread_mutex_lock(&io->lock);
+            while (!atomic_load(&io->stop) &&
+                   (pipeline_queue_depth(&io->handoff) >= io->handoff.capacity ||
+                    (execute && atomic_load(&io->batches) >= DEVICE_IO_AGENT_BATCHES))) {
+                pthread_cond_wait(&io->drained, &io->lock);
+            }
+            pthread_mutex_unlock(&io->lock);
+            stats_add(&io->transfer.blocked_ns, stats_now_ns() - start);
+            if (atomic_load(&io->stop)) {
+                break;
+            }
+        }
+
+        uint64_t start = stats_now_ns();
+        if (execute) {
+            // Sent and handed over together, for device_io_replay
+            device_io_entry_t *batch[DEVICE_IO_HANDOFF_SIZE];
+            uint32_t count;
+            pthread_mutex_lock(&io->agent_lock);
+            uint32_t span = device_io_gather(io, entry, batch, &count);
+            device_io_send(io, batch, count);
+
+            uint64_t transfer_ns = stats_now_ns() - start;
+            for (uint32_t i = 0; i < count; i++) {
+                batch[i]->completion.transfer_ns = transfer_ns / count;
+            }
+            for (uint32_t i = 0; i < span; i++) {
+                pipeline_queue_push(&io->handoff, pipeline_queue_pop(&io->sq));
+            }
+            pthread_mutex_unlock(&io->agent_lock);
+            stats_add(&io->transfer.busy_ns, transfer_ns);
+            stats_add(&io->transfer.items, span);
+        } else {
+            device_io_begin(entry);
+            if (entry->request.op == DEVICE_IO_UPLOAD) {
+                entry->completion.status = device_upload_buffer(io->device, entry->request.data,
+                                                                entry->request.size, entry->request.path);
+            }
+            entry->completion.transfer_ns = stats_now_ns() - start;
+            pipeline_queue_pop(&io->sq);
+            pipeline_queue_push(&io->handoff, entry);
+            stats_add(&io->transfer.busy_ns, entry->completion.transfer_ns);
+            stats_add(&io->transfer.items, 1);
+        }
+
+        device_io_signal(io, &io->transferred);
+    }
+
+    return NULL;
+}
+
+// Execute lane: take replies, coverage and crash polls in order
+static void *device_io_execute_thread(void *arg) {
+    device_io_t *io = arg;
+
+    for (;;) {
+        device_io_entry_t *entry = device_io_next(io, &io->handoff, &io->transferred, &io->execute);
+        if (!entry) {
+            break;
+        }
+
+        // Left in the handoff meanwhile, where a replay finds it
+        entry->completion.start_ns = stats_now_ns();
+        device_io_call(io, entry);
+        entry->completion.end_ns = stats_now_ns();
+        if (entry->request.op == DEVICE_IO_UPLOAD) {
+            entry->completion.start_ns = 0;
+            entry->completion.end_ns = 0;
+        } else {
+            stats_add(&io->execute.busy_ns, entry->completion.end_ns - entry->completion.start_ns);
+        }
+        stats_add(&io->execute.items, 1);
+
+        pipeline_queue_pop(&io->handoff);
+        device_io_signal(io, &io->drained);
+
+        // Submitters never run more than a ring ahead of completions, so
+        // this has room
+        pipeline_queue_push(&io->cq, entry);
+        device_io_signal(io, &io->completed);
+    }
+
+    return NULL;
+}
+
+// Tear down the lock and condition variables
+static void device_io_destroy(device_io_t *io) {
+    pthread_mutex_destroy(&io->agent_lock);
+    pthread_cond_destroy(&io->completed);
+    pthread_cond_destroy(&io->drained);
+    pthread_cond_destroy(&io->transferred);
+    pthread_cond_destroy(&io->submitted);
+    pthread_mutex_destroy(&io->lock);
+}
+
+// Start the I/O lanes of a connected device
+int device_io_start(device_io_t *io, device_ctx_t *device) {
+    if (!io || !device || !device->device) {
+        return -1;
+    }
+
+    memset(io, 0, sizeof(device_io_t));
+    io->device = device;
+    pipeline_queue_init(&io->sq, DEVICE_IO_RING_SIZE);
+    pipeline_queue_init(&io->handoff, DEVICE_IO_HANDOFF_SIZE);
+    pipeline_queue_init(&io->cq, DEVICE_IO_RING_SIZE);
+
+    if (pthread_mutex_init(&io->lock, NULL) != 0 ||
+        pthread_cond_init(&io->submitted, NULL) != 0 ||
+        pthread_cond_init(&io->transferred, NULL) != 0 ||
+        pthread_cond_init(&io->drained, NULL) != 0 ||
+        pthread_cond_init(&io->completed, NULL) != 0 ||
+        pthread_mutex_init(&io->agent_lock, NULL) != 0) {
+        fprintf(stderr, "Failed to set up device I/O\n");
+        return -1;
+    }
+
+    if (pthread_create(&io->transfer_thread, NULL, device_io_transfer_thread, io) != 0) {
+        fprintf(stderr, "Failed to start device I/O thread\n");
+        device_io_destroy(io);
+        return -1;
+    }
+    if (pthread_create(&io->execute_thread, NULL, device_io_execute_thread, io) != 0) {
+        fprintf(stderr, "Failed to start device I/O thread\n");
+        pthread_mutex_lock(&io->lock);
+        atomic_store(&io->stop, 1);
+        pthread_cond_broadcast(&io->submitted);
+        pthread_cond_broadcast(&io->drained);
+        pthread_mutex_unlock(&io->lock);
+        pthread_join(io->transfer_thread, NULL);
+        device_io_destroy(io);
+        return -1;
+    }
+
+    io->running = 1;
+    return 0;
+}
+
+// Stop the lanes after the calls in progress
+void device_io_stop(device_io_t *io) {
+    if (!io || !io->running) {
+        return;
+    }
+
+    pthread_mutex_lock(&io->lock);
+    atomic_store(&io->stop, 1);
+    pthread_cond_broadcast(&io->submitted);
+    pthread_cond_broadcast(&io->transferred);
+    pthread_cond_broadcast(&io->drained);
+    pthread_cond_broadcast(&io->completed);
+    pthread_mutex_unlock(&io->lock);
+
+    pthread_join(io->transfer_thread, NULL);
+    pthread_join(io->execute_thread, NULL);
+    device_io_destroy(io);
+    io->running = 0;
+}
+
+// Queue a call without waiting
+int device_io_submit(device_io_t *io, const device_io_request_t *request) {
+    if (!io || !request || !io->running || atomic_load(&io->stop)) {
+        return -1;
+    }
+
+    // Bounded by completions not yet taken, so every queue has room for it
+    // and an entry stays put until its completion is taken
+    if (io->requests - io->taken >= DEVICE_IO_RING_SIZE) {
+        io->ring_full++;
+        return -1;
+    }
+
+    device_io_entry_t *entry = &io->entries[io->requests % DEVICE_IO_RING_SIZE];
+    entry->request = *request;
+    pipeline_queue_push(&io->sq, entry);
+    io->requests++;
+
+    device_io_signal(io, &io->submitted);
+    return 0;
+}
+
+// Take the oldest completion if there is one
+int device_io_poll(device_io_t *io, device_io_completion_t *completion) {
+    if (!io || !completion) {
+        return 0;
+    }
+
+    device_io_entry_t *entry = pipeline_queue_front(&io->cq);
+    if (!entry) {
+        return 0;
+    }
+
+    // Copied out before the pop frees the entry for another call
+    *completion = entry->completion;
+    pipeline_queue_pop(&io->cq);
+    io->taken++;
+    return 1;
+}
+
+// Take the oldest completion, waiting up to timeout_ms
+int device_io_wait(device_io_t *io, device_io_completion_t *completion, uint32_t timeout_ms) {
+    if (!io || !completion || !io->running) {
+        return 0;
+    }
+
+    if (device_io_poll(io, completion)) {
+        return 1;
+    }
+
+    struct timespec ts = device_io_deadline(timeout_ms);
+    pthread_mutex_lock(&io->lock);
+    while (!pipeline_queue_peek(&io->cq, 0)) {
+        if (atomic_load(&io->stop) || pthread_cond_timedwait(&io->completed, &io->lock, &ts) != 0) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&io->lock);
+
+    return device_io_poll(io, completion);
+}
+
+// Calls submitted and not taken yet
+uint32_t device_io_in_flight(device_io_t *io) {
+    if (!io) {
+        return 0;
+    }
+
+    return io->requests - io->taken;
+}
+
+// Snapshot the device-side stages and their queues
+void device_io_stats(device_io_t *io, pipeline_stats_t *stats) {
+    if (!io || !stats) {
+        return;
+    }
+
+    pipeline_stage_stats(&io->transfer, &stats->stage[PIPELINE_TRANSFER]);
+    pipeline_stage_stats(&io->execute, &stats->stage[PIPELINE_EXECUTE]);
+    pipeline_queue_stats(&io->sq, &stats->queue[PIPELINE_TRANSFER - 1]);
+    pipeline_queue_stats(&io->handoff, &stats->queue[PIPELINE_EXECUTE - 1]);
+    pipeline_queue_stats(&io->cq, &stats->queue[PIPELINE_ANALYZE - 1]);
+}
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../../include/fuzzkrieg.h"
+
+// Queue an event for the fuzzer loop; drops it if the loop has fallen far behind
+static void monitor_push(device_monitor_t *mon, device_event_type_t type, const char *path) {
+    pthread_mutex_lock(&mon->lock);
+    if (mon->count == DEVICE_EVENT_QUEUE) {
+        mon->dropped++;
+    } else {
+        device_event_t *event = &mon->events[(mon->head + mon->count) % DEVICE_EVENT_QUEUE];
+        event->type = type;
+        event->time = stats_now_ns();
+        snprintf(event->path, sizeof(event->path), "%s", path ? path : "");
+        mon->count++;
+        atomic_store_explicit(&mon->pending, mon->count, memory_order_release);
+    }
+    pthread_mutex_unlock(&mon->lock);
+}
+
+// usbmuxd callback: track this device coming and going
+static void monitor_device_event(const idevice_event_t *event, void *user_data) {
+    device_ctx_t *ctx = user_data;
+
+    if (!event->udid || !ctx->udid || strcmp(event->udid, ctx->udid) != 0) {
+        return;
+    }
+
+    if (event->event == IDEVICE_DEVICE_ADD) {
+        monitor_push(&ctx->monitor, DEVICE_EVENT_CONNECTED, NULL);
+    } else if (event->event == IDEVICE_DEVICE_REMOVE) {
+        monitor_push(&ctx->monitor, DEVICE_EVENT_DISCONNECTED, NULL);
+    }
+}
+
+// Crash report callback: tell the fuzzer loop where the copy landed
+static void monitor_report(const char *path, void *arg) {
+    monitor_push(arg, DEVICE_EVENT_CRASH_REPORT, path);
+}
+
+// Pull reports copied since the last poll into the crash store
+static void monitor_scan_reports(device_ctx_t *ctx) {
+    device_monitor_t *mon = &ctx->monitor;
+    if (mon->crash_store[0]) {
+        device_get_crash_logs(ctx, mon->crash_store, monitor_report, mon);
+    }
+}
+
+// Wall clock time ms from now, for pthread_cond_timedwait
+static struct timespec monitor_deadline(uint32_t ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    uint64_t ns = (uint64_t)ts.tv_nsec + (uint64_t)ms * 1000000ULL;
+    ts.tv_sec += ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    return ts;
+}
+
+// Poll for crash reports until stopped
+static void *monitor_thread(void *arg) {
+    device_ctx_t *ctx = arg;
+    device_monitor_t *mon = &ctx->monitor;
+
+    pthread_mutex_lock(&mon->lock);
+    while (!mon->stop) {
+        // Polling takes round trips; never hold the queue lock across them
+        pthread_mutex_unlock(&mon->lock);
+        monitor_scan_reports(ctx);
+        pthread_mutex_lock(&mon->lock);
+
+        if (!mon->stop) {
+            struct timespec ts = monitor_deadline(DEVICE_MONITOR_INTERVAL_MS);
+            pthread_cond_timedwait(&mon->cond, &mon->lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&mon->lock);
+
+    return NULL;
+}
+
+// Start monitoring the device for disconnects, and for crash reports if
+// given a local store to copy them into
+int device_monitor_status(device_ctx_t *ctx, const char *crash_store) {
+    if (!ctx || !ctx->device) {
+        return -1;
+    }
+
+    device_monitor_t *mon = &ctx->monitor;
+    if (mon->running) {
+        return 0;
+    }
+    memset(mon, 0, sizeof(device_monitor_t));
+    snprintf(mon->crash_store, sizeof(mon->crash_store), "%s", crash_store ? crash_store : "");
+
+    if (pthread_mutex_init(&mon->lock, NULL) != 0) {
+        return -1;
+    }
+    if (pthread_cond_init(&mon->cond, NULL) != 0) {
+        pthread_mutex_destroy(&mon->lock);
+        return -1;
+    }
+
+    // The first poll sets the cursor of a new store before going live
+    monitor_scan_reports(ctx);
+
+    if (idevice_events_subscribe(&mon->subscription, monitor_device_event, ctx) != IDEVICE_E_SUCCESS) {
+        fprintf(stderr, "Failed to subscribe to device events\n");
+        mon->subscription = NULL;
+    }
+
+    if (pthread_create(&mon->thread, NULL, monitor_thread, ctx) != 0) {
+        fprintf(stderr, "Failed to start device monitor thread\n");
+        if (mon->subscription) {
+            idevice_events_unsubscribe(mon->subscription);
+        }
+        pthread_cond_destroy(&mon->cond);
+        pthread_mutex_destroy(&mon->lock);
+        return -1;
+    }
+
+    mon->running = 1;
+    return 0;
+}
+
+// Take the oldest queued event; returns 0 at once if there is none
+int device_poll_event(device_ctx_t *ctx, device_event_t *event) {
+    if (!ctx || !event || !ctx->monitor.running) {
+        return 0;
+    }
+
+    device_monitor_t *mon = &ctx->monitor;
+    if (atomic_load_explicit(&mon->pending, memory_order_acquire) == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&mon->lock);
+    int got = mon->count > 0;
+    if (got) {
+        *event = mon->events[mon->head];
+        mon->head = (mon->head + 1) % DEVICE_EVENT_QUEUE;
+        mon->count--;
+        atomic_store_explicit(&mon->pending, mon->count, memory_order_release);
+    }
+    pthread_mutex_unlock(&mon->lock);
+
+    return got;
+}
+
+// Stop the monitor thread and drop the event subscription
+void device_monitor_stop(device_ctx_t *ctx) {
+    if (!ctx || !ctx->monitor.running) {
+        return;
+    }
+
+    device_monitor_t *mon = &ctx->monitor;
+    if (mon->subscription) {
+        idevice_events_unsubscribe(mon->subscription);
+        mon->subscription = NULL;
+    }
+
+    pthread_mutex_lock(&mon->lock);
+    mon->stop = 1;
+    pthread_cond_signal(&mon->cond);
+    pthread_mutex_unlock(&mon->lock);
+
+    pthread_join(mon->thread, NULL);
+    pthread_cond_destroy(&mon->cond);
+    pthread_mutex_destroy(&mon->lock);
+
+    if (mon->dropped) {
+        fprintf(stderr, "Device monitor dropped %llu events\n", (unsigned long long)mon->dropped);
+    }
+    mon->running = 0;
+}
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/fuzzkrieg.h"
+#include "../../include/executor.h"
+
+// Registered executor backends
+static const executor_ops_t *executors[] = {
+    &executor_device_ops,
+    &executor_forkserver_ops,
+    &executor_agent_ops
+};
+
+#define NUM_EXECUTORS (sizeof(executors) / sizeof(executors[0]))
+
+// Look up an executor backend by name
+const executor_ops_t *executor_find(const char *name) {
+    if (!name) {
+        name = EXECUTOR_DEFAULT;
+    }
+
+    for (size_t i = 0; i < NUM_EXECUTORS; i++) {
+        if (strcmp(executors[i]->name, name) == 0) {
+            return executors[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Initialize the executor backend selected in the configuration
+int executor_init(executor_t *exec, const fuzz_config_t *config, device_ctx_t *device) {
+    if (!exec || !config) {
+        return -1;
+    }
+
+    memset(exec, 0, sizeof(executor_t));
+
+    const executor_ops_t *ops = executor_find(config->executor);
+    if (!ops) {
+        fprintf(stderr, "Unknown executor: %s\n", config->executor);
+        return -1;
+    }
+
+    exec->ops = ops;
+    if (ops->init(exec, config, device) != 0) {
+        exec->ops = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Ship a test case to the executor
+int executor_load(executor_t *exec, testcase_t *tc) {
+    if (!exec || !exec->ops || !tc) {
+        return -1;
+    }
+
+    return exec->ops->load(exec, tc);
+}
+
+// Run the loaded test case on the executor
+int executor_run(executor_t *exec, testcase_t *tc) {
+    if (!exec || !exec->ops || !tc) {
+        return -1;
+    }
+
+    return exec->ops->run(exec, tc);
+}
+
+// Abort the run in progress, if the backend can
+void executor_kill(executor_t *exec) {
+    if (!exec || !exec->ops || !exec->ops->kill) {
+        return;
+    }
+
+    exec->ops->kill(exec);
+}
+
+// Collect coverage of the last run
+int executor_collect_coverage(executor_t *exec, coverage_t *coverage) {
+    if (!exec || !exec->ops || !coverage) {
+        return -1;
+    }
+
+    return exec->ops->collect_coverage(exec, coverage);
+}
+
+// Check whether the last run crashed the target
+int executor_check_crash(executor_t *exec) {
+    if (!exec || !exec->ops) {
+        return -1;
+    }
+
+    return exec->ops->check_crash(exec);
+}
+
+// Save the crash log of the last run
+int executor_crash_log(executor_t *exec, const char *local_path) {
+    if (!exec || !exec->ops || !local_path) {
+        return -1;
+    }
+
+    return exec->ops->crash_log(exec, local_path);
+}
+
+// Bring the target back after a crash, if the backend has to
+int executor_recover(executor_t *exec) {
+    if (!exec || !exec->ops) {
+        return -1;
+    }
+
+    if (!exec->ops->recover) {
+        return 0;
+    }
+
+    return exec->ops->recover(exec);
+}
+
+// Queue a test case on a backend that keeps several in flight
+int executor_submit(executor_t *exec, testcase_t *tc) {
+    if (!exec || !exec->ops || !exec->ops->submit || !tc) {
+        return -1;
+    }
+
+    return exec->ops->submit(exec, tc);
+}
+
+// Wait for the oldest submitted test case
+int executor_reap(executor_t *exec, coverage_t *coverage, executor_result_t *result) {
+    if (!exec || !exec->ops || !exec->ops->reap || !coverage || !result) {
+        return -1;
+    }
+
+    return exec->ops->reap(exec, coverage, result);
+}
+
+// Report the backend's device-side stages
+int executor_pipeline_stats(executor_t *exec, pipeline_stats_t *stats) {
+    if (!exec || !exec->ops || !exec->ops->pipeline_stats || !stats) {
+        return -1;
+    }
+
+    return exec->ops->pipeline_stats(exec, stats);
+}
+
+// Clean up the executor backend
+void executor_cleanup(executor_t *exec) {
+    if (!exec || !exec->ops) {
+        return;
+    }
+
+    exec->ops->cleanup(exec);
+    memset(exec, 0, sizeof(executor_t));
+}
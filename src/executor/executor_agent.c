@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/fuzzkrieg.h"
+#include "../../include/executor.h"
+#include "../../include/agent.h"
+
+// A test case submitted to the agent
+typedef struct {
+    testcase_t *tc;
+    uint32_t batch;                 // Inputs of the batch it heads, 0 if it rides in an earlier one
+    uint64_t transfer_ns;           // Its share of sending that batch
+} agent_exec_slot_t;
+
+// Agent executor state
+typedef struct {
+    agent_client_t agent;
+    agent_exec_result_t result;     // Last run, or last result reaped
+
+    // Submitted test cases, oldest at head. The first sent of them are on
+    // the wire or answered, and the first ready of those have their
+    // results in results[next..]; the rest wait for the next batch.
+    agent_exec_slot_t slots[EXECUTOR_MAX_IN_FLIGHT];
+    uint32_t slot_head;
+    uint32_t slot_count;
+    uint32_t sent;
+    uint32_t ready;
+    uint32_t next;
+    int batch_status;               // Of the batch the ready results came in
+    agent_exec_result_t results[EXECUTOR_MAX_IN_FLIGHT];
+} agent_executor_t;
+
+// Connect to the agent named by the target, as host:port
+static int agent_exec_init(executor_t *exec, const fuzz_config_t *config, device_ctx_t *device) {
+    (void)device;
+
+    if (!config->target) {
+        return -1;
+    }
+
+    char host[256];
+    snprintf(host, sizeof(host), "%s", config->target);
+    uint16_t port = AGENT_DEFAULT_PORT;
+    char *colon = strrchr(host, ':');
+    if (colon) {
+        *colon = '\0';
+        port = (uint16_t)atoi(colon + 1);
+    }
+
+    // A farm's agents listen on consecutive ports, one host each
+    port += config->job;
+
+    agent_executor_t *ae = calloc(1, sizeof(agent_executor_t));
+    if (!ae) {
+        return -1;
+    }
+
+    if (agent_connect_tcp(&ae->agent, host, port, COVERAGE_MAP_SIZE) != 0) {
+        free(ae);
+        return -1;
+    }
+
+    exec->priv = ae;
+    return 0;
+}
+
+// Inputs travel inside the exec request
+static int agent_exec_load(executor_t *exec, testcase_t *tc) {
+    (void)exec;
+    (void)tc;
+    return 0;
+}
+
+// Run the test case as a batch of one; the agent enforces the timeout, as the
+// watchdog cannot reach it
+static int agent_exec_run(executor_t *exec, testcase_t *tc) {
+    agent_executor_t *ae = exec->priv;
+
+    agent_exec_t input = {
+        .data = tc->data,
+        .size = tc->size,
+        .base = tc->parent,
+        .base_size = tc->parent_size
+    };
+    if (agent_exec_batch(&ae->agent, &input, 1, exec->timeout_ms, &ae->result) != 0) {
+        return -1;
+    }
+
+    if (ae->result.status == AGENT_STATUS_TIMEOUT) {
+        tc->timed_out = 1;
+    }
+    return ae->result.status == AGENT_STATUS_ERROR ? -1 : 0;
+}
+
+// Send count submitted test cases, from the first-th oldest on, as one batch
+static int agent_exec_send_slots(executor_t *exec, uint32_t first, uint32_t count) {
+    agent_executor_t *ae = exec->priv;
+    agent_exec_t inputs[EXECUTOR_MAX_IN_FLIGHT];
+    agent_exec_slot_t *batch[EXECUTOR_MAX_IN_FLIGHT];
+
+    for (uint32_t i = 0; i < count; i++) {
+        batch[i] = &ae->slots[(ae->slot_head + first + i) % EXECUTOR_MAX_IN_FLIGHT];
+        testcase_t *tc = batch[i]->tc;
+        inputs[i] = (agent_exec_t){
+            .data = tc->data,
+            .size = tc->size,
+            .base = tc->parent,
+            .base_size = tc->parent_size
+        };
+    }
+
+    uint64_t start = stats_now_ns();
+    if (agent_exec_send(&ae->agent, inputs, count, exec->timeout_ms) != 0) {
+        return -1;
+    }
+    uint64_t share = (stats_now_ns() - start) / count;
+
+    for (uint32_t i = 0; i < count; i++) {
+        batch[i]->batch = i == 0 ? count : 0;
+        batch[i]->transfer_ns = share;
+    }
+    return 0;
+}
+
+// With no batch on the wire, send every test case not sent yet as the next one
+static void agent_exec_flush(executor_t *exec) {
+    agent_executor_t *ae = exec->priv;
+    uint32_t count = ae->slot_count - ae->sent;
+    if (ae->sent != ae->ready || count == 0) {
+        return;
+    }
+
+    if (agent_exec_send_slots(exec, ae->sent, count) != 0) {
+        fprintf(stderr, "Failed to send test cases to the agent\n");
+        return;
+    }
+    ae->sent += count;
+}
+
+// Take the results of the batch on the wire. If the agent lost a base it
+// was patched against it ran none of it, so it goes again in full.
+static void agent_exec_receive(executor_t *exec) {
+    agent_executor_t *ae = exec->priv;
+    uint32_t count = ae->slots[ae->slot_head].batch;
+
+    int ret = agent_exec_recv(&ae->agent, count, exec->timeout_ms, ae->results);
+    if (ret != 0) {
+        agent_forget_cache(&ae->agent);
+        if (ae->agent.last_error == AGENT_ERR_CACHE_MISS && agent_exec_send_slots(exec, 0, count) == 0) {
+            ret = agent_exec_recv(&ae->agent, count, exec->timeout_ms, ae->results);
+        }
+    }
+
+    ae->ready = count;
+    ae->next = 0;
+    ae->batch_status = ret;
+}
+
+// Queue a test case; it goes out with whatever else was submitted by the
+// time the agent is done with the batch before
+static int agent_exec_submit(executor_t *exec, testcase_t *tc) {
+    agent_executor_t *ae = exec->priv;
+    if (ae->slot_count == EXECUTOR_MAX_IN_FLIGHT) {
+        return -1;
+    }
+
+    agent_exec_slot_t *slot = &ae->slots[(ae->slot_head + ae->slot_count) % EXECUTOR_MAX_IN_FLIGHT];
+    slot->tc = tc;
+    slot->batch = 0;
+    slot->transfer_ns = 0;
+    ae->slot_count++;
+    return 0;
+}
+
+// Take the result of the oldest submitted test case. One batch is on the
+// wire at a time: the agent runs it while the results of the one before
+// are reaped and the test cases for the next are submitted.
+static int agent_exec_reap(executor_t *exec, coverage_t *coverage, executor_result_t *result) {
+    agent_executor_t *ae = exec->priv;
+    if (ae->slot_count == 0) {
+        return 0;
+    }
+
+    agent_exec_slot_t *slot = &ae->slots[ae->slot_head];
+    memset(result, 0, sizeof(executor_result_t));
+    result->tc = slot->tc;
+    result->status = -1;
+
+    agent_exec_flush(exec);
+    if (ae->ready == 0) {
+        if (ae->sent == 0) {
+            // Nothing went out, so this one alone fails
+            ae->slot_head = (ae->slot_head + 1) % EXECUTOR_MAX_IN_FLIGHT;
+            ae->slot_count--;
+            return 1;
+        }
+        agent_exec_receive(exec);
+    }
+
+    ae->result = ae->results[ae->next++];
+    ae->ready--;
+    ae->sent--;
+    ae->slot_head = (ae->slot_head + 1) % EXECUTOR_MAX_IN_FLIGHT;
+    ae->slot_count--;
+    result->transfer_ns = slot->transfer_ns;
+
+    // Coverage stays in the frame buffer until the next receive; sending does not touch it
+    agent_exec_flush(exec);
+
+    if (ae->batch_status != 0 || ae->result.status == AGENT_STATUS_ERROR ||
+        agent_coverage_decode(&ae->result, coverage->map, coverage->map_size) != 0) {
+        return 1;
+    }
+    result->status = 0;
+    result->run_ns = (uint64_t)ae->result.exec_time_us * 1000;
+
+    if (ae->result.status == AGENT_STATUS_TIMEOUT) {
+        result->tc->timed_out = 1;
+    }
+    result->crashed = ae->result.status == AGENT_STATUS_CRASH;
+    return 1;
+}
+
+// Expand the coverage delta of the last run
+static int agent_exec_collect_coverage(executor_t *exec, coverage_t *coverage) {
+    agent_executor_t *ae = exec->priv;
+
+    if (!coverage->map) {
+        return -1;
+    }
+
+    return agent_coverage_decode(&ae->result, coverage->map, coverage->map_size);
+}
+
+// The agent reports crashes per input
+static int agent_exec_check_crash(executor_t *exec) {
+    agent_executor_t *ae = exec->priv;
+    return ae->result.status == AGENT_STATUS_CRASH ? 1 : 0;
+}
+
+// Describe the terminating signal of the last run
+static int agent_exec_crash_log(executor_t *exec, const char *local_path) {
+    agent_executor_t *ae = exec->priv;
+
+    FILE *f = fopen(local_path, "w");
+    if (!f) {
+        return -1;
+    }
+
+    fprintf(f, "Terminated by signal %d (%s)\n", ae->result.signal, strsignal(ae->result.signal));
+    fclose(f);
+    return 0;
+}
+
+// Close the agent connection
+static void agent_exec_cleanup(executor_t *exec) {
+    agent_executor_t *ae = exec->priv;
+    if (!ae) {
+        return;
+    }
+
+    if (ae->agent.input_bytes) {
+        printf("Agent transfer: %llu of %llu input bytes sent, %llu inputs in %llu batches\n",
+               (unsigned long long)ae->agent.wire_bytes, (unsigned long long)ae->agent.input_bytes,
+               (unsigned long long)ae->agent.inputs, (unsigned long long)ae->agent.batches);
+    }
+    agent_close(&ae->agent);
+    free(ae);
+    exec->priv = NULL;
+}
+
+const executor_ops_t executor_agent_ops = {
+    .name = "agent",
+    .init = agent_exec_init,
+    .load = agent_exec_load,
+    .run = agent_exec_run,
+    .collect_coverage = agent_exec_collect_coverage,
+    .check_crash = agent_exec_check_crash,
+    .crash_log = agent_exec_crash_log,
+    .submit = agent_exec_submit,
+    .reap = agent_exec_reap,
+    .cleanup = agent_exec_cleanup
+};
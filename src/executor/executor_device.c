@@ -0,0 +1,586 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../../include/fuzzkrieg.h"
+#include "../../include/executor.h"
+#include "../../include/device_io.h"
+
+// On-device layout: the harness is installed once, payloads replace each
+// other. Test cases in flight each get their own payload, since the next
+// is uploaded while one runs.
+#define DEVICE_WORK_DIR "/var/root/fuzzkrieg"
+#define DEVICE_HARNESS_PATH DEVICE_WORK_DIR "/harness"
+#define DEVICE_PAYLOAD_PATH DEVICE_WORK_DIR "/payload"
+
+// Requests queued per test case: upload, execute, coverage, crash poll
+#define DEVICE_EXEC_MAX_REQUESTS 4
+
+// Wait between checks on a call in flight; every call ends on its own
+#define DEVICE_IO_WAIT_MS 1000
+
+// A test case in flight, and the map its coverage lands in
+typedef struct {
+    testcase_t *tc;
+    uint8_t *map;
+    uint32_t requests;              // Completions still to take for it
+    char payload[64];               // Where its input is uploaded without the agent
+    char command[128];              // Runs the harness on that payload
+} device_exec_slot_t;
+
+// Device executor state
+typedef struct {
+    device_ctx_t *device;
+    device_io_t io;                 // Every device call goes through its thread
+    agent_status_t exec_status;     // Last run through the agent
+    device_exec_slot_t slots[EXECUTOR_MAX_IN_FLIGHT];
+    uint32_t slot_head;             // Oldest test case in flight
+    uint32_t slot_count;
+    char udid[64];                  // Device to come back to after a reboot
+    char target[256];               // Local harness build
+    char crash_store[256];          // Local copies of the device's crash reports
+    char crash_report[512];         // Newest report copied into the store, if any
+    int disconnected;               // The device went away since the last crash log
+} device_executor_t;
+
+// Phases of bringing a device back after it went down
+typedef enum {
+    RECOVERY_WAIT_REBOOT,    // Until usbmuxd lists the device again
+    RECOVERY_RECONNECT,      // Until lockdown answers
+    RECOVERY_VERIFY,         // Check the harness survived the reboot
+    RECOVERY_DONE
+} device_recovery_phase_t;
+
+// Crash report callback: remember the newest local copy
+static void device_exec_report(const char *path, void *arg) {
+    device_executor_t *dev = arg;
+    snprintf(dev->crash_report, sizeof(dev->crash_report), "%s", path);
+}
+
+// Upload the harness only if the device lacks this exact build.
+// Returns 1 if it was uploaded, 0 if the device's copy matched.
+static int device_exec_install(device_executor_t *dev) {
+    device_make_directory(dev->device, DEVICE_WORK_DIR);
+    int installed = device_install_file(dev->device, dev->target, DEVICE_HARNESS_PATH);
+    if (installed < 0) {
+        fprintf(stderr, "Failed to install harness %s\n", dev->target);
+        return -1;
+    }
+    if (installed == 1 && device_execute_command(dev->device, "chmod 755 " DEVICE_HARNESS_PATH) != 0) {
+        fprintf(stderr, "Failed to make harness executable\n");
+        return -1;
+    }
+
+    return installed;
+}
+
+// Disconnect and free the executor state
+static void device_exec_free(device_executor_t *dev) {
+    device_io_stop(&dev->io);
+    device_disconnect(dev->device);
+    for (uint32_t i = 0; i < EXECUTOR_MAX_IN_FLIGHT; i++) {
+        free(dev->slots[i].map);
+    }
+    free(dev);
+}
+
+// Make one device call through the I/O lanes and wait for it; nothing
+// else may be in flight
+static int device_exec_call(device_executor_t *dev, const device_io_request_t *request,
+                            device_io_completion_t *completion) {
+    if (device_io_submit(&dev->io, request) != 0) {
+        return -1;
+    }
+
+    // Agent requests and AFC transfers time out, so this does not hang
+    while (!device_io_wait(&dev->io, completion, DEVICE_IO_WAIT_MS)) {
+        if (!dev->io.running) {
+            return -1;
+        }
+    }
+    return completion->status;
+}
+
+// Connect to the iOS device and install the harness
+static int device_exec_init(executor_t *exec, const fuzz_config_t *config, device_ctx_t *device) {
+    if (!device || !config->target) {
+        return -1;
+    }
+
+    device_executor_t *dev = calloc(1, sizeof(device_executor_t));
+    if (!dev) {
+        return -1;
+    }
+    dev->device = device;
+    snprintf(dev->target, sizeof(dev->target), "%s", config->target);
+
+    const char *udid = config->device_count > 0 ? config->devices[0] : NULL;
+    if (device_connect(device, udid) != 0) {
+        fprintf(stderr, "Failed to connect to device\n");
+        free(dev);
+        return -1;
+    }
+    snprintf(dev->udid, sizeof(dev->udid), "%s", device->udid ? device->udid : (udid ? udid : ""));
+
+    if (device_exec_install(dev) < 0) {
+        device_disconnect(device);
+        free(dev);
+        return -1;
+    }
+
+    // Each device keeps its own crash store and cursor
+    snprintf(dev->crash_store, sizeof(dev->crash_store), "%s/%s", config->output_dir, DEVICE_CRASH_STORE);
+    mkdir(dev->crash_store, 0755);
+    snprintf(dev->crash_store, sizeof(dev->crash_store), "%s/%s/%s", config->output_dir, DEVICE_CRASH_STORE,
+             device->udid ? device->udid : "device");
+
+    // Crash checks drain the monitor's events; without it they poll the device
+    if (device_monitor_status(device, dev->crash_store) != 0) {
+        fprintf(stderr, "Device monitor unavailable, polling for crashes\n");
+    }
+
+    for (uint32_t i = 0; i < EXECUTOR_MAX_IN_FLIGHT; i++) {
+        device_exec_slot_t *slot = &dev->slots[i];
+        slot->map = aligned_alloc(64, COVERAGE_MAP_SIZE);
+        if (!slot->map) {
+            device_exec_free(dev);
+            return -1;
+        }
+        snprintf(slot->payload, sizeof(slot->payload), DEVICE_PAYLOAD_PATH ".%u", i);
+        snprintf(slot->command, sizeof(slot->command), DEVICE_HARNESS_PATH " %s", slot->payload);
+    }
+    if (device_io_start(&dev->io, device) != 0) {
+        device_exec_free(dev);
+        return -1;
+    }
+
+    exec->priv = dev;
+    return 0;
+}
+
+// Stream a test case to the device straight from its buffer
+static int device_exec_load(executor_t *exec, testcase_t *tc) {
+    device_executor_t *dev = exec->priv;
+
+    // The agent takes inputs inside the exec request
+    if (dev->device->agent.connected) {
+        return 0;
+    }
+
+    device_io_request_t request = {
+        .op = DEVICE_IO_UPLOAD,
+        .data = tc->data,
+        .size = tc->size,
+        .path = DEVICE_PAYLOAD_PATH
+    };
+    device_io_completion_t completion;
+    return device_exec_call(dev, &request, &completion);
+}
+
+// The request that runs a test case: the agent takes it inline, the
+// command-line harness reads the payload uploaded for it
+static device_io_request_t device_exec_request(const executor_t *exec, const testcase_t *tc,
+                                               const char *command) {
+    device_io_request_t request = {
+        .op = DEVICE_IO_EXECUTE,
+        .data = tc->data,
+        .size = tc->size,
+        .base = tc->parent,
+        .base_size = tc->parent_size,
+        .path = command,
+        .timeout_ms = exec->timeout_ms
+    };
+    return request;
+}
+
+// Run the installed harness on the transferred payload
+static int device_exec_run(executor_t *exec, testcase_t *tc) {
+    device_executor_t *dev = exec->priv;
+
+    device_io_request_t request = device_exec_request(exec, tc, DEVICE_HARNESS_PATH " " DEVICE_PAYLOAD_PATH);
+    device_io_completion_t completion;
+    if (device_exec_call(dev, &request, &completion) != 0) {
+        return -1;
+    }
+
+    dev->exec_status = completion.exec_status;
+    if (dev->device->agent.connected && completion.exec_status == AGENT_STATUS_TIMEOUT) {
+        tc->timed_out = 1;
+    }
+    return 0;
+}
+
+// Collect coverage information from the device
+static int device_exec_collect_coverage(executor_t *exec, coverage_t *coverage) {
+    device_executor_t *dev = exec->priv;
+
+    device_io_request_t request = {
+        .op = DEVICE_IO_COVERAGE,
+        .map = coverage->map,
+        .map_size = coverage->map_size
+    };
+    device_io_completion_t completion;
+    return device_exec_call(dev, &request, &completion);
+}
+
+// Without the agent or the monitor, crashes are found by polling the
+// crash report service after each run
+static int device_exec_polls(const device_executor_t *dev) {
+    return !dev->device->agent.connected && !dev->device->monitor.running;
+}
+
+// Decide whether the last run crashed: the agent reports crashes per input,
+// the monitor's events or a poll of the device catch panics
+static int device_exec_crashed(device_executor_t *dev, agent_status_t exec_status,
+                               const device_io_completion_t *poll) {
+    int crashed = dev->device->agent.connected && exec_status == AGENT_STATUS_CRASH;
+
+    if (dev->device->monitor.running) {
+        device_event_t event;
+        while (device_poll_event(dev->device, &event)) {
+            switch (event.type) {
+                case DEVICE_EVENT_DISCONNECTED:
+                    dev->disconnected = 1;
+                    crashed = 1;  // A panic takes the device down
+                    break;
+                case DEVICE_EVENT_CRASH_REPORT:
+                    // With the agent, reports lag behind the input that caused them
+                    snprintf(dev->crash_report, sizeof(dev->crash_report), "%s", event.path);
+                    if (!dev->device->agent.connected) {
+                        crashed = 1;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        return crashed;
+    }
+
+    if (dev->device->agent.connected) {
+        return crashed;
+    }
+
+    // Check device status
+    if (device_check_status(dev->device) != 0) {
+        dev->disconnected = 1;
+        return 1;  // Device is in a crashed state
+    }
+
+    // Check for new crash reports
+    if (poll && poll->status == 0 && poll->reports > 0) {
+        snprintf(dev->crash_report, sizeof(dev->crash_report), "%s", poll->report);
+        return 1;
+    }
+
+    return 0;  // No crash detected
+}
+
+// Check the device for crashes
+static int device_exec_check_crash(executor_t *exec) {
+    device_executor_t *dev = exec->priv;
+
+    device_io_completion_t completion;
+    if (device_exec_polls(dev)) {
+        device_io_request_t request = { .op = DEVICE_IO_CRASH, .path = dev->crash_store };
+        device_exec_call(dev, &request, &completion);
+        return device_exec_crashed(dev, dev->exec_status, &completion);
+    }
+
+    return device_exec_crashed(dev, dev->exec_status, NULL);
+}
+
+// Queue the calls that run a test case and fetch its coverage, leaving
+// the device busy while the caller prepares the next one. The transfer
+// lane ships it while the test cases ahead of it run.
+static int device_exec_submit(executor_t *exec, testcase_t *tc) {
+    device_executor_t *dev = exec->priv;
+
+    if (dev->slot_count == EXECUTOR_MAX_IN_FLIGHT ||
+        DEVICE_IO_RING_SIZE - device_io_in_flight(&dev->io) < DEVICE_EXEC_MAX_REQUESTS) {
+        return -1;
+    }
+
+    device_exec_slot_t *slot = &dev->slots[(dev->slot_head + dev->slot_count) % EXECUTOR_MAX_IN_FLIGHT];
+    slot->tc = tc;
+    slot->requests = 0;
+
+    // The rings have room for all of them, so only a stopped thread refuses
+    int ret = 0;
+    if (!dev->device->agent.connected) {
+        device_io_request_t upload = {
+            .op = DEVICE_IO_UPLOAD,
+            .data = tc->data,
+            .size = tc->size,
+            .path = slot->payload
+        };
+        ret |= device_io_submit(&dev->io, &upload);
+        slot->requests++;
+    }
+
+    device_io_request_t run = device_exec_request(exec, tc, slot->command);
+    ret |= device_io_submit(&dev->io, &run);
+    slot->requests++;
+
+    device_io_request_t coverage = {
+        .op = DEVICE_IO_COVERAGE,
+        .map = slot->map,
+        .map_size = COVERAGE_MAP_SIZE
+    };
+    ret |= device_io_submit(&dev->io, &coverage);
+    slot->requests++;
+
+    if (device_exec_polls(dev)) {
+        device_io_request_t poll = { .op = DEVICE_IO_CRASH, .path = dev->crash_store };
+        ret |= device_io_submit(&dev->io, &poll);
+        slot->requests++;
+    }
+
+    if (ret != 0) {
+        return -1;
+    }
+    dev->slot_count++;
+    return 0;
+}
+
+// Take the completions of the oldest test case in flight
+static int device_exec_reap(executor_t *exec, coverage_t *coverage, executor_result_t *result) {
+    device_executor_t *dev = exec->priv;
+
+    if (dev->slot_count == 0) {
+        return 0;
+    }
+
+    device_exec_slot_t *slot = &dev->slots[dev->slot_head];
+    memset(result, 0, sizeof(executor_result_t));
+    result->tc = slot->tc;
+
+    agent_status_t exec_status = AGENT_STATUS_OK;
+    device_io_completion_t completion, poll = { .status = -1 };
+    int lost = 0;
+    while (slot->requests > 0) {
+        if (!device_io_wait(&dev->io, &completion, DEVICE_IO_WAIT_MS)) {
+            if (!dev->io.running) {
+                return -1;
+            }
+            continue;
+        }
+        slot->requests--;
+
+        // A failed poll is no failed run; the next one catches up
+        if (completion.status != 0 && completion.op != DEVICE_IO_CRASH) {
+            result->status = -1;
+            lost |= completion.op == DEVICE_IO_EXECUTE || completion.op == DEVICE_IO_COVERAGE;
+        }
+        result->transfer_ns += completion.transfer_ns;
+        switch (completion.op) {
+            case DEVICE_IO_EXECUTE:
+                result->run_ns = completion.end_ns - completion.start_ns;
+                exec_status = completion.exec_status;
+                break;
+            case DEVICE_IO_CRASH:
+                poll = completion;
+                result->crash_check_ns = completion.end_ns - completion.start_ns;
+                break;
+            default:
+                break;
+        }
+    }
+
+    dev->slot_head = (dev->slot_head + 1) % EXECUTOR_MAX_IN_FLIGHT;
+    dev->slot_count--;
+    if (result->status != 0) {
+        // A panic fails the run or the coverage fetch before the monitor
+        // reports the device gone; the target was lost with this input, so
+        // it is reported as a crash. Its events are drained meanwhile.
+        if (lost) {
+            uint64_t start = stats_now_ns();
+            device_exec_crashed(dev, exec_status, NULL);
+            result->crashed = 1;
+            result->crash_check_ns += stats_now_ns() - start;
+        }
+        return 1;
+    }
+
+    // The slot's map becomes the caller's; the old one serves a later test case
+    uint8_t *map = coverage->map;
+    coverage->map = slot->map;
+    slot->map = map;
+
+    if (dev->device->agent.connected && exec_status == AGENT_STATUS_TIMEOUT) {
+        result->tc->timed_out = 1;
+    } else {
+        uint64_t start = stats_now_ns();
+        result->crashed = device_exec_crashed(dev, exec_status, &poll);
+        result->crash_check_ns += stats_now_ns() - start;
+    }
+    return 1;
+}
+
+// Report the device's transfer and execute lanes
+static int device_exec_pipeline_stats(executor_t *exec, pipeline_stats_t *stats) {
+    device_executor_t *dev = exec->priv;
+
+    device_io_stats(&dev->io, stats);
+    return 0;
+}
+
+// Save the newest crash report copied from the device
+static int device_exec_crash_log(executor_t *exec, const char *local_path) {
+    device_executor_t *dev = exec->priv;
+
+    FILE *out = fopen(local_path, "wb");
+    if (!out) {
+        fprintf(stderr, "Failed to create crash log %s\n", local_path);
+        return -1;
+    }
+
+    int ret = 0;
+    FILE *in = dev->crash_report[0] ? fopen(dev->crash_report, "rb") : NULL;
+    if (in) {
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+            if (fwrite(buffer, 1, n, out) != n) {
+                ret = -1;
+                break;
+            }
+        }
+        fclose(in);
+    } else {
+        // Reports can trail the crash; the store keeps them as they arrive
+        fprintf(out, "No crash report retrieved from the device yet%s\n",
+                dev->disconnected ? " (device disconnected)" : "");
+    }
+
+    if (fclose(out) != 0) {
+        ret = -1;
+    }
+    dev->crash_report[0] = '\0';
+    dev->disconnected = 0;
+    return ret;
+}
+
+// Wait for the device to reboot, reconnect and check the harness is still
+// the build we installed. Fails after DEVICE_RECOVERY_TIMEOUT or when
+// exec->cancel is set; the executor then only supports cleanup.
+static int device_exec_recover(executor_t *exec) {
+    device_executor_t *dev = exec->priv;
+    uint64_t start = stats_now_ns();
+    uint64_t deadline = start + (uint64_t)DEVICE_RECOVERY_TIMEOUT * 1000000000ULL;
+
+    // The agent, AFC and monitor connections went down with the device;
+    // whatever was still queued on them is dropped
+    device_io_stop(&dev->io);
+    dev->slot_count = 0;
+    device_disconnect(dev->device);
+    printf("Device %s went down, waiting for it to reboot\n", dev->udid);
+
+    device_recovery_phase_t phase = RECOVERY_WAIT_REBOOT;
+    while (phase != RECOVERY_DONE) {
+        if (atomic_load(&exec->cancel)) {
+            return -1;
+        }
+        if (stats_now_ns() > deadline) {
+            fprintf(stderr, "Failed to recover device %s within %u s\n", dev->udid, DEVICE_RECOVERY_TIMEOUT);
+            return -1;
+        }
+
+        switch (phase) {
+            case RECOVERY_WAIT_REBOOT:
+                if (device_is_attached(dev->udid)) {
+                    phase = RECOVERY_RECONNECT;
+                    continue;
+                }
+                break;
+
+            case RECOVERY_RECONNECT:
+                if (device_connect(dev->device, dev->udid) == 0) {
+                    phase = RECOVERY_VERIFY;
+                    continue;
+                }
+                // Listed before lockdown is up, or gone again
+                phase = RECOVERY_WAIT_REBOOT;
+                break;
+
+            case RECOVERY_VERIFY: {
+                int installed = device_exec_install(dev);
+                if (installed < 0) {
+                    device_disconnect(dev->device);
+                    phase = RECOVERY_WAIT_REBOOT;
+                    break;
+                }
+                printf("Device %s: harness %s\n", dev->udid, installed ? "reinstalled" : "verified");
+                phase = RECOVERY_DONE;
+                continue;
+            }
+
+            default:
+                break;
+        }
+
+        usleep(DEVICE_RECOVERY_POLL_MS * 1000);
+    }
+
+    if (device_monitor_status(dev->device, dev->crash_store) != 0) {
+        fprintf(stderr, "Device monitor unavailable, polling for crashes\n");
+    }
+
+    // Reports copied on reconnecting belong to the crash that took the
+    // device down, not to the next input
+    if (dev->device->monitor.running) {
+        device_event_t event;
+        while (device_poll_event(dev->device, &event)) {
+            if (event.type == DEVICE_EVENT_CRASH_REPORT) {
+                snprintf(dev->crash_report, sizeof(dev->crash_report), "%s", event.path);
+            }
+        }
+    } else {
+        device_get_crash_logs(dev->device, dev->crash_store, device_exec_report, dev);
+    }
+    if (dev->crash_report[0]) {
+        printf("Device %s: crash report %s\n", dev->udid, dev->crash_report);
+    }
+    dev->crash_report[0] = '\0';
+    dev->disconnected = 0;
+
+    if (device_io_start(&dev->io, dev->device) != 0) {
+        return -1;
+    }
+
+    printf("Device %s recovered in %.1f s\n", dev->udid, (stats_now_ns() - start) / 1e9);
+    return 0;
+}
+
+// Disconnect from the device
+static void device_exec_cleanup(executor_t *exec) {
+    device_executor_t *dev = exec->priv;
+    if (!dev) {
+        return;
+    }
+
+    const agent_client_t *agent = &dev->device->agent;
+    if (agent->input_bytes) {
+        printf("Agent transfer: %llu of %llu input bytes sent, %llu inputs in %llu batches\n",
+               (unsigned long long)agent->wire_bytes, (unsigned long long)agent->input_bytes,
+               (unsigned long long)agent->inputs, (unsigned long long)agent->batches);
+    }
+    device_exec_free(dev);
+    exec->priv = NULL;
+}
+
+const executor_ops_t executor_device_ops = {
+    .name = "device",
+    .init = device_exec_init,
+    .load = device_exec_load,
+    .run = device_exec_run,
+    .collect_coverage = device_exec_collect_coverage,
+    .check_crash = device_exec_check_crash,
+    .crash_log = device_exec_crash_log,
+    .recover = device_exec_recover,
+    .submit = device_exec_submit,
+    .reap = device_exec_reap,
+    .pipeline_stats = device_exec_pipeline_stats,
+    .cleanup = device_exec_cleanup
+};
@@ -0,0 +1,400 @@
+#define _GNU_SOURCE             // pipe2
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "../../include/fuzzkrieg.h"
+#include "../../include/executor.h"
+#include "../../include/forkserver.h"
+
+extern char **environ;
+
+// Pipe that harnesses started later do not inherit: a farm's jobs start
+// fork servers concurrently, and a stray write end would keep a job from
+// seeing its own fork server die
+static int forkserver_pipe(int fds[2]) {
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC);
+#else
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
+#endif
+}
+
+#define FORKSRV_HANDSHAKE_MS 10000
+
+// Fork server executor state
+typedef struct {
+    int shm_id;
+    uint8_t *trace_bits;
+    int ctl_fd;
+    int st_fd;
+    pid_t fsrv_pid;
+    _Atomic pid_t child_pid;
+    atomic_int timed_out;       // Set by forkserver_kill for the current run
+    int last_status;
+    int input_fd;
+    char input_path[256];
+} forkserver_t;
+
+// Read exactly len bytes from fd
+static int read_full(int fd, void *buf, size_t len) {
+    uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Write exactly len bytes to fd
+static int write_full(int fd, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Release everything held by the fork server state
+static void forkserver_release(forkserver_t *fs) {
+    if (fs->fsrv_pid > 0) {
+        kill(fs->fsrv_pid, SIGKILL);
+        waitpid(fs->fsrv_pid, NULL, 0);
+    }
+    if (fs->ctl_fd >= 0) {
+        close(fs->ctl_fd);
+    }
+    if (fs->st_fd >= 0) {
+        close(fs->st_fd);
+    }
+    if (fs->input_fd >= 0) {
+        close(fs->input_fd);
+        unlink(fs->input_path);
+    }
+    if (fs->trace_bits && fs->trace_bits != (void *)-1) {
+        shmdt(fs->trace_bits);
+    }
+    if (fs->shm_id >= 0) {
+        shmctl(fs->shm_id, IPC_RMID, NULL);
+    }
+    free(fs);
+}
+
+// The harness's environment: ours, with the id of its coverage segment.
+// Built for each fork server rather than set on the process, as a farm
+// starts several from different threads.
+static char **forkserver_environment(int shm_id) {
+    size_t count = 0;
+    while (environ[count]) {
+        count++;
+    }
+
+    char **envp = calloc(count + 2, sizeof(char *));
+    char *shm_var = malloc(sizeof(FORKSRV_SHM_ENV) + 16);
+    if (!envp || !shm_var) {
+        free(envp);
+        free(shm_var);
+        return NULL;
+    }
+    snprintf(shm_var, sizeof(FORKSRV_SHM_ENV) + 16, "%s=%d", FORKSRV_SHM_ENV, shm_id);
+
+    size_t n = 0;
+    envp[n++] = shm_var;
+    for (size_t i = 0; i < count; i++) {
+        if (strncmp(environ[i], FORKSRV_SHM_ENV "=", sizeof(FORKSRV_SHM_ENV)) != 0) {
+            envp[n++] = environ[i];
+        }
+    }
+    return envp;
+}
+
+// Free an environment from forkserver_environment; only the first entry is ours
+static void forkserver_free_environment(char **envp) {
+    free(envp[0]);
+    free(envp);
+}
+
+// Map the coverage segment and start the fork server
+static int forkserver_init(executor_t *exec, const fuzz_config_t *config, device_ctx_t *device) {
+    (void)device;
+
+    if (!config->target) {
+        return -1;
+    }
+
+    forkserver_t *fs = calloc(1, sizeof(forkserver_t));
+    if (!fs) {
+        return -1;
+    }
+    fs->ctl_fd = fs->st_fd = fs->input_fd = -1;
+    fs->fsrv_pid = -1;
+
+    // Shared coverage map; marked for removal once the harness has
+    // attached, so it goes away with the last process even if we are killed
+    fs->shm_id = shmget(IPC_PRIVATE, FORKSRV_MAP_SIZE, IPC_CREAT | IPC_EXCL | 0600);
+    if (fs->shm_id < 0) {
+        fprintf(stderr, "Failed to create coverage shared memory: %s\n", strerror(errno));
+        forkserver_release(fs);
+        return -1;
+    }
+
+    fs->trace_bits = shmat(fs->shm_id, NULL, 0);
+    if (fs->trace_bits == (void *)-1) {
+        fprintf(stderr, "Failed to attach coverage shared memory: %s\n", strerror(errno));
+        forkserver_release(fs);
+        return -1;
+    }
+
+    // The harness reads each input from stdin, backed by this file; each
+    // of a farm's fork servers has its own
+    mkdir(config->output_dir, 0755);
+    if (config->job) {
+        snprintf(fs->input_path, sizeof(fs->input_path), "%s/.cur_input.%u", config->output_dir, config->job);
+    } else {
+        snprintf(fs->input_path, sizeof(fs->input_path), "%s/.cur_input", config->output_dir);
+    }
+    fs->input_fd = open(fs->input_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fs->input_fd < 0) {
+        fprintf(stderr, "Failed to create %s: %s\n", fs->input_path, strerror(errno));
+        forkserver_release(fs);
+        return -1;
+    }
+
+    char **envp = forkserver_environment(fs->shm_id);
+    if (!envp) {
+        forkserver_release(fs);
+        return -1;
+    }
+
+    int ctl_pipe[2], st_pipe[2];
+    if (forkserver_pipe(ctl_pipe) != 0) {
+        forkserver_free_environment(envp);
+        forkserver_release(fs);
+        return -1;
+    }
+    if (forkserver_pipe(st_pipe) != 0) {
+        close(ctl_pipe[0]);
+        close(ctl_pipe[1]);
+        forkserver_free_environment(envp);
+        forkserver_release(fs);
+        return -1;
+    }
+
+    fs->fsrv_pid = fork();
+    if (fs->fsrv_pid < 0) {
+        close(ctl_pipe[0]);
+        close(ctl_pipe[1]);
+        close(st_pipe[0]);
+        close(st_pipe[1]);
+        forkserver_free_environment(envp);
+        forkserver_release(fs);
+        return -1;
+    }
+
+    if (fs->fsrv_pid == 0) {
+        // Child: wire up the protocol descriptors and exec the harness;
+        // dup2 clears close-on-exec on the copies it makes
+        setsid();
+        dup2(fs->input_fd, STDIN_FILENO);
+        if (!config->verbose) {
+            int null_fd = open("/dev/null", O_RDWR);
+            if (null_fd >= 0) {
+                dup2(null_fd, STDOUT_FILENO);
+                dup2(null_fd, STDERR_FILENO);
+                close(null_fd);
+            }
+        }
+
+        if (dup2(ctl_pipe[0], FORKSRV_FD) < 0 || dup2(st_pipe[1], FORKSRV_FD + 1) < 0) {
+            _exit(1);
+        }
+
+        close(ctl_pipe[0]);
+        close(ctl_pipe[1]);
+        close(st_pipe[0]);
+        close(st_pipe[1]);
+        close(fs->input_fd);
+
+        char *argv[] = { config->target, NULL };
+        execve(config->target, argv, envp);
+        _exit(1);
+    }
+
+    forkserver_free_environment(envp);
+    close(ctl_pipe[0]);
+    close(st_pipe[1]);
+    fs->ctl_fd = ctl_pipe[1];
+    fs->st_fd = st_pipe[0];
+
+    // Wait for the harness to say hello
+    struct pollfd pfd = { .fd = fs->st_fd, .events = POLLIN };
+    uint32_t hello = 0;
+    if (poll(&pfd, 1, FORKSRV_HANDSHAKE_MS) <= 0 ||
+        read_full(fs->st_fd, &hello, sizeof(hello)) != 0 ||
+        hello != FORKSRV_HELLO) {
+        fprintf(stderr, "Fork server handshake with %s failed\n", config->target);
+        forkserver_release(fs);
+        return -1;
+    }
+
+    // The harness attached before saying hello, and its children inherit
+    // the mapping
+    shmctl(fs->shm_id, IPC_RMID, NULL);
+    fs->shm_id = -1;
+
+    exec->priv = fs;
+    return 0;
+}
+
+// Replace the input file contents
+static int forkserver_load(executor_t *exec, testcase_t *tc) {
+    forkserver_t *fs = exec->priv;
+
+    atomic_store(&fs->timed_out, 0);
+
+    if (lseek(fs->input_fd, 0, SEEK_SET) < 0 ||
+        write_full(fs->input_fd, tc->data, tc->size) != 0 ||
+        ftruncate(fs->input_fd, tc->size) != 0 ||
+        lseek(fs->input_fd, 0, SEEK_SET) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Run the loaded input through the fork server
+static int forkserver_run(executor_t *exec, testcase_t *tc) {
+    forkserver_t *fs = exec->priv;
+    (void)tc;
+
+    memset(fs->trace_bits, 0, FORKSRV_MAP_SIZE);
+
+    // Ask the fork server for a new child and wait for it to finish
+    uint32_t go = 0;
+    if (write_full(fs->ctl_fd, &go, sizeof(go)) != 0) {
+        return -1;
+    }
+
+    int32_t pid;
+    if (read_full(fs->st_fd, &pid, sizeof(pid)) != 0 || pid <= 0) {
+        return -1;
+    }
+    atomic_store(&fs->child_pid, pid);
+
+    // The watchdog may have fired before the child existed
+    if (atomic_load(&fs->timed_out)) {
+        kill(pid, SIGKILL);
+    }
+
+    int32_t status;
+    if (read_full(fs->st_fd, &status, sizeof(status)) != 0) {
+        return -1;
+    }
+    fs->last_status = status;
+    atomic_store(&fs->child_pid, -1);
+
+    return 0;
+}
+
+// Kill the running child; the fork server then reports it as signalled
+static void forkserver_kill(executor_t *exec) {
+    forkserver_t *fs = exec->priv;
+
+    atomic_store(&fs->timed_out, 1);
+    pid_t pid = atomic_load(&fs->child_pid);
+    if (pid > 0) {
+        kill(pid, SIGKILL);
+    }
+}
+
+// Copy the shared coverage map
+static int forkserver_collect_coverage(executor_t *exec, coverage_t *coverage) {
+    forkserver_t *fs = exec->priv;
+
+    if (!coverage->map) {
+        return -1;
+    }
+
+    size_t size = coverage->map_size < FORKSRV_MAP_SIZE ? coverage->map_size : FORKSRV_MAP_SIZE;
+    memcpy(coverage->map, fs->trace_bits, size);
+    return 0;
+}
+
+// A run crashed if the child was killed by a signal we did not send
+static int forkserver_check_crash(executor_t *exec) {
+    forkserver_t *fs = exec->priv;
+    return WIFSIGNALED(fs->last_status) && !atomic_load(&fs->timed_out) ? 1 : 0;
+}
+
+// Describe the terminating signal of the last run
+static int forkserver_crash_log(executor_t *exec, const char *local_path) {
+    forkserver_t *fs = exec->priv;
+
+    FILE *f = fopen(local_path, "w");
+    if (!f) {
+        return -1;
+    }
+
+    if (WIFSIGNALED(fs->last_status)) {
+        int sig = WTERMSIG(fs->last_status);
+        fprintf(f, "Terminated by signal %d (%s)\n", sig, strsignal(sig));
+    } else {
+        fprintf(f, "Exited with status %d\n", WEXITSTATUS(fs->last_status));
+    }
+
+    fclose(f);
+    return 0;
+}
+
+// Stop the fork server and release the coverage map
+static void forkserver_cleanup(executor_t *exec) {
+    forkserver_t *fs = exec->priv;
+    if (!fs) {
+        return;
+    }
+
+    forkserver_release(fs);
+    exec->priv = NULL;
+}
+
+const executor_ops_t executor_forkserver_ops = {
+    .name = "forkserver",
+    .init = forkserver_init,
+    .load = forkserver_load,
+    .run = forkserver_run,
+    .kill = forkserver_kill,
+    .collect_coverage = forkserver_collect_coverage,
+    .check_crash = forkserver_check_crash,
+    .crash_log = forkserver_crash_log,
+    .cleanup = forkserver_cleanup
+};
@@ -3,30 +3,49 @@
 #include <string.h>
 #include <getopt.h>
 #include <signal.h>
-#include "../../include/fuzzkrieg.h"
+#include <time.h>
+#include <unistd.h>
+#include "../include/fuzzkrieg.h"
+#include "../include/executor.h"
+#include "../include/farm.h"
 
 // Global fuzzer instance
 static fuzzer_t g_fuzzer;
 
-// Signal handler
+// Signal handler; the loop checkpoints and cleans up on its way out.
+// Crashes still queued for triage are left for --resume.
 static void signal_handler(int signum) {
+    (void)signum;
     if (g_fuzzer.state == FUZZ_STATE_RUNNING) {
-        printf("\nReceived signal %d, cleaning up...\n", signum);
         g_fuzzer.state = FUZZ_STATE_PAUSED;
-        fuzzer_cleanup(&g_fuzzer);
+        atomic_store(&g_fuzzer.executor.cancel, 1);  // Stop waiting for a reboot
+        triage_cancel(&g_fuzzer.triage);
+        return;
     }
-    exit(0);
+
+    // Past the loop, the first signal cuts triage short; the next one exits
+    if (g_fuzzer.state != FUZZ_STATE_INIT && !atomic_load(&g_fuzzer.triage.cancel)) {
+        triage_cancel(&g_fuzzer.triage);
+        return;
+    }
+    _exit(1);
 }
 
 // Print usage information
 static void print_usage(const char *prog) {
     printf("Usage: %s [options]\n", prog);
     printf("Options:\n");
-    printf("  -d, --device <udid>    Device UDID to target\n");
-    printf("  -t, --target <path>    Target binary to fuzz\n");
+    printf("  -d, --device <udid>    Device UDID to target; repeat to drive several as a farm\n");
+    printf("  -F, --farm             Drive every attached device, admitting new ones as they appear\n");
+    printf("  -j, --jobs <n>         Run n forkserver or agent executors as a farm (agents on consecutive ports)\n");
+    printf("  -t, --target <path>    Target binary to fuzz (host:port of a running agent with -e agent)\n");
+    printf("  -e, --executor <name>  Executor backend: device, forkserver, agent (default: %s)\n", EXECUTOR_DEFAULT);
     printf("  -o, --output <dir>     Output directory for results\n");
     printf("  -i, --iterations <n>   Maximum number of iterations\n");
-    printf("  -T, --timeout <ms>     Timeout per test case (ms)\n");
+    printf("  -T, --timeout <ms>     Timeout per test case (ms, default: calibrated)\n");
+    printf("  -p, --schedule <name>  Power schedule: explore, fast, coe, lin, quad (default: fast)\n");
+    printf("  -s, --seed <n>         Random seed, to reproduce a run exactly\n");
+    printf("  -r, --resume           Resume from the checkpoint in the output directory\n");
     printf("  -v, --verbose         Enable verbose output\n");
     printf("  -h, --help            Show this help message\n");
 }
@@ -36,19 +55,27 @@ int main(int argc, char *argv[]) {
     fuzz_config_t config = {
         .target = NULL,
         .output_dir = "fuzz_results",
+        .executor = EXECUTOR_DEFAULT,
         .max_iterations = 1000000,
-        .timeout = 1000,
+        .timeout = 0,
         .max_crashes = 100,
+        .schedule = SCHEDULE_FAST,
         .verbose = 0
     };
 
     // Parse command line options
     static struct option long_options[] = {
         {"device", required_argument, 0, 'd'},
+        {"farm", no_argument, 0, 'F'},
+        {"jobs", required_argument, 0, 'j'},
         {"target", required_argument, 0, 't'},
+        {"executor", required_argument, 0, 'e'},
         {"output", required_argument, 0, 'o'},
         {"iterations", required_argument, 0, 'i'},
         {"timeout", required_argument, 0, 'T'},
+        {"schedule", required_argument, 0, 'p'},
+        {"seed", required_argument, 0, 's'},
+        {"resume", no_argument, 0, 'r'},
         {"verbose", no_argument, 0, 'v'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
@@ -56,14 +83,37 @@ int main(int argc, char *argv[]) {
 
     int opt;
     int option_index = 0;
-    while ((opt = getopt_long(argc, argv, "d:t:o:i:T:vh", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "d:Fj:t:e:o:i:T:p:s:rvh", long_options, &option_index)) != -1) {
         switch (opt) {
-            case 'd':
-                // Device UDID will be handled by device_connect
+            case 'd': {
+                if (config.device_count == FARM_MAX_DEVICES) {
+                    fprintf(stderr, "Error: At most %d devices\n", FARM_MAX_DEVICES);
+                    return 1;
+                }
+                char **devices = realloc(config.devices, (config.device_count + 1) * sizeof(char *));
+                if (!devices) {
+                    return 1;
+                }
+                devices[config.device_count++] = strdup(optarg);
+                config.devices = devices;
+                break;
+            }
+            case 'F':
+                config.farm = 1;
+                break;
+            case 'j':
+                config.jobs = atoi(optarg);
+                if (config.jobs == 0 || config.jobs > FARM_MAX_DEVICES) {
+                    fprintf(stderr, "Error: Between 1 and %d jobs\n", FARM_MAX_DEVICES);
+                    return 1;
+                }
                 break;
             case 't':
                 config.target = strdup(optarg);
                 break;
+            case 'e':
+                config.executor = strdup(optarg);
+                break;
             case 'o':
                 config.output_dir = strdup(optarg);
                 break;
@@ -73,6 +123,18 @@ int main(int argc, char *argv[]) {
             case 'T':
                 config.timeout = atoi(optarg);
                 break;
+            case 'p':
+                if (queue_parse_schedule(optarg, &config.schedule) != 0) {
+                    fprintf(stderr, "Error: Unknown power schedule '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 's':
+                config.seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'r':
+                config.resume = 1;
+                break;
             case 'v':
                 config.verbose = 1;
                 break;
@@ -92,10 +154,24 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (!executor_find(config.executor)) {
+        fprintf(stderr, "Error: Unknown executor '%s'\n", config.executor);
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (config.jobs && (strcmp(config.executor, "device") == 0 || config.farm || config.device_count)) {
+        fprintf(stderr, "Error: --jobs runs forkserver or agent executors; devices are given with -d or -F\n");
+        return 1;
+    }
+
     // Set up signal handlers
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
 
+    // A fork server or agent that died shows up as a failed write
+    signal(SIGPIPE, SIG_IGN);
+
     // Initialize fuzzer
     if (fuzzer_init(&g_fuzzer, &config) != 0) {
         fprintf(stderr, "Failed to initialize fuzzer\n");
@@ -107,18 +183,51 @@ int main(int argc, char *argv[]) {
     printf("Target: %s\n", config.target);
     printf("Output directory: %s\n", config.output_dir);
     printf("Max iterations: %u\n", config.max_iterations);
-    printf("Timeout: %u ms\n", config.timeout);
-    printf("Device: %s\n", g_fuzzer.device.udid);
-    printf("iOS version: %s\n", g_fuzzer.device.product_version);
+    if (config.timeout) {
+        printf("Timeout: %u ms\n", config.timeout);
+    } else {
+        printf("Timeout: calibrated over the first %d execs\n", CALIBRATION_EXECS);
+    }
+    printf("Seed: %llu\n", (unsigned long long)g_fuzzer.config.seed);
+    printf("Executor: %s\n", g_fuzzer.farm ? config.executor : g_fuzzer.executor.ops->name);
+    if (g_fuzzer.farm) {
+        printf("%s: %u%s\n", config.jobs ? "Jobs" : "Devices", g_fuzzer.farm->count,
+               config.farm ? ", admitting new ones" : "");
+    } else if (g_fuzzer.device.udid) {
+        printf("Device: %s\n", g_fuzzer.device.udid);
+        printf("iOS version: %s\n", g_fuzzer.device.product_version);
+    }
+    if (config.resume) {
+        printf("Resumed at iteration %u (%u queue entries, %u saved since to rerun)\n",
+               g_fuzzer.iteration, g_fuzzer.queue.count,
+               g_fuzzer.requeue_end - g_fuzzer.requeue_next);
+    }
     printf("\nStarting fuzzing...\n");
 
     // Run fuzzer
+    uint64_t start_execs = g_fuzzer.exec_count;
     int ret = fuzzer_run(&g_fuzzer);
 
+    if (g_fuzzer.state == FUZZ_STATE_PAUSED) {
+        printf("\nInterrupted, resume with --resume\n");
+    }
+
+    // Report throughput
+    uint64_t elapsed = time(NULL) - g_fuzzer.start_time;
+    uint64_t execs = g_fuzzer.exec_count - start_execs;
+    printf("\nExecutions: %llu (%.1f execs/sec)\n",
+           (unsigned long long)g_fuzzer.exec_count,
+           elapsed ? (double)execs / elapsed : (double)execs);
+    farm_report(&g_fuzzer);
+
     // Clean up
     fuzzer_cleanup(&g_fuzzer);
     free(config.target);
     free(config.output_dir);
+    for (uint32_t i = 0; i < config.device_count; i++) {
+        free(config.devices[i]);
+    }
+    free(config.devices);
 
     return ret;
 } 
\ No newline at end of file
@@ -1,7 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 #include "../../include/fuzzkrieg.h"
 
 // Mutation strategies
@@ -25,71 +24,6 @@ static const uint16_t interesting_16[] = {
     0x7fff, 0x8000, 0xffff, 0xfffe, 0xfffd, 0xfffb
 };
 
-// Initialize random number generator
-static void init_random(void) {
-    static int initialized = 0;
-    if (!initialized) {
-        srand(time(NULL));
-        initialized = 1;
-    }
-}
-
-// Create a new test case
-testcase_t *testcase_create(const uint8_t *data, size_t size) {
-    if (!data || size == 0 || size > MAX_TESTCASE_SIZE) {
-        return NULL;
-    }
-
-    testcase_t *tc = malloc(sizeof(testcase_t));
-    if (!tc) {
-        return NULL;
-    }
-
-    tc->data = malloc(size);
-    if (!tc->data) {
-        free(tc);
-        return NULL;
-    }
-
-    memcpy(tc->data, data, size);
-    tc->size = size;
-    tc->hash = 0;
-    tc->exec_time = 0;
-    tc->coverage_count = 0;
-
-    return tc;
-}
-
-// Free a test case
-void testcase_free(testcase_t *tc) {
-    if (!tc) {
-        return;
-    }
-
-    free(tc->data);
-    free(tc);
-}
-
-// Save a test case to file
-int testcase_save(testcase_t *tc, const char *path) {
-    if (!tc || !tc->data || !path) {
-        return -1;
-    }
-
-    FILE *f = fopen(path, "wb");
-    if (!f) {
-        return -1;
-    }
-
-    if (fwrite(tc->data, 1, tc->size, f) != tc->size) {
-        fclose(f);
-        return -1;
-    }
-
-    fclose(f);
-    return 0;
-}
-
 // Load a test case from file
 testcase_t *testcase_load(const char *path) {
     if (!path) {
@@ -133,21 +67,19 @@ testcase_t *testcase_load(const char *path) {
 }
 
 // Mutate a test case
-int testcase_mutate(testcase_t *tc) {
-    if (!tc || !tc->data || tc->size == 0) {
+int testcase_mutate(testcase_t *tc, rng_t *rng) {
+    if (!tc || !tc->data || tc->size == 0 || !rng) {
         return -1;
     }
 
-    init_random();
-
     // Select mutation strategy
-    mutation_strategy_t strategy = rand() % 6;
-    size_t pos = rand() % tc->size;
+    mutation_strategy_t strategy = rng_below(rng, 6);
+    size_t pos = rng_below_size(rng, tc->size);
 
     switch (strategy) {
         case MUTATE_BITFLIP:
             // Flip a random bit
-            tc->data[pos] ^= (1 << (rand() % 8));
+            tc->data[pos] ^= (1 << rng_below(rng, 8));
             break;
 
         case MUTATE_BYTE_FLIP:
@@ -158,17 +90,17 @@ int testcase_mutate(testcase_t *tc) {
         case MUTATE_ARITHMETIC:
             // Add or subtract a small value
             {
-                int delta = (rand() % 16) - 8;
+                int delta = (int)rng_below(rng, 16) - 8;
                 tc->data[pos] += delta;
             }
             break;
 
         case MUTATE_INTERESTING:
             // Replace with an interesting value
-            if (rand() % 2) {
-                tc->data[pos] = interesting_8[rand() % (sizeof(interesting_8) / sizeof(interesting_8[0]))];
+            if (rng_below(rng, 2)) {
+                tc->data[pos] = interesting_8[rng_below(rng, sizeof(interesting_8) / sizeof(interesting_8[0]))];
             } else if (pos + 1 < tc->size) {
-                uint16_t val = interesting_16[rand() % (sizeof(interesting_16) / sizeof(interesting_16[0]))];
+                uint16_t val = interesting_16[rng_below(rng, sizeof(interesting_16) / sizeof(interesting_16[0]))];
                 tc->data[pos] = val & 0xff;
                 tc->data[pos + 1] = (val >> 8) & 0xff;
             }
@@ -181,9 +113,9 @@ int testcase_mutate(testcase_t *tc) {
         case MUTATE_HAVOC:
             // Perform multiple random mutations
             {
-                int num_mutations = 1 + (rand() % 4);
+                int num_mutations = 1 + rng_below(rng, 4);
                 for (int i = 0; i < num_mutations; i++) {
-                    testcase_mutate(tc);
+                    testcase_mutate(tc, rng);
                 }
             }
             break;
@@ -193,19 +125,19 @@ int testcase_mutate(testcase_t *tc) {
 }
 
 // Generate a random test case
-testcase_t *testcase_generate_random(size_t min_size, size_t max_size) {
-    init_random();
+testcase_t *testcase_generate_random(rng_t *rng, size_t min_size, size_t max_size) {
+    if (!rng) {
+        return NULL;
+    }
 
-    size_t size = min_size + (rand() % (max_size - min_size + 1));
+    size_t size = min_size + rng_below_size(rng, max_size - min_size + 1);
     uint8_t *data = malloc(size);
     if (!data) {
         return NULL;
     }
 
     // Generate random data
-    for (size_t i = 0; i < size; i++) {
-        data[i] = rand() % 256;
-    }
+    rng_fill(rng, data, size);
 
     testcase_t *tc = testcase_create(data, size);
     free(data);
@@ -213,15 +145,10 @@ testcase_t *testcase_generate_random(size_t min_size, size_t max_size) {
 }
 
 // Calculate test case hash
-uint32_t testcase_hash(testcase_t *tc) {
+uint64_t testcase_hash(testcase_t *tc) {
     if (!tc || !tc->data) {
         return 0;
     }
 
-    uint32_t hash = 0;
-    for (size_t i = 0; i < tc->size; i++) {
-        hash = ((hash << 5) + hash) + tc->data[i];
-    }
-
-    return hash;
+    return hash64(tc->data, tc->size, 0);
 } 
\ No newline at end of file
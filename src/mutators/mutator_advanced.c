@@ -1,169 +1,139 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 #include "../../include/fuzzkrieg.h"
 #include "../../include/mutator_advanced.h"
 
 // Kernel structure templates
+static uint8_t task_template[16];
+static uint8_t thread_template[16];
+static uint8_t vm_map_template[16];
+static uint8_t mach_msg_header_template[24];
+static uint8_t ioctl_command_template[16];
+
 kernel_struct_t kernel_structs[NUM_KERNEL_STRUCTS] = {
     {
         .name = "task",
-        .size = sizeof(struct task),
-        .template = NULL  // Will be initialized with actual template
+        .size = sizeof(task_template),
+        .template = task_template
     },
     {
         .name = "thread",
-        .size = sizeof(struct thread),
-        .template = NULL
+        .size = sizeof(thread_template),
+        .template = thread_template
     },
     {
         .name = "vm_map",
-        .size = sizeof(struct vm_map),
-        .template = NULL
+        .size = sizeof(vm_map_template),
+        .template = vm_map_template
     },
     {
         .name = "mach_msg_header",
-        .size = sizeof(struct mach_msg_header),
-        .template = NULL
+        .size = sizeof(mach_msg_header_template),
+        .template = mach_msg_header_template
     },
     {
         .name = "ioctl_command",
-        .size = sizeof(struct ioctl_command),
-        .template = NULL
+        .size = sizeof(ioctl_command_template),
+        .template = ioctl_command_template
     }
 };
 
+// Insert a pattern at a random position, growing the test case in place
+static int insert_pattern(testcase_t *tc, rng_t *rng, const uint8_t *pattern, size_t pattern_size) {
+    size_t old_size = tc->size;
+    size_t pos = rng_below_size(rng, old_size + 1);
+
+    if (testcase_resize(tc, old_size + pattern_size) != 0) {
+        return -1;
+    }
+
+    memmove(tc->data + pos + pattern_size, tc->data + pos, old_size - pos);
+    memcpy(tc->data + pos, pattern, pattern_size);
+    return 0;
+}
+
 // Mutate kernel structure
-int mutate_kernel_struct(testcase_t *tc, const kernel_struct_t *struct_template) {
-    if (!tc || !struct_template || !struct_template->template) {
+int mutate_kernel_struct(testcase_t *tc, rng_t *rng, const kernel_struct_t *struct_template) {
+    if (!tc || !rng || !struct_template || !struct_template->template) {
         return -1;
     }
 
-    // Allocate space for the structure
-    size_t new_size = tc->size + struct_template->size;
-    uint8_t *new_data = realloc(tc->data, new_size);
-    if (!new_data) {
+    // Make room for the structure
+    size_t offset = tc->size;
+    if (testcase_resize(tc, offset + struct_template->size) != 0) {
         return -1;
     }
 
     // Copy template and mutate variable fields
-    memcpy(new_data + tc->size, struct_template->template, struct_template->size);
+    memcpy(tc->data + offset, struct_template->template, struct_template->size);
     
     // Mutate some fields randomly
-    for (size_t i = 0; i < struct_template->size; i += sizeof(uint32_t)) {
-        if (rand() % 2) {  // 50% chance to mutate each field
-            *(uint32_t*)(new_data + tc->size + i) = rand();
+    for (size_t i = 0; i + sizeof(uint32_t) <= struct_template->size; i += sizeof(uint32_t)) {
+        if (rng_below(rng, 2)) {  // 50% chance to mutate each field
+            uint32_t value = (uint32_t)rng_next(rng);
+            memcpy(tc->data + offset + i, &value, sizeof(value));
         }
     }
 
-    tc->data = new_data;
-    tc->size = new_size;
     return 0;
 }
 
 // Mutate memory pattern
-int mutate_memory_pattern(testcase_t *tc) {
-    if (!tc) {
+int mutate_memory_pattern(testcase_t *tc, rng_t *rng) {
+    if (!tc || !rng) {
         return -1;
     }
 
-    // Insert random memory patterns
-    size_t pattern_size = 16 + (rand() % 48);  // 16-64 bytes
-    size_t new_size = tc->size + pattern_size;
-    uint8_t *new_data = realloc(tc->data, new_size);
-    if (!new_data) {
+    // Append random memory patterns
+    size_t pattern_size = 16 + rng_below(rng, 48);  // 16-64 bytes
+    size_t offset = tc->size;
+    if (testcase_resize(tc, offset + pattern_size) != 0) {
         return -1;
     }
 
     // Generate pattern
-    for (size_t i = 0; i < pattern_size; i++) {
-        new_data[tc->size + i] = rand() % 256;
-    }
+    rng_fill(rng, tc->data + offset, pattern_size);
 
-    tc->data = new_data;
-    tc->size = new_size;
     return 0;
 }
 
 // Mutate syscall
-int mutate_syscall(testcase_t *tc) {
-    if (!tc) {
+int mutate_syscall(testcase_t *tc, rng_t *rng) {
+    if (!tc || !rng) {
         return -1;
     }
 
     // Insert syscall pattern
-    const char *syscall_pattern = "\x00\x00\x00\x00\x00\x00\x00\x00";  // Example pattern
-    size_t pattern_size = strlen(syscall_pattern);
-    size_t new_size = tc->size + pattern_size;
-    uint8_t *new_data = realloc(tc->data, new_size);
-    if (!new_data) {
-        return -1;
-    }
-
-    // Insert at random position
-    size_t pos = rand() % (tc->size + 1);
-    memmove(new_data + pos + pattern_size, new_data + pos, tc->size - pos);
-    memcpy(new_data + pos, syscall_pattern, pattern_size);
-
-    tc->data = new_data;
-    tc->size = new_size;
-    return 0;
+    static const uint8_t syscall_pattern[8] = { 0 };  // Example pattern
+    return insert_pattern(tc, rng, syscall_pattern, sizeof(syscall_pattern));
 }
 
 // Mutate IOCTL
-int mutate_ioctl(testcase_t *tc) {
-    if (!tc) {
+int mutate_ioctl(testcase_t *tc, rng_t *rng) {
+    if (!tc || !rng) {
         return -1;
     }
 
     // Insert IOCTL pattern
-    const char *ioctl_pattern = "\x00\x00\x00\x00\x00\x00\x00\x00";  // Example pattern
-    size_t pattern_size = strlen(ioctl_pattern);
-    size_t new_size = tc->size + pattern_size;
-    uint8_t *new_data = realloc(tc->data, new_size);
-    if (!new_data) {
-        return -1;
-    }
-
-    // Insert at random position
-    size_t pos = rand() % (tc->size + 1);
-    memmove(new_data + pos + pattern_size, new_data + pos, tc->size - pos);
-    memcpy(new_data + pos, ioctl_pattern, pattern_size);
-
-    tc->data = new_data;
-    tc->size = new_size;
-    return 0;
+    static const uint8_t ioctl_pattern[8] = { 0 };  // Example pattern
+    return insert_pattern(tc, rng, ioctl_pattern, sizeof(ioctl_pattern));
 }
 
 // Mutate Mach message
-int mutate_mach_msg(testcase_t *tc) {
-    if (!tc) {
+int mutate_mach_msg(testcase_t *tc, rng_t *rng) {
+    if (!tc || !rng) {
         return -1;
     }
 
     // Insert Mach message header
-    const char *mach_header = "\x00\x00\x00\x00\x00\x00\x00\x00";  // Example header
-    size_t header_size = strlen(mach_header);
-    size_t new_size = tc->size + header_size;
-    uint8_t *new_data = realloc(tc->data, new_size);
-    if (!new_data) {
-        return -1;
-    }
-
-    // Insert at random position
-    size_t pos = rand() % (tc->size + 1);
-    memmove(new_data + pos + header_size, new_data + pos, tc->size - pos);
-    memcpy(new_data + pos, mach_header, header_size);
-
-    tc->data = new_data;
-    tc->size = new_size;
-    return 0;
+    static const uint8_t mach_header[8] = { 0 };  // Example header
+    return insert_pattern(tc, rng, mach_header, sizeof(mach_header));
 }
 
 // Mutate VM operations
-void mutate_vm_operation(testcase_t *tc) {
-    if (!tc || !tc->data) {
+void mutate_vm_operation(testcase_t *tc, rng_t *rng) {
+    if (!tc || !tc->data || !rng) {
         return;
     }
 
@@ -178,18 +148,18 @@ void mutate_vm_operation(testcase_t *tc) {
     };
 
     // Select a random pattern
-    const uint8_t *pattern = vm_patterns[rand() % (sizeof(vm_patterns) / sizeof(vm_patterns[0]))];
+    const uint8_t *pattern = vm_patterns[rng_below(rng, sizeof(vm_patterns) / sizeof(vm_patterns[0]))];
     
     // Find a suitable location
     if (tc->size >= sizeof(vm_patterns[0])) {
-        size_t pos = rand() % (tc->size - sizeof(vm_patterns[0]));
+        size_t pos = rng_below_size(rng, tc->size - sizeof(vm_patterns[0]));
         memcpy(tc->data + pos, pattern, sizeof(vm_patterns[0]));
     }
 }
 
 // Mutate task operations
-void mutate_task_operation(testcase_t *tc) {
-    if (!tc || !tc->data) {
+void mutate_task_operation(testcase_t *tc, rng_t *rng) {
+    if (!tc || !tc->data || !rng) {
         return;
     }
 
@@ -204,18 +174,18 @@ void mutate_task_operation(testcase_t *tc) {
     };
 
     // Select a random pattern
-    const uint8_t *pattern = task_patterns[rand() % (sizeof(task_patterns) / sizeof(task_patterns[0]))];
+    const uint8_t *pattern = task_patterns[rng_below(rng, sizeof(task_patterns) / sizeof(task_patterns[0]))];
     
     // Find a suitable location
     if (tc->size >= sizeof(task_patterns[0])) {
-        size_t pos = rand() % (tc->size - sizeof(task_patterns[0]));
+        size_t pos = rng_below_size(rng, tc->size - sizeof(task_patterns[0]));
         memcpy(tc->data + pos, pattern, sizeof(task_patterns[0]));
     }
 }
 
 // Mutate thread operations
-void mutate_thread_operation(testcase_t *tc) {
-    if (!tc || !tc->data) {
+void mutate_thread_operation(testcase_t *tc, rng_t *rng) {
+    if (!tc || !tc->data || !rng) {
         return;
     }
 
@@ -230,55 +200,55 @@ void mutate_thread_operation(testcase_t *tc) {
     };
 
     // Select a random pattern
-    const uint8_t *pattern = thread_patterns[rand() % (sizeof(thread_patterns) / sizeof(thread_patterns[0]))];
+    const uint8_t *pattern = thread_patterns[rng_below(rng, sizeof(thread_patterns) / sizeof(thread_patterns[0]))];
     
     // Find a suitable location
     if (tc->size >= sizeof(thread_patterns[0])) {
-        size_t pos = rand() % (tc->size - sizeof(thread_patterns[0]));
+        size_t pos = rng_below_size(rng, tc->size - sizeof(thread_patterns[0]));
         memcpy(tc->data + pos, pattern, sizeof(thread_patterns[0]));
     }
 }
 
 // Advanced test case mutation
-int testcase_mutate_advanced(testcase_t *tc) {
-    if (!tc || !tc->data) {
+int testcase_mutate_advanced(testcase_t *tc, rng_t *rng) {
+    if (!tc || !tc->data || !rng) {
         return -1;
     }
 
     // Select a random advanced mutation strategy
-    advanced_mutation_strategy_t strategy = rand() % 8;
+    advanced_mutation_strategy_t strategy = rng_below(rng, 8);
 
     switch (strategy) {
         case MUTATE_KERNEL_STRUCT:
-            mutate_kernel_struct(tc, &kernel_structs[rand() % (sizeof(kernel_structs) / sizeof(kernel_structs[0]))]);
+            mutate_kernel_struct(tc, rng, &kernel_structs[rng_below(rng, NUM_KERNEL_STRUCTS)]);
             break;
 
         case MUTATE_MEMORY_PATTERN:
-            mutate_memory_pattern(tc);
+            mutate_memory_pattern(tc, rng);
             break;
 
         case MUTATE_SYSCALL:
-            mutate_syscall(tc);
+            mutate_syscall(tc, rng);
             break;
 
         case MUTATE_IOCTL:
-            mutate_ioctl(tc);
+            mutate_ioctl(tc, rng);
             break;
 
         case MUTATE_MACH_MSG:
-            mutate_mach_msg(tc);
+            mutate_mach_msg(tc, rng);
             break;
 
         case MUTATE_VM_OPERATION:
-            mutate_vm_operation(tc);
+            mutate_vm_operation(tc, rng);
             break;
 
         case MUTATE_TASK_OPERATION:
-            mutate_task_operation(tc);
+            mutate_task_operation(tc, rng);
             break;
 
         case MUTATE_THREAD_OPERATION:
-            mutate_thread_operation(tc);
+            mutate_thread_operation(tc, rng);
             break;
     }
 
@@ -0,0 +1,95 @@
+// Fuzzkrieg harness runtime
+//
+// Link this into a Linux harness built with
+// -fsanitize-coverage=trace-pc-guard. It maps the coverage segment
+// published by the fork server executor and runs the fork server loop
+// before main(). The harness itself reads each input from stdin.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/shm.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "../../include/forkserver.h"
+
+// Fallback map so the harness still runs outside the fuzzer
+static uint8_t dummy_map[FORKSRV_MAP_SIZE];
+static uint8_t *coverage_map = dummy_map;
+
+// Assign an edge id to every instrumented guard
+void __sanitizer_cov_trace_pc_guard_init(uint32_t *start, uint32_t *stop) {
+    static uint32_t next_id = 0;
+
+    if (start == stop || *start) {
+        return;
+    }
+
+    for (uint32_t *guard = start; guard < stop; guard++) {
+        // Id 0 disables the guard, so skip it on wrap-around
+        next_id = (next_id + 1) % FORKSRV_MAP_SIZE;
+        if (next_id == 0) {
+            next_id = 1;
+        }
+        *guard = next_id;
+    }
+}
+
+// Record an edge hit
+void __sanitizer_cov_trace_pc_guard(uint32_t *guard) {
+    coverage_map[*guard]++;
+}
+
+// Attach the coverage map and serve fork requests
+__attribute__((constructor)) static void fuzzkrieg_rt_init(void) {
+    const char *shm_str = getenv(FORKSRV_SHM_ENV);
+    if (shm_str) {
+        void *map = shmat(atoi(shm_str), NULL, 0);
+        if (map != (void *)-1) {
+            coverage_map = map;
+        }
+    }
+
+    // Not running under the fuzzer
+    uint32_t hello = FORKSRV_HELLO;
+    if (write(FORKSRV_FD + 1, &hello, sizeof(hello)) != sizeof(hello)) {
+        return;
+    }
+
+    for (;;) {
+        uint32_t go;
+        if (read(FORKSRV_FD, &go, sizeof(go)) != sizeof(go)) {
+            _exit(0);
+        }
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            _exit(1);
+        }
+
+        if (pid == 0) {
+            // Child: drop the protocol descriptors and run the harness
+            close(FORKSRV_FD);
+            close(FORKSRV_FD + 1);
+            return;
+        }
+
+        int32_t child = pid;
+        if (write(FORKSRV_FD + 1, &child, sizeof(child)) != sizeof(child)) {
+            _exit(1);
+        }
+
+        int status;
+        if (waitpid(pid, &status, 0) < 0) {
+            _exit(1);
+        }
+
+        // Every child reads stdin from offset 0
+        lseek(STDIN_FILENO, 0, SEEK_SET);
+
+        int32_t st = status;
+        if (write(FORKSRV_FD + 1, &st, sizeof(st)) != sizeof(st)) {
+            _exit(1);
+        }
+    }
+}
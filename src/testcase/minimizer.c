@@ -1,12 +1,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include "../../include/fuzzkrieg.h"
 #include "../../include/crash_analyzer.h"
+#include "../../include/minimizer.h"
 
 #define MIN_CHUNK_SIZE 16
-#define MAX_ITERATIONS 1000
+#define MAX_ITERATIONS 1000     // Reproduction attempts per test case
+#define MAX_SECONDS 60          // Time spent on one test case
 
 // Test case chunk structure
 typedef struct {
@@ -15,11 +18,29 @@ typedef struct {
     int is_essential;
 } chunk_t;
 
+// Reproducer used instead of rerunning the fuzzer, if set
+static minimizer_reproducer_t custom_reproducer;
+static void *custom_reproducer_ctx;
+
+// Set to stop minimizing; what was removed so far is kept
+static const atomic_int *cancel_flag;
+
 // Initialize test case minimizer
 int minimizer_init(void) {
     return 0;
 }
 
+// Replace the reproducer
+void minimizer_set_reproducer(minimizer_reproducer_t reproducer, void *ctx) {
+    custom_reproducer = reproducer;
+    custom_reproducer_ctx = ctx;
+}
+
+// Stop early whenever *cancel is set
+void minimizer_set_cancel(const atomic_int *cancel) {
+    cancel_flag = cancel;
+}
+
 // Check if test case still triggers the crash
 int check_crash_reproducible(const char *testcase_path, const char *original_crash_log) {
     if (!testcase_path || !original_crash_log) {
@@ -92,7 +113,9 @@ chunk_t *split_into_chunks(const char *testcase_path, size_t *num_chunks) {
         chunks[i].offset = i * MIN_CHUNK_SIZE;
         chunks[i].size = (i == *num_chunks - 1) ? 
             (file_size - i * MIN_CHUNK_SIZE) : MIN_CHUNK_SIZE;
-        chunks[i].is_essential = 0;
+        // Kept until shown to be unneeded; each trial drops one chunk, so
+        // starting out unneeded would drop every later chunk with it
+        chunks[i].is_essential = 1;
     }
 
     fclose(f);
@@ -153,8 +176,14 @@ int minimize_testcase(const char *testcase_path, const char *crash_log_path) {
     char temp_path[256];
     snprintf(temp_path, sizeof(temp_path), "/tmp/fuzzkrieg_minimized_%d", getpid());
 
-    // Try to remove chunks one by one
-    for (size_t i = 0; i < num_chunks; i++) {
+    // Try to remove chunks one by one, within a budget; each attempt may
+    // rerun the whole fuzzer
+    time_t deadline = time(NULL) + MAX_SECONDS;
+    for (size_t i = 0; i < num_chunks && i < MAX_ITERATIONS; i++) {
+        if ((cancel_flag && atomic_load(cancel_flag)) || time(NULL) >= deadline) {
+            break;
+        }
+
         // Mark chunk as non-essential
         chunks[i].is_essential = 0;
 
@@ -165,7 +194,10 @@ int minimize_testcase(const char *testcase_path, const char *crash_log_path) {
         }
 
         // Check if crash is still reproducible
-        if (!check_crash_reproducible(temp_path, crash_log_path)) {
+        int reproducible = custom_reproducer ?
+            custom_reproducer(temp_path, crash_log_path, custom_reproducer_ctx) :
+            check_crash_reproducible(temp_path, crash_log_path);
+        if (!reproducible) {
             // If crash is not reproducible, mark chunk as essential
             chunks[i].is_essential = 1;
         }
@@ -22,19 +22,33 @@ testcase_t *testcase_create(const uint8_t *data, size_t size) {
 
     memcpy(tc->data, data, size);
     tc->size = size;
+    tc->capacity = size;
+    tc->pool = NULL;
     tc->hash = 0;
+    tc->parent = NULL;
+    tc->parent_size = 0;
     tc->exec_time = 0;
     tc->coverage_count = 0;
+    tc->path_hash = 0;
+    tc->novelty = COVERAGE_NONE;
+    tc->new_path = 0;
+    tc->timed_out = 0;
+    tc->corpus_index = -1;
 
     return tc;
 }
 
-// Free a test case
+// Free a test case, returning pooled buffers to their pool
 void testcase_free(testcase_t *tc) {
     if (!tc) {
         return;
     }
 
+    if (tc->pool) {
+        testcase_pool_release(tc->pool, tc);
+        return;
+    }
+
     if (tc->data) {
         free(tc->data);
     }
@@ -59,4 +73,108 @@ int testcase_save(testcase_t *tc, const char *path) {
 
     fclose(f);
     return 0;
-} 
\ No newline at end of file
+}
+
+// Resize a test case, growing in place while it fits the capacity
+int testcase_resize(testcase_t *tc, size_t size) {
+    if (!tc || size == 0 || size > MAX_TESTCASE_SIZE) {
+        return -1;
+    }
+
+    if (size > tc->capacity) {
+        // Pooled buffers never move
+        if (tc->pool) {
+            return -1;
+        }
+
+        uint8_t *data = realloc(tc->data, size);
+        if (!data) {
+            return -1;
+        }
+        tc->data = data;
+        tc->capacity = size;
+    }
+
+    tc->size = size;
+    return 0;
+}
+
+// Initialize a test case pool
+int testcase_pool_init(testcase_pool_t *pool, uint32_t max_buffers) {
+    if (!pool || max_buffers == 0) {
+        return -1;
+    }
+
+    memset(pool, 0, sizeof(testcase_pool_t));
+
+    pool->free_list = calloc(max_buffers, sizeof(testcase_t *));
+    if (!pool->free_list) {
+        return -1;
+    }
+
+    pool->max_buffers = max_buffers;
+    return 0;
+}
+
+// Take a buffer from the pool, allocating until the pool is full
+testcase_t *testcase_pool_acquire(testcase_pool_t *pool) {
+    if (!pool) {
+        return NULL;
+    }
+
+    testcase_t *tc;
+    if (pool->free_count > 0) {
+        tc = pool->free_list[--pool->free_count];
+    } else {
+        // Every buffer is in use
+        if (pool->allocated >= pool->max_buffers) {
+            return NULL;
+        }
+
+        // Test case and data share one allocation
+        tc = malloc(sizeof(testcase_t) + MAX_TESTCASE_SIZE);
+        if (!tc) {
+            return NULL;
+        }
+        tc->data = (uint8_t *)(tc + 1);
+        tc->capacity = MAX_TESTCASE_SIZE;
+        tc->pool = pool;
+        pool->allocated++;
+    }
+
+    tc->size = 0;
+    tc->hash = 0;
+    tc->parent = NULL;
+    tc->parent_size = 0;
+    tc->exec_time = 0;
+    tc->coverage_count = 0;
+    tc->path_hash = 0;
+    tc->novelty = COVERAGE_NONE;
+    tc->new_path = 0;
+    tc->timed_out = 0;
+    tc->corpus_index = -1;
+    return tc;
+}
+
+// Return a buffer to the pool
+void testcase_pool_release(testcase_pool_t *pool, testcase_t *tc) {
+    if (!pool || !tc) {
+        return;
+    }
+
+    pool->free_list[pool->free_count++] = tc;
+}
+
+// Free all pooled buffers
+void testcase_pool_cleanup(testcase_pool_t *pool) {
+    if (!pool) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < pool->free_count; i++) {
+        free(pool->free_list[i]);
+    }
+    free(pool->free_list);
+
+    memset(pool, 0, sizeof(testcase_pool_t));
+}
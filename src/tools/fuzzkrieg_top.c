@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include "../../include/shmstats.h"
+
+// Instances shown per refresh
+#define MAX_INSTANCES 256
+
+// Stage totals across instances
+typedef struct {
+    char name[16];
+    uint64_t total_ns;
+    uint64_t max_p50_ns;
+    uint64_t max_p99_ns;
+} stage_total_t;
+
+// Print usage information
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("Options:\n");
+    printf("  -d, --dir <path>       Stats directory (default: $%s or %s)\n", SHMSTATS_DIR_ENV, SHMSTATS_DIR);
+    printf("  -n, --interval <s>     Refresh interval in seconds (default: 1)\n");
+    printf("  -1, --once             Print once and exit\n");
+    printf("  -h, --help             Show this help message\n");
+}
+
+// Read every live segment in the directory
+static int collect(const char *dir, shmstats_t *snapshots, int max) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        return 0;
+    }
+
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL && count < max) {
+        size_t len = strlen(entry->d_name);
+        size_t suffix = strlen(SHMSTATS_SUFFIX);
+        if (len <= suffix || strcmp(entry->d_name + len - suffix, SHMSTATS_SUFFIX) != 0) {
+            continue;
+        }
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+
+        const shmstats_t *stats = shmstats_attach(path);
+        if (!stats) {
+            continue;
+        }
+
+        // Skip segments left behind by instances that died
+        if (shmstats_read(stats, &snapshots[count]) == 0 &&
+            (kill(snapshots[count].pid, 0) == 0 || errno == EPERM)) {
+            count++;
+        }
+        shmstats_detach(stats);
+    }
+
+    closedir(d);
+    return count;
+}
+
+// Fold one instance's stages into the totals
+static void add_stages(stage_total_t *totals, uint32_t *num_totals, const shmstats_t *s) {
+    uint32_t stages = s->num_stages < SHMSTATS_MAX_STAGES ? s->num_stages : SHMSTATS_MAX_STAGES;
+    for (uint32_t i = 0; i < stages; i++) {
+        stage_total_t *t = NULL;
+        for (uint32_t j = 0; j < *num_totals; j++) {
+            if (strncmp(totals[j].name, s->stage_names[i], sizeof(totals[j].name)) == 0) {
+                t = &totals[j];
+                break;
+            }
+        }
+        if (!t) {
+            if (*num_totals == SHMSTATS_MAX_STAGES) {
+                continue;
+            }
+            t = &totals[(*num_totals)++];
+            memset(t, 0, sizeof(stage_total_t));
+            memcpy(t->name, s->stage_names[i], sizeof(t->name));
+            t->name[sizeof(t->name) - 1] = '\0';
+        }
+
+        t->total_ns += s->stages[i].total_ns;
+        if (s->stages[i].p50_ns > t->max_p50_ns) t->max_p50_ns = s->stages[i].p50_ns;
+        if (s->stages[i].p99_ns > t->max_p99_ns) t->max_p99_ns = s->stages[i].p99_ns;
+    }
+}
+
+// Print one refresh
+static void display(const char *dir, const shmstats_t *snapshots, int count) {
+    printf("fuzzkrieg-top - %d instance%s in %s\n\n", count, count == 1 ? "" : "s", dir);
+    printf("%7s  %-10s %12s %14s %10s %6s %6s %7s %7s %6s\n",
+           "PID", "EXECUTOR", "ITERATIONS", "EXECS", "EXECS/S", "CRASH", "HANGS", "CORPUS", "EDGES", "AGE");
+
+    uint64_t now = time(NULL);
+    uint64_t iterations = 0, execs = 0, crashes = 0, hangs = 0, corpus = 0;
+    double execs_per_sec = 0;
+    uint32_t max_edges = 0;
+    stage_total_t totals[SHMSTATS_MAX_STAGES];
+    uint32_t num_totals = 0;
+
+    for (int i = 0; i < count; i++) {
+        const shmstats_t *s = &snapshots[i];
+        printf("%7d  %-10.10s %12llu %14llu %10.1f %6u %6u %7u %7u %5llus\n",
+               s->pid, s->executor,
+               (unsigned long long)s->iterations, (unsigned long long)s->execs,
+               s->execs_per_sec, s->crashes, s->hangs, s->corpus_count, s->unique_edges,
+               (unsigned long long)(now > s->last_update ? now - s->last_update : 0));
+
+        iterations += s->iterations;
+        execs += s->execs;
+        execs_per_sec += s->execs_per_sec;
+        crashes += s->crashes;
+        hangs += s->hangs;
+        corpus += s->corpus_count;
+        if (s->unique_edges > max_edges) {
+            max_edges = s->unique_edges;
+        }
+        add_stages(totals, &num_totals, s);
+    }
+
+    printf("%7s  %-10s %12llu %14llu %10.1f %6llu %6llu %7llu %7u\n\n", "total", "",
+           (unsigned long long)iterations, (unsigned long long)execs, execs_per_sec,
+           (unsigned long long)crashes, (unsigned long long)hangs, (unsigned long long)corpus, max_edges);
+
+    // Stage breakdown across all instances
+    uint64_t loop_ns = 0;
+    for (uint32_t i = 0; i < num_totals; i++) {
+        loop_ns += totals[i].total_ns;
+    }
+
+    printf("%-12s %7s %12s %12s\n", "STAGE", "SHARE", "MAX P50 us", "MAX P99 us");
+    for (uint32_t i = 0; i < num_totals; i++) {
+        printf("%-12s %6.1f%% %12.1f %12.1f\n", totals[i].name,
+               loop_ns ? 100.0 * totals[i].total_ns / loop_ns : 0.0,
+               totals[i].max_p50_ns / 1000.0, totals[i].max_p99_ns / 1000.0);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *dir = shmstats_dir();
+    unsigned int interval = 1;
+    int once = 0;
+
+    static struct option long_options[] = {
+        {"dir", required_argument, 0, 'd'},
+        {"interval", required_argument, 0, 'n'},
+        {"once", no_argument, 0, '1'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "d:n:1h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'd':
+                dir = optarg;
+                break;
+            case 'n':
+                interval = atoi(optarg);
+                if (interval == 0) {
+                    interval = 1;
+                }
+                break;
+            case '1':
+                once = 1;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    static shmstats_t snapshots[MAX_INSTANCES];
+
+    for (;;) {
+        int count = collect(dir, snapshots, MAX_INSTANCES);
+
+        if (!once) {
+            printf("\033[H\033[2J");
+        }
+        display(dir, snapshots, count);
+        fflush(stdout);
+
+        if (once) {
+            break;
+        }
+        sleep(interval);
+    }
+
+    return 0;
+}